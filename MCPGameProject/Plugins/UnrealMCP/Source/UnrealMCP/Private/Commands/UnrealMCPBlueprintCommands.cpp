@@ -1,5 +1,7 @@
 #include "Commands/UnrealMCPBlueprintCommands.h"
 #include "Commands/UnrealMCPCommonUtils.h"
+#include "MCPTransaction.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 #include "Engine/Blueprint.h"
 #include "Engine/BlueprintGeneratedClass.h"
 #include "Factories/BlueprintFactory.h"
@@ -29,58 +31,29 @@ FUnrealMCPBlueprintCommands::FUnrealMCPBlueprintCommands()
 {
 }
 
-TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params)
+void FUnrealMCPBlueprintCommands::RegisterCommands(FMCPCommandRegistry& Registry)
 {
-    if (CommandType == TEXT("create_blueprint"))
-    {
-        return HandleCreateBlueprint(Params);
-    }
-    else if (CommandType == TEXT("add_component_to_blueprint"))
-    {
-        return HandleAddComponentToBlueprint(Params);
-    }
-    else if (CommandType == TEXT("set_component_property"))
-    {
-        return HandleSetComponentProperty(Params);
-    }
-    else if (CommandType == TEXT("set_physics_properties"))
-    {
-        return HandleSetPhysicsProperties(Params);
-    }
-    else if (CommandType == TEXT("compile_blueprint"))
-    {
-        return HandleCompileBlueprint(Params);
-    }
-    else if (CommandType == TEXT("spawn_blueprint_actor"))
-    {
-        return HandleSpawnBlueprintActor(Params);
-    }
-    else if (CommandType == TEXT("set_blueprint_property"))
-    {
-        return HandleSetBlueprintProperty(Params);
-    }
-    else if (CommandType == TEXT("set_static_mesh_properties"))
-    {
-        return HandleSetStaticMeshProperties(Params);
-    }
-    else if (CommandType == TEXT("set_pawn_properties"))
-    {
-        return HandleSetPawnProperties(Params);
-    }
-    else if (CommandType == TEXT("reparent_blueprint"))
-    {
-        return HandleReparentBlueprint(Params);
-    }
-    else if (CommandType == TEXT("create_material"))
-    {
-        return HandleCreateMaterial(Params);
-    }
-
-    return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Unknown blueprint command: %s"), *CommandType));
+    const FName Category(TEXT("blueprint"));
+
+    Registry.RegisterMethod(TEXT("create_blueprint"), this, &FUnrealMCPBlueprintCommands::HandleCreateBlueprint, Category);
+    Registry.RegisterMethod(TEXT("add_component_to_blueprint"), this, &FUnrealMCPBlueprintCommands::HandleAddComponentToBlueprint, Category);
+    Registry.RegisterMethod(TEXT("set_component_property"), this, &FUnrealMCPBlueprintCommands::HandleSetComponentProperty, Category);
+    Registry.RegisterMethod(TEXT("set_physics_properties"), this, &FUnrealMCPBlueprintCommands::HandleSetPhysicsProperties, Category);
+    Registry.RegisterCommand(TEXT("compile_blueprint"), [this](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+    {
+        return HandleCompileBlueprint(Params, Context);
+    }, Category);
+    Registry.RegisterMethod(TEXT("set_blueprint_property"), this, &FUnrealMCPBlueprintCommands::HandleSetBlueprintProperty, Category);
+    Registry.RegisterMethod(TEXT("set_static_mesh_properties"), this, &FUnrealMCPBlueprintCommands::HandleSetStaticMeshProperties, Category);
+    Registry.RegisterMethod(TEXT("set_pawn_properties"), this, &FUnrealMCPBlueprintCommands::HandleSetPawnProperties, Category);
+    Registry.RegisterMethod(TEXT("reparent_blueprint"), this, &FUnrealMCPBlueprintCommands::HandleReparentBlueprint, Category);
+    Registry.RegisterMethod(TEXT("create_material"), this, &FUnrealMCPBlueprintCommands::HandleCreateMaterial, Category);
 }
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCreateBlueprint(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleCreateBlueprint);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("name"), BlueprintName))
@@ -176,6 +149,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCreateBlueprint(const
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleAddComponentToBlueprint(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleAddComponentToBlueprint);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -261,7 +236,7 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleAddComponentToBluepri
         Blueprint->SimpleConstructionScript->AddNode(NewNode);
 
         // Compile the blueprint
-        FKismetEditorUtilities::CompileBlueprint(Blueprint);
+        FMCPTransaction::CompileBlueprint(Blueprint);
 
         TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
         ResultObj->SetStringField(TEXT("component_name"), ComponentName);
@@ -274,6 +249,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleAddComponentToBluepri
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetComponentProperty(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleSetComponentProperty);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -787,6 +764,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetComponentProperty(
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetPhysicsProperties(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleSetPhysicsProperties);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -864,8 +843,10 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetPhysicsProperties(
     return ResultObj;
 }
 
-TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCompileBlueprint(const TSharedPtr<FJsonObject>& Params)
+TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCompileBlueprint(const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleCompileBlueprint);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -881,7 +862,9 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCompileBlueprint(cons
     }
 
     // Compile the blueprint
-    FKismetEditorUtilities::CompileBlueprint(Blueprint);
+    Context.ReportProgress(TEXT("compile"), 0, 1, BlueprintName);
+    FMCPTransaction::CompileBlueprintNow(Blueprint);
+    Context.ReportProgress(TEXT("compile"), 1, 1, BlueprintName);
 
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
     ResultObj->SetStringField(TEXT("name"), BlueprintName);
@@ -891,6 +874,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCompileBlueprint(cons
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSpawnBlueprintActor(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleSpawnBlueprintActor);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -935,6 +920,7 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSpawnBlueprintActor(c
     SpawnTransform.SetLocation(Location);
     SpawnTransform.SetRotation(FQuat(Rotation));
 
+    FMCPTransaction::EnsureCompiled(Blueprint);
     AActor* NewActor = World->SpawnActor<AActor>(Blueprint->GeneratedClass, SpawnTransform);
     if (NewActor)
     {
@@ -947,6 +933,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSpawnBlueprintActor(c
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetBlueprintProperty(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleSetBlueprintProperty);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -968,6 +956,7 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetBlueprintProperty(
     }
 
     // Get the default object
+    FMCPTransaction::EnsureCompiled(Blueprint);
     UObject* DefaultObject = Blueprint->GeneratedClass->GetDefaultObject();
     if (!DefaultObject)
     {
@@ -1004,6 +993,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetBlueprintProperty(
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetStaticMeshProperties(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleSetStaticMeshProperties);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -1080,6 +1071,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetStaticMeshProperti
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetPawnProperties(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleSetPawnProperties);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -1095,6 +1088,7 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetPawnProperties(con
     }
 
     // Get the default object
+    FMCPTransaction::EnsureCompiled(Blueprint);
     UObject* DefaultObject = Blueprint->GeneratedClass->GetDefaultObject();
     if (!DefaultObject)
     {
@@ -1206,6 +1200,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleSetPawnProperties(con
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleReparentBlueprint(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleReparentBlueprint);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -1280,7 +1276,7 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleReparentBlueprint(con
     Blueprint->ParentClass = NewParentClass;
 
     // Compile the Blueprint
-    FKismetEditorUtilities::CompileBlueprint(Blueprint);
+    FMCPTransaction::CompileBlueprint(Blueprint);
 
     // Mark as dirty and save
     Blueprint->MarkPackageDirty();
@@ -1289,10 +1285,7 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleReparentBlueprint(con
     UPackage* Package = Blueprint->GetOutermost();
     if (Package)
     {
-        FString PackageFileName = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
-        FSavePackageArgs SaveArgs;
-        SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
-        UPackage::SavePackage(Package, Blueprint, *PackageFileName, SaveArgs);
+        FMCPTransaction::SavePackage(Package, Blueprint);
     }
 
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
@@ -1305,6 +1298,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleReparentBlueprint(con
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCreateMaterial(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintCommands::HandleCreateMaterial);
+
     // Get required parameters
     FString MaterialName;
     if (!Params->TryGetStringField(TEXT("name"), MaterialName))
@@ -1372,10 +1367,7 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintCommands::HandleCreateMaterial(const
     // Mark package dirty and save
     Package->MarkPackageDirty();
 
-    FString PackageFileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
-    FSavePackageArgs SaveArgs;
-    SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
-    bool bSaved = UPackage::SavePackage(Package, NewMaterial, *PackageFileName, SaveArgs);
+    bool bSaved = FMCPTransaction::SavePackage(Package, NewMaterial);
 
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
     ResultObj->SetBoolField(TEXT("success"), true);
@@ -1,5 +1,7 @@
 #include "Commands/UnrealMCPBlueprintNodeCommands.h"
 #include "Commands/UnrealMCPCommonUtils.h"
+#include "MCPTransaction.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 #include "Engine/Blueprint.h"
 #include "Engine/BlueprintGeneratedClass.h"
 #include "EdGraph/EdGraph.h"
@@ -24,46 +26,24 @@ FUnrealMCPBlueprintNodeCommands::FUnrealMCPBlueprintNodeCommands()
 {
 }
 
-TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params)
+void FUnrealMCPBlueprintNodeCommands::RegisterCommands(FMCPCommandRegistry& Registry)
 {
-    if (CommandType == TEXT("connect_blueprint_nodes"))
-    {
-        return HandleConnectBlueprintNodes(Params);
-    }
-    else if (CommandType == TEXT("add_blueprint_get_self_component_reference"))
-    {
-        return HandleAddBlueprintGetSelfComponentReference(Params);
-    }
-    else if (CommandType == TEXT("add_blueprint_event_node"))
-    {
-        return HandleAddBlueprintEvent(Params);
-    }
-    else if (CommandType == TEXT("add_blueprint_function_node"))
-    {
-        return HandleAddBlueprintFunctionCall(Params);
-    }
-    else if (CommandType == TEXT("add_blueprint_variable"))
-    {
-        return HandleAddBlueprintVariable(Params);
-    }
-    else if (CommandType == TEXT("add_blueprint_input_action_node"))
-    {
-        return HandleAddBlueprintInputActionNode(Params);
-    }
-    else if (CommandType == TEXT("add_blueprint_self_reference"))
-    {
-        return HandleAddBlueprintSelfReference(Params);
-    }
-    else if (CommandType == TEXT("find_blueprint_nodes"))
-    {
-        return HandleFindBlueprintNodes(Params);
-    }
-    
-    return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Unknown blueprint node command: %s"), *CommandType));
+    const FName Category(TEXT("blueprint_node"));
+
+    Registry.RegisterMethod(TEXT("connect_blueprint_nodes"), this, &FUnrealMCPBlueprintNodeCommands::HandleConnectBlueprintNodes, Category);
+    Registry.RegisterMethod(TEXT("add_blueprint_get_self_component_reference"), this, &FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintGetSelfComponentReference, Category);
+    Registry.RegisterMethod(TEXT("add_blueprint_event_node"), this, &FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintEvent, Category);
+    Registry.RegisterMethod(TEXT("add_blueprint_function_node"), this, &FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintFunctionCall, Category);
+    Registry.RegisterMethod(TEXT("add_blueprint_variable"), this, &FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintVariable, Category);
+    Registry.RegisterMethod(TEXT("add_blueprint_input_action_node"), this, &FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintInputActionNode, Category);
+    Registry.RegisterMethod(TEXT("add_blueprint_self_reference"), this, &FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintSelfReference, Category);
+    Registry.RegisterMethod(TEXT("find_blueprint_nodes"), this, &FUnrealMCPBlueprintNodeCommands::HandleFindBlueprintNodes, Category);
 }
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleConnectBlueprintNodes(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintNodeCommands::HandleConnectBlueprintNodes);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -146,6 +126,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleConnectBlueprintN
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintGetSelfComponentReference(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintGetSelfComponentReference);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -216,6 +198,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintGetSe
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintEvent(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintEvent);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -267,6 +251,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintEvent
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintFunctionCall(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintFunctionCall);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -448,6 +434,7 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintFunct
     if (!Function && !FunctionNode)
     {
         UE_LOG(LogTemp, Display, TEXT("Trying to find function in blueprint class"));
+        FMCPTransaction::EnsureCompiled(Blueprint);
         Function = Blueprint->GeneratedClass->FindFunctionByName(*FunctionName);
     }
     
@@ -672,6 +659,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintFunct
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintVariable(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintVariable);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -769,6 +758,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintVaria
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintInputActionNode(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintInputActionNode);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -820,6 +811,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintInput
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintSelfReference(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintSelfReference);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -865,6 +858,8 @@ TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleAddBlueprintSelfR
 
 TSharedPtr<FJsonObject> FUnrealMCPBlueprintNodeCommands::HandleFindBlueprintNodes(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPBlueprintNodeCommands::HandleFindBlueprintNodes);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
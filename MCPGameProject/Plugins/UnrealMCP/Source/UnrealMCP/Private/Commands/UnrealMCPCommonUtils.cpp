@@ -1,6 +1,7 @@
 #include "Commands/UnrealMCPCommonUtils.h"
 #include "AssetRegistry/AssetRegistryModule.h"
 #include "GameFramework/Actor.h"
+#include "Engine/Level.h"
 #include "Engine/Blueprint.h"
 #include "EdGraph/EdGraph.h"
 #include "EdGraph/EdGraphNode.h"
@@ -530,6 +531,81 @@ TSharedPtr<FJsonObject> FUnrealMCPCommonUtils::ActorToJsonObject(AActor* Actor,
     return ActorObject;
 }
 
+TSharedPtr<FJsonValue> FUnrealMCPCommonUtils::ActorToJson(AActor* Actor, const TArray<FString>& Fields)
+{
+    if (!Actor)
+    {
+        return MakeShared<FJsonValueNull>();
+    }
+
+    auto VectorToJson = [](const FVector& Vector)
+    {
+        TArray<TSharedPtr<FJsonValue>> Array;
+        Array.Add(MakeShared<FJsonValueNumber>(Vector.X));
+        Array.Add(MakeShared<FJsonValueNumber>(Vector.Y));
+        Array.Add(MakeShared<FJsonValueNumber>(Vector.Z));
+        return Array;
+    };
+
+    TSharedPtr<FJsonObject> ActorObject = MakeShared<FJsonObject>();
+    for (const FString& Field : Fields)
+    {
+        if (Field == TEXT("name"))
+        {
+            ActorObject->SetStringField(Field, Actor->GetName());
+        }
+        else if (Field == TEXT("class"))
+        {
+            ActorObject->SetStringField(Field, Actor->GetClass()->GetName());
+        }
+        else if (Field == TEXT("location"))
+        {
+            ActorObject->SetArrayField(Field, VectorToJson(Actor->GetActorLocation()));
+        }
+        else if (Field == TEXT("rotation"))
+        {
+            const FRotator Rotation = Actor->GetActorRotation();
+            ActorObject->SetArrayField(Field, VectorToJson(FVector(Rotation.Pitch, Rotation.Yaw, Rotation.Roll)));
+        }
+        else if (Field == TEXT("scale"))
+        {
+            ActorObject->SetArrayField(Field, VectorToJson(Actor->GetActorScale3D()));
+        }
+        else if (Field == TEXT("label"))
+        {
+            ActorObject->SetStringField(Field, Actor->GetActorLabel());
+        }
+        else if (Field == TEXT("folder"))
+        {
+            ActorObject->SetStringField(Field, Actor->GetFolderPath().ToString());
+        }
+        else if (Field == TEXT("level"))
+        {
+            ULevel* Level = Actor->GetLevel();
+            ActorObject->SetStringField(Field, Level ? Level->GetPackage()->GetName() : FString());
+        }
+        else if (Field == TEXT("tags"))
+        {
+            TArray<TSharedPtr<FJsonValue>> TagArray;
+            for (const FName& Tag : Actor->Tags)
+            {
+                TagArray.Add(MakeShared<FJsonValueString>(Tag.ToString()));
+            }
+            ActorObject->SetArrayField(Field, TagArray);
+        }
+    }
+    return MakeShared<FJsonValueObject>(ActorObject);
+}
+
+const TArray<FString>& FUnrealMCPCommonUtils::GetActorJsonFields()
+{
+    static const TArray<FString> Fields = {
+        TEXT("name"), TEXT("class"), TEXT("location"), TEXT("rotation"), TEXT("scale"),
+        TEXT("label"), TEXT("folder"), TEXT("level"), TEXT("tags")
+    };
+    return Fields;
+}
+
 UK2Node_Event* FUnrealMCPCommonUtils::FindExistingEventNode(UEdGraph* Graph, const FString& EventName)
 {
     if (!Graph)
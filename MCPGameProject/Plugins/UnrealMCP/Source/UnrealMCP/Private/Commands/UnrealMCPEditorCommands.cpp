@@ -1,5 +1,8 @@
 #include "Commands/UnrealMCPEditorCommands.h"
 #include "Commands/UnrealMCPCommonUtils.h"
+#include "MCPTransaction.h"
+#include "MCPActorIndex.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 #include "Editor.h"
 #include "EditorViewportClient.h"
 #include "LevelEditorViewport.h"
@@ -31,101 +34,508 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "FileHelpers.h"
 #include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Misc/PackageName.h"
 #include "UObject/SavePackage.h"
 #include "NavMesh/NavMeshBoundsVolume.h"
+#include "ConvexVolume.h"
 
-FUnrealMCPEditorCommands::FUnrealMCPEditorCommands()
+FUnrealMCPEditorCommands::FUnrealMCPEditorCommands(FMCPActorIndex& InActorIndex)
+    : ActorIndex(InActorIndex)
 {
 }
 
-TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params)
+void FUnrealMCPEditorCommands::RegisterCommands(FMCPCommandRegistry& Registry)
 {
+    const FName Category(TEXT("editor"));
+
     // Actor manipulation commands
-    if (CommandType == TEXT("get_actors_in_level"))
+    Registry.RegisterMethod(TEXT("get_actors_in_level"), this, &FUnrealMCPEditorCommands::HandleGetActorsInLevel, Category);
+    Registry.RegisterMethod(TEXT("find_actors_by_name"), this, &FUnrealMCPEditorCommands::HandleFindActorsByName, Category);
+    Registry.RegisterMethod(TEXT("spawn_actor"), this, &FUnrealMCPEditorCommands::HandleSpawnActor, Category);
+    Registry.RegisterCommand(TEXT("create_actor"), [this](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext&)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("'create_actor' command is deprecated and will be removed in a future version. Please use 'spawn_actor' instead."));
+        return HandleSpawnActor(Params);
+    }, Category);
+    Registry.RegisterMethod(TEXT("delete_actor"), this, &FUnrealMCPEditorCommands::HandleDeleteActor, Category);
+    Registry.RegisterMethod(TEXT("set_actor_transform"), this, &FUnrealMCPEditorCommands::HandleSetActorTransform, Category);
+    Registry.RegisterMethod(TEXT("get_actor_properties"), this, &FUnrealMCPEditorCommands::HandleGetActorProperties, Category);
+    Registry.RegisterMethod(TEXT("set_actor_property"), this, &FUnrealMCPEditorCommands::HandleSetActorProperty, Category);
+    Registry.RegisterMethod(TEXT("get_actor_components"), this, &FUnrealMCPEditorCommands::HandleGetActorComponents, Category);
+    Registry.RegisterMethod(TEXT("set_actor_component_property"), this, &FUnrealMCPEditorCommands::HandleSetActorComponentProperty, Category);
+
+    // Spatial queries
+    Registry.RegisterMethod(TEXT("query_actors_in_sphere"), this, &FUnrealMCPEditorCommands::HandleQueryActorsInSphere, Category);
+    Registry.RegisterMethod(TEXT("query_actors_in_box"), this, &FUnrealMCPEditorCommands::HandleQueryActorsInBox, Category);
+    Registry.RegisterMethod(TEXT("query_actors_in_frustum"), this, &FUnrealMCPEditorCommands::HandleQueryActorsInFrustum, Category);
+
+    // Blueprint actor spawning
+    Registry.RegisterMethod(TEXT("spawn_blueprint_actor"), this, &FUnrealMCPEditorCommands::HandleSpawnBlueprintActor, Category);
+
+    // Editor viewport commands
+    Registry.RegisterMethod(TEXT("focus_viewport"), this, &FUnrealMCPEditorCommands::HandleFocusViewport, Category);
+    Registry.RegisterMethod(TEXT("take_screenshot"), this, &FUnrealMCPEditorCommands::HandleTakeScreenshot, Category);
+
+    // Save commands
+    for (const TCHAR* SaveCommand : {TEXT("save_all"), TEXT("save_current_level")})
     {
-        return HandleGetActorsInLevel(Params);
+        Registry.RegisterCommand(SaveCommand, [this](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+        {
+            return HandleSaveAll(Params, Context);
+        }, Category);
     }
-    else if (CommandType == TEXT("find_actors_by_name"))
+}
+
+bool FUnrealMCPEditorCommands::FActorFilter::Matches(AActor* Actor) const
+{
+    if (bClassFilter)
     {
-        return HandleFindActorsByName(Params);
+        bool bClassMatches = false;
+        for (UClass* Class = Actor->GetClass(); Class && !bClassMatches; Class = Class->GetSuperClass())
+        {
+            bClassMatches = ClassNames.Contains(Class->GetFName());
+        }
+        if (!bClassMatches)
+        {
+            return false;
+        }
     }
-    else if (CommandType == TEXT("spawn_actor") || CommandType == TEXT("create_actor"))
+
+    if (Levels.Num() > 0 && !Levels.Contains(Actor->GetLevel()))
+    {
+        return false;
+    }
+
+    if (bTagFilter && (Tag.IsNone() || !Actor->ActorHasTag(Tag)))
     {
-        if (CommandType == TEXT("create_actor"))
+        return false;
+    }
+
+    if (!Folder.IsEmpty())
+    {
+        const FString ActorFolder = Actor->GetFolderPath().ToString();
+        if (!ActorFolder.StartsWith(Folder) || (ActorFolder.Len() > Folder.Len() && ActorFolder[Folder.Len()] != TEXT('/')))
         {
-            UE_LOG(LogTemp, Warning, TEXT("'create_actor' command is deprecated and will be removed in a future version. Please use 'spawn_actor' instead."));
+            return false;
         }
-        return HandleSpawnActor(Params);
     }
-    else if (CommandType == TEXT("delete_actor"))
+
+    return !Bounds.IsSet() || Bounds->IsInsideOrOn(Actor->GetActorLocation());
+}
+
+bool FUnrealMCPEditorCommands::ParseActorFilter(const TSharedPtr<FJsonObject>& Params, UWorld* World, FActorFilter& OutFilter, FString& OutError)
+{
+    FString ClassName;
+    if (Params->TryGetStringField(TEXT("class"), ClassName) && !ClassName.IsEmpty())
     {
-        return HandleDeleteActor(Params);
+        // Blueprint classes may be given without their _C. A name that was never used can't be any class's.
+        OutFilter.bClassFilter = true;
+        for (const FString& Candidate : {ClassName, ClassName + TEXT("_C")})
+        {
+            const FName Name(*Candidate, FNAME_Find);
+            if (!Name.IsNone())
+            {
+                OutFilter.ClassNames.Add(Name);
+            }
+        }
     }
-    else if (CommandType == TEXT("set_actor_transform"))
+
+    // As with classes, FNAME_Find keeps request strings out of the name table
+    FString Tag;
+    if (Params->TryGetStringField(TEXT("tag"), Tag) && !Tag.IsEmpty())
     {
-        return HandleSetActorTransform(Params);
+        OutFilter.bTagFilter = true;
+        OutFilter.Tag = FName(*Tag, FNAME_Find);
     }
-    else if (CommandType == TEXT("get_actor_properties"))
+
+    if (Params->TryGetStringField(TEXT("folder"), OutFilter.Folder))
     {
-        return HandleGetActorProperties(Params);
+        OutFilter.Folder.RemoveFromStart(TEXT("/"));
+        OutFilter.Folder.RemoveFromEnd(TEXT("/"));
     }
-    else if (CommandType == TEXT("set_actor_property"))
+
+    // A level by package path or map name, e.g. /Game/Maps/Forest or Forest
+    FString LevelName;
+    if (Params->TryGetStringField(TEXT("level"), LevelName) && !LevelName.IsEmpty())
     {
-        return HandleSetActorProperty(Params);
+        for (ULevel* Level : World->GetLevels())
+        {
+            const FString PackageName = Level ? Level->GetPackage()->GetName() : FString();
+            if (Level && (PackageName.Equals(LevelName) || FPackageName::GetShortName(PackageName).Equals(LevelName)))
+            {
+                OutFilter.Levels.Add(Level);
+            }
+        }
+        if (OutFilter.Levels.Num() == 0)
+        {
+            OutError = FString::Printf(TEXT("Level not loaded in the current world: %s"), *LevelName);
+            return false;
+        }
     }
-    else if (CommandType == TEXT("get_actor_components"))
+
+    const TSharedPtr<FJsonObject>* BoundsObject = nullptr;
+    if (Params->TryGetObjectField(TEXT("bounds"), BoundsObject))
     {
-        return HandleGetActorComponents(Params);
+        if (!(*BoundsObject)->HasField(TEXT("min")) || !(*BoundsObject)->HasField(TEXT("max")))
+        {
+            OutError = TEXT("'bounds' needs 'min' and 'max'");
+            return false;
+        }
+        const FVector Min = FUnrealMCPCommonUtils::GetVectorFromJson(*BoundsObject, TEXT("min"));
+        const FVector Max = FUnrealMCPCommonUtils::GetVectorFromJson(*BoundsObject, TEXT("max"));
+        OutFilter.Bounds = FBox(Min.ComponentMin(Max), Min.ComponentMax(Max));
     }
-    else if (CommandType == TEXT("set_actor_component_property"))
+    return true;
+}
+
+TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleGetActorsInLevel(const TSharedPtr<FJsonObject>& Params)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleGetActorsInLevel);
+
+    UWorld* World = GWorld;
+    if (!World)
     {
-        return HandleSetActorComponentProperty(Params);
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("No world is open"));
     }
-    // Blueprint actor spawning
-    else if (CommandType == TEXT("spawn_blueprint_actor"))
+
+    FActorFilter Filter;
+    FString Error;
+    if (!ParseActorFilter(Params, World, Filter, Error))
     {
-        return HandleSpawnBlueprintActor(Params);
+        return FUnrealMCPCommonUtils::CreateErrorResponse(Error);
     }
-    // Editor viewport commands
-    else if (CommandType == TEXT("focus_viewport"))
+
+    // Only the fields asked for, everything ActorToJson gives by default
+    TArray<FString> Fields;
+    const TArray<TSharedPtr<FJsonValue>>* FieldArray = nullptr;
+    if (Params->TryGetArrayField(TEXT("fields"), FieldArray))
     {
-        return HandleFocusViewport(Params);
+        for (const TSharedPtr<FJsonValue>& Value : *FieldArray)
+        {
+            const FString Field = Value->AsString();
+            if (!FUnrealMCPCommonUtils::GetActorJsonFields().Contains(Field))
+            {
+                return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Unknown field '%s', expected one of: %s"),
+                    *Field, *FString::Join(FUnrealMCPCommonUtils::GetActorJsonFields(), TEXT(", "))));
+            }
+            Fields.AddUnique(Field);
+        }
     }
-    else if (CommandType == TEXT("take_screenshot"))
+
+    int32 PageSize = DefaultActorPageSize;
+    Params->TryGetNumberField(TEXT("page_size"), PageSize);
+    PageSize = FMath::Clamp(PageSize, 1, MaxActorPageSize);
+
+    // Actors are listed by name, then level, and the cursor is the last one sent. The next page
+    // starts right after it, so actors added or removed in between don't shift the pages.
+    FName CursorName;
+    FName CursorLevel;
+    FString Cursor;
+    const bool bHasCursor = Params->TryGetStringField(TEXT("cursor"), Cursor) && !Cursor.IsEmpty();
+    if (bHasCursor)
     {
-        return HandleTakeScreenshot(Params);
+        FString NamePart;
+        FString LevelPart;
+        if (!Cursor.Split(TEXT("|"), &NamePart, &LevelPart))
+        {
+            return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Invalid cursor: %s"), *Cursor));
+        }
+        // Both were names of a listed actor and its level, so they are in the name table unless the cursor was made up
+        CursorName = FName(*NamePart, FNAME_Find);
+        CursorLevel = FName(*LevelPart, FNAME_Find);
+        if (CursorName.IsNone() || CursorLevel.IsNone())
+        {
+            return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Invalid cursor: %s"), *Cursor));
+        }
     }
-    // Save commands
-    else if (CommandType == TEXT("save_all") || CommandType == TEXT("save_current_level"))
+
+    struct FListedActor
+    {
+        AActor* Actor;
+        FName Name;
+        FName Level;
+    };
+    auto IsBefore = [](FName NameA, FName LevelA, FName NameB, FName LevelB)
+    {
+        const int32 NameOrder = NameA.Compare(NameB);
+        return NameOrder != 0 ? NameOrder < 0 : LevelA.Compare(LevelB) < 0;
+    };
+    auto IsAfter = [&IsBefore](const FListedActor& A, const FListedActor& B)
+    {
+        return IsBefore(B.Name, B.Level, A.Name, A.Level);
+    };
+
+    // Every page still scans the level, but only keeps the page and one more actor, to tell whether
+    // there is a next page. They are held in a heap whose top is the last of them, replaced whenever
+    // an earlier actor turns up, so a page costs O(actors * log page_size) instead of sorting them all.
+    const int32 KeepCount = PageSize + 1;
+    TArray<FListedActor> Listed;
+    Listed.Reserve(KeepCount + 1);
+    int32 TotalCount = 0;
+    const TArray<ULevel*>& Levels = Filter.Levels.Num() > 0 ? Filter.Levels : World->GetLevels();
+    for (ULevel* Level : Levels)
     {
-        return HandleSaveAll(Params);
+        if (!Level)
+        {
+            continue;
+        }
+        const FName LevelName = Level->GetPackage()->GetFName();
+        for (AActor* Actor : Level->Actors)
+        {
+            if (!IsValid(Actor) || !Filter.Matches(Actor))
+            {
+                continue;
+            }
+            ++TotalCount;
+            const FListedActor Entry = {Actor, Actor->GetFName(), LevelName};
+            if ((bHasCursor && !IsBefore(CursorName, CursorLevel, Entry.Name, Entry.Level))
+                || (Listed.Num() == KeepCount && !IsAfter(Listed.HeapTop(), Entry)))
+            {
+                continue;
+            }
+            Listed.HeapPush(Entry, IsAfter);
+            if (Listed.Num() > KeepCount)
+            {
+                Listed.HeapPopDiscard(IsAfter, EAllowShrinking::No);
+            }
+        }
     }
-    
-    return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Unknown editor command: %s"), *CommandType));
+
+    Listed.Sort([&IsBefore](const FListedActor& A, const FListedActor& B)
+    {
+        return IsBefore(A.Name, A.Level, B.Name, B.Level);
+    });
+
+    const int32 PageCount = FMath::Min(PageSize, Listed.Num());
+    TArray<TSharedPtr<FJsonValue>> ActorArray;
+    ActorArray.Reserve(PageCount);
+    for (int32 Index = 0; Index < PageCount; ++Index)
+    {
+        AActor* Actor = Listed[Index].Actor;
+        ActorArray.Add(Fields.Num() > 0 ? FUnrealMCPCommonUtils::ActorToJson(Actor, Fields) : FUnrealMCPCommonUtils::ActorToJson(Actor));
+    }
+
+    TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
+    ResultObj->SetArrayField(TEXT("actors"), ActorArray);
+    ResultObj->SetNumberField(TEXT("count"), PageCount);
+    ResultObj->SetNumberField(TEXT("total"), TotalCount);
+    if (Listed.Num() > PageCount)
+    {
+        const FListedActor& Last = Listed[PageCount - 1];
+        ResultObj->SetStringField(TEXT("next_cursor"), Last.Name.ToString() + TEXT("|") + Last.Level.ToString());
+    }
+
+    return ResultObj;
 }
 
-TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleGetActorsInLevel(const TSharedPtr<FJsonObject>& Params)
+TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::QueryActors(const TSharedPtr<FJsonObject>& Params, UWorld* World, const FBox& SearchBox, const FVector& Origin, TFunctionRef<bool(const FBox&)> Overlaps)
 {
-    TArray<AActor*> AllActors;
-    UGameplayStatics::GetAllActorsOfClass(GWorld, AActor::StaticClass(), AllActors);
-    
-    TArray<TSharedPtr<FJsonValue>> ActorArray;
-    for (AActor* Actor : AllActors)
+    FActorFilter Filter;
+    FString Error;
+    if (!ParseActorFilter(Params, World, Filter, Error))
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(Error);
+    }
+
+    // Whether any part of the actor must be in the shape, or its location
+    FString Test = TEXT("bounds");
+    Params->TryGetStringField(TEXT("test"), Test);
+    if (Test != TEXT("bounds") && Test != TEXT("location"))
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Unknown test '%s', expected 'bounds' or 'location'"), *Test));
+    }
+    const bool bTestLocation = Test == TEXT("location");
+
+    int32 Limit = DefaultActorPageSize;
+    Params->TryGetNumberField(TEXT("limit"), Limit);
+    Limit = FMath::Clamp(Limit, 1, MaxActorPageSize);
+
+    TArray<AActor*> Candidates;
+    ActorIndex.FindActorsInBox(World, SearchBox, Candidates);
+
+    // The index may lag behind an actor that moved without telling the editor, so test where it is now
+    struct FFoundActor
     {
-        if (Actor)
+        AActor* Actor;
+        double DistanceSquared;
+    };
+    TArray<FFoundActor> Found;
+    for (AActor* Actor : Candidates)
+    {
+        if (!Filter.Matches(Actor))
+        {
+            continue;
+        }
+        const FVector Location = Actor->GetActorLocation();
+        if (Overlaps(bTestLocation ? FBox(Location, Location) : FMCPActorIndex::GetActorBounds(Actor)))
         {
-            ActorArray.Add(FUnrealMCPCommonUtils::ActorToJson(Actor));
+            Found.Add({Actor, FVector::DistSquared(Origin, Location)});
         }
     }
-    
+
+    Found.Sort([](const FFoundActor& A, const FFoundActor& B)
+    {
+        return A.DistanceSquared < B.DistanceSquared;
+    });
+
+    const int32 Count = FMath::Min(Limit, Found.Num());
+    TArray<TSharedPtr<FJsonValue>> ActorArray;
+    ActorArray.Reserve(Count);
+    for (int32 Index = 0; Index < Count; ++Index)
+    {
+        ActorArray.Add(FUnrealMCPCommonUtils::ActorToJson(Found[Index].Actor));
+    }
+
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
     ResultObj->SetArrayField(TEXT("actors"), ActorArray);
-    
+    ResultObj->SetNumberField(TEXT("count"), Count);
+    ResultObj->SetNumberField(TEXT("total"), Found.Num());
+    ResultObj->SetBoolField(TEXT("truncated"), Found.Num() > Count);
     return ResultObj;
 }
 
+TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleQueryActorsInSphere(const TSharedPtr<FJsonObject>& Params)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleQueryActorsInSphere);
+
+    UWorld* World = GWorld;
+    if (!World)
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("No world is open"));
+    }
+
+    if (!Params->HasField(TEXT("center")))
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Missing 'center' parameter"));
+    }
+    double Radius = 0.0;
+    if (!Params->TryGetNumberField(TEXT("radius"), Radius) || Radius <= 0.0)
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Missing or invalid 'radius' parameter"));
+    }
+
+    const FVector Center = FUnrealMCPCommonUtils::GetVectorFromJson(Params, TEXT("center"));
+    const double RadiusSquared = Radius * Radius;
+    const FBox SearchBox(Center - FVector(Radius), Center + FVector(Radius));
+    return QueryActors(Params, World, SearchBox, Center, [&Center, RadiusSquared](const FBox& Bounds)
+    {
+        return FMath::SphereAABBIntersection(Center, RadiusSquared, Bounds);
+    });
+}
+
+TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleQueryActorsInBox(const TSharedPtr<FJsonObject>& Params)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleQueryActorsInBox);
+
+    UWorld* World = GWorld;
+    if (!World)
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("No world is open"));
+    }
+
+    if (!Params->HasField(TEXT("min")) || !Params->HasField(TEXT("max")))
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Missing 'min' or 'max' parameter"));
+    }
+
+    const FVector Min = FUnrealMCPCommonUtils::GetVectorFromJson(Params, TEXT("min"));
+    const FVector Max = FUnrealMCPCommonUtils::GetVectorFromJson(Params, TEXT("max"));
+    const FBox Box(Min.ComponentMin(Max), Min.ComponentMax(Max));
+    return QueryActors(Params, World, Box, Box.GetCenter(), [&Box](const FBox& Bounds)
+    {
+        return Box.Intersect(Bounds);
+    });
+}
+
+TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleQueryActorsInFrustum(const TSharedPtr<FJsonObject>& Params)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleQueryActorsInFrustum);
+
+    UWorld* World = GWorld;
+    if (!World)
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("No world is open"));
+    }
+
+    // An explicit camera, or the one of the level viewport last used
+    FVector Origin = FVector::ZeroVector;
+    FRotator Rotation = FRotator::ZeroRotator;
+    double FovDegrees = 90.0;
+    double AspectRatio = 16.0 / 9.0;
+    if (Params->HasField(TEXT("origin")))
+    {
+        Origin = FUnrealMCPCommonUtils::GetVectorFromJson(Params, TEXT("origin"));
+        if (Params->HasField(TEXT("rotation")))
+        {
+            Rotation = FUnrealMCPCommonUtils::GetRotatorFromJson(Params, TEXT("rotation"));
+        }
+    }
+    else
+    {
+        FLevelEditorViewportClient* ViewportClient = GCurrentLevelEditingViewportClient;
+        if (!ViewportClient)
+        {
+            return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("No 'origin' given and no level viewport to take the camera from"));
+        }
+        Origin = ViewportClient->GetViewLocation();
+        Rotation = ViewportClient->GetViewRotation();
+        FovDegrees = ViewportClient->ViewFOV;
+        if (ViewportClient->Viewport && ViewportClient->Viewport->GetSizeXY().Y > 0)
+        {
+            const FIntPoint Size = ViewportClient->Viewport->GetSizeXY();
+            AspectRatio = (double)Size.X / Size.Y;
+        }
+    }
+
+    double Near = 0.0;
+    double Far = 100000.0;
+    Params->TryGetNumberField(TEXT("fov"), FovDegrees);
+    Params->TryGetNumberField(TEXT("aspect_ratio"), AspectRatio);
+    Params->TryGetNumberField(TEXT("near"), Near);
+    Params->TryGetNumberField(TEXT("far"), Far);
+    if (FovDegrees <= 0.0 || FovDegrees >= 180.0 || AspectRatio <= 0.0 || Near < 0.0 || Far <= Near)
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Invalid frustum: 'fov' must be between 0 and 180 degrees, 'aspect_ratio' positive and 'far' beyond 'near'"));
+    }
+
+    const FRotationMatrix Axes(Rotation);
+    const FVector Forward = Axes.GetScaledAxis(EAxis::X);
+    const FVector Right = Axes.GetScaledAxis(EAxis::Y);
+    const FVector Up = Axes.GetScaledAxis(EAxis::Z);
+    const double HalfWidthAngle = FMath::DegreesToRadians(FovDegrees * 0.5);
+    const double HalfHeightAngle = FMath::Atan(FMath::Tan(HalfWidthAngle) / AspectRatio);
+
+    // Side planes through the apex, then near and far, all facing out as FConvexVolume expects
+    FConvexVolume Frustum;
+    Frustum.Planes.Add(FPlane(Origin, Right * FMath::Cos(HalfWidthAngle) - Forward * FMath::Sin(HalfWidthAngle)));
+    Frustum.Planes.Add(FPlane(Origin, -Right * FMath::Cos(HalfWidthAngle) - Forward * FMath::Sin(HalfWidthAngle)));
+    Frustum.Planes.Add(FPlane(Origin, Up * FMath::Cos(HalfHeightAngle) - Forward * FMath::Sin(HalfHeightAngle)));
+    Frustum.Planes.Add(FPlane(Origin, -Up * FMath::Cos(HalfHeightAngle) - Forward * FMath::Sin(HalfHeightAngle)));
+    Frustum.Planes.Add(FPlane(Origin + Forward * Near, -Forward));
+    Frustum.Planes.Add(FPlane(Origin + Forward * Far, Forward));
+    Frustum.Init();
+
+    // The octree is searched with the box around the apex and the far corners
+    const FVector FarCenter = Origin + Forward * Far;
+    const FVector FarRight = Right * (Far * FMath::Tan(HalfWidthAngle));
+    const FVector FarUp = Up * (Far * FMath::Tan(HalfHeightAngle));
+    FBox SearchBox(Origin, Origin);
+    SearchBox += FarCenter + FarRight + FarUp;
+    SearchBox += FarCenter + FarRight - FarUp;
+    SearchBox += FarCenter - FarRight + FarUp;
+    SearchBox += FarCenter - FarRight - FarUp;
+
+    return QueryActors(Params, World, SearchBox, Origin, [&Frustum](const FBox& Bounds)
+    {
+        return Frustum.IntersectBox(Bounds.GetCenter(), Bounds.GetExtent());
+    });
+}
+
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleFindActorsByName(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleFindActorsByName);
+
     FString Pattern;
     if (!Params->TryGetStringField(TEXT("pattern"), Pattern))
     {
@@ -152,6 +562,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleFindActorsByName(const T
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSpawnActor(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleSpawnActor);
+
     // Get required parameters
     FString ActorType;
     if (!Params->TryGetStringField(TEXT("type"), ActorType))
@@ -194,14 +606,9 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSpawnActor(const TShared
     }
 
     // Check if an actor with this name already exists
-    TArray<AActor*> AllActors;
-    UGameplayStatics::GetAllActorsOfClass(World, AActor::StaticClass(), AllActors);
-    for (AActor* Actor : AllActors)
+    if (ActorIndex.FindActor(World, ActorName))
     {
-        if (Actor && Actor->GetName() == ActorName)
-        {
-            return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Actor with name '%s' already exists"), *ActorName));
-        }
+        return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Actor with name '%s' already exists"), *ActorName));
     }
 
     FActorSpawnParameters SpawnParams;
@@ -266,6 +673,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSpawnActor(const TShared
         FTransform Transform = NewActor->GetTransform();
         Transform.SetScale3D(Scale);
         NewActor->SetActorTransform(Transform);
+        ActorIndex.UpdateActor(NewActor);
 
         // Return the created actor's details
         return FUnrealMCPCommonUtils::ActorToJsonObject(NewActor, true);
@@ -276,36 +684,34 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSpawnActor(const TShared
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleDeleteActor(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleDeleteActor);
+
     FString ActorName;
     if (!Params->TryGetStringField(TEXT("name"), ActorName))
     {
         return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Missing 'name' parameter"));
     }
 
-    TArray<AActor*> AllActors;
-    UGameplayStatics::GetAllActorsOfClass(GWorld, AActor::StaticClass(), AllActors);
-    
-    for (AActor* Actor : AllActors)
+    if (AActor* Actor = ActorIndex.FindActor(GWorld, ActorName))
     {
-        if (Actor && Actor->GetName() == ActorName)
-        {
-            // Store actor info before deletion for the response
-            TSharedPtr<FJsonObject> ActorInfo = FUnrealMCPCommonUtils::ActorToJsonObject(Actor);
-            
-            // Delete the actor
-            Actor->Destroy();
-            
-            TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
-            ResultObj->SetObjectField(TEXT("deleted_actor"), ActorInfo);
-            return ResultObj;
-        }
+        // Store actor info before deletion for the response
+        TSharedPtr<FJsonObject> ActorInfo = FUnrealMCPCommonUtils::ActorToJsonObject(Actor);
+
+        // Delete the actor
+        Actor->Destroy();
+
+        TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
+        ResultObj->SetObjectField(TEXT("deleted_actor"), ActorInfo);
+        return ResultObj;
     }
-    
+
     return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Actor not found: %s"), *ActorName));
 }
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorTransform(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleSetActorTransform);
+
     // Get actor name
     FString ActorName;
     if (!Params->TryGetStringField(TEXT("name"), ActorName))
@@ -314,18 +720,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorTransform(const
     }
 
     // Find the actor
-    AActor* TargetActor = nullptr;
-    TArray<AActor*> AllActors;
-    UGameplayStatics::GetAllActorsOfClass(GWorld, AActor::StaticClass(), AllActors);
-    
-    for (AActor* Actor : AllActors)
-    {
-        if (Actor && Actor->GetName() == ActorName)
-        {
-            TargetActor = Actor;
-            break;
-        }
-    }
+    AActor* TargetActor = ActorIndex.FindActor(GWorld, ActorName);
 
     if (!TargetActor)
     {
@@ -350,6 +745,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorTransform(const
 
     // Set the new transform
     TargetActor->SetActorTransform(NewTransform);
+    ActorIndex.UpdateActor(TargetActor);
 
     // Return updated actor info
     return FUnrealMCPCommonUtils::ActorToJsonObject(TargetActor, true);
@@ -357,6 +753,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorTransform(const
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleGetActorProperties(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleGetActorProperties);
+
     // Get actor name
     FString ActorName;
     if (!Params->TryGetStringField(TEXT("name"), ActorName))
@@ -365,18 +763,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleGetActorProperties(const
     }
 
     // Find the actor
-    AActor* TargetActor = nullptr;
-    TArray<AActor*> AllActors;
-    UGameplayStatics::GetAllActorsOfClass(GWorld, AActor::StaticClass(), AllActors);
-    
-    for (AActor* Actor : AllActors)
-    {
-        if (Actor && Actor->GetName() == ActorName)
-        {
-            TargetActor = Actor;
-            break;
-        }
-    }
+    AActor* TargetActor = ActorIndex.FindActor(GWorld, ActorName);
 
     if (!TargetActor)
     {
@@ -389,6 +776,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleGetActorProperties(const
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorProperty(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleSetActorProperty);
+
     // Get actor name
     FString ActorName;
     if (!Params->TryGetStringField(TEXT("name"), ActorName))
@@ -397,18 +786,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorProperty(const T
     }
 
     // Find the actor
-    AActor* TargetActor = nullptr;
-    TArray<AActor*> AllActors;
-    UGameplayStatics::GetAllActorsOfClass(GWorld, AActor::StaticClass(), AllActors);
-    
-    for (AActor* Actor : AllActors)
-    {
-        if (Actor && Actor->GetName() == ActorName)
-        {
-            TargetActor = Actor;
-            break;
-        }
-    }
+    AActor* TargetActor = ActorIndex.FindActor(GWorld, ActorName);
 
     if (!TargetActor)
     {
@@ -443,6 +821,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorProperty(const T
                 if (MeshComponent)
                 {
                     MeshComponent->SetStaticMesh(Mesh);
+                    ActorIndex.UpdateActor(MeshActor);
 
                     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
                     ResultObj->SetStringField(TEXT("actor"), ActorName);
@@ -540,6 +919,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorProperty(const T
     FString ErrorMessage;
     if (FUnrealMCPCommonUtils::SetObjectProperty(TargetActor, PropertyName, PropertyValue, ErrorMessage))
     {
+        ActorIndex.UpdateActor(TargetActor);
+
         // Property set successfully
         TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
         ResultObj->SetStringField(TEXT("actor"), ActorName);
@@ -558,6 +939,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorProperty(const T
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleGetActorComponents(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleGetActorComponents);
+
     // Get actor name
     FString ActorName;
     if (!Params->TryGetStringField(TEXT("name"), ActorName))
@@ -566,18 +949,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleGetActorComponents(const
     }
 
     // Find the actor
-    AActor* TargetActor = nullptr;
-    TArray<AActor*> AllActors;
-    UGameplayStatics::GetAllActorsOfClass(GWorld, AActor::StaticClass(), AllActors);
-    
-    for (AActor* Actor : AllActors)
-    {
-        if (Actor && Actor->GetName() == ActorName)
-        {
-            TargetActor = Actor;
-            break;
-        }
-    }
+    AActor* TargetActor = ActorIndex.FindActor(GWorld, ActorName);
 
     if (!TargetActor)
     {
@@ -623,6 +995,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleGetActorComponents(const
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorComponentProperty(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleSetActorComponentProperty);
+
     // Get actor name
     FString ActorName;
     if (!Params->TryGetStringField(TEXT("name"), ActorName))
@@ -652,18 +1026,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorComponentPropert
     TSharedPtr<FJsonValue> PropertyValue = Params->Values.FindRef(TEXT("property_value"));
 
     // Find the actor
-    AActor* TargetActor = nullptr;
-    TArray<AActor*> AllActors;
-    UGameplayStatics::GetAllActorsOfClass(GWorld, AActor::StaticClass(), AllActors);
-    
-    for (AActor* Actor : AllActors)
-    {
-        if (Actor && Actor->GetName() == ActorName)
-        {
-            TargetActor = Actor;
-            break;
-        }
-    }
+    AActor* TargetActor = ActorIndex.FindActor(GWorld, ActorName);
 
     if (!TargetActor)
     {
@@ -892,6 +1255,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorComponentPropert
     FString ErrorMessage;
     if (FUnrealMCPCommonUtils::SetObjectProperty(TargetComponent, PropertyName, PropertyValue, ErrorMessage))
     {
+        ActorIndex.UpdateActor(TargetActor);
+
         TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
         ResultObj->SetStringField(TEXT("actor"), ActorName);
         ResultObj->SetStringField(TEXT("component"), TargetComponent->GetName());
@@ -907,6 +1272,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSetActorComponentPropert
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSpawnBlueprintActor(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleSpawnBlueprintActor);
+
     // Get required parameters
     FString BlueprintName;
     if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -973,6 +1340,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSpawnBlueprintActor(cons
     FActorSpawnParameters SpawnParams;
     SpawnParams.Name = *ActorName;
 
+    FMCPTransaction::EnsureCompiled(Blueprint);
     AActor* NewActor = World->SpawnActor<AActor>(Blueprint->GeneratedClass, SpawnTransform, SpawnParams);
     if (NewActor)
     {
@@ -984,6 +1352,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSpawnBlueprintActor(cons
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleFocusViewport(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleFocusViewport);
+
     // Get target actor name if provided
     FString TargetActorName;
     bool HasTargetActor = Params->TryGetStringField(TEXT("target"), TargetActorName);
@@ -1024,18 +1394,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleFocusViewport(const TSha
     if (HasTargetActor)
     {
         // Find the actor
-        AActor* TargetActor = nullptr;
-        TArray<AActor*> AllActors;
-        UGameplayStatics::GetAllActorsOfClass(GWorld, AActor::StaticClass(), AllActors);
-        
-        for (AActor* Actor : AllActors)
-        {
-            if (Actor && Actor->GetName() == TargetActorName)
-            {
-                TargetActor = Actor;
-                break;
-            }
-        }
+        AActor* TargetActor = ActorIndex.FindActor(GWorld, TargetActorName);
 
         if (!TargetActor)
         {
@@ -1071,6 +1430,8 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleFocusViewport(const TSha
 
 TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleTakeScreenshot(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleTakeScreenshot);
+
     // Get file path parameter
     FString FilePath;
     if (!Params->TryGetStringField(TEXT("filepath"), FilePath))
@@ -1108,8 +1469,10 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleTakeScreenshot(const TSh
     return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Failed to take screenshot"));
 }
 
-TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSaveAll(const TSharedPtr<FJsonObject>& Params)
+TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSaveAll(const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPEditorCommands::HandleSaveAll);
+
     // Get the current world
     UWorld* World = GEditor ? GEditor->GetEditorWorldContext().World() : nullptr;
     if (!World)
@@ -1120,6 +1483,7 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSaveAll(const TSharedPtr
     // Track what we saved
     TArray<FString> SavedItems;
     bool bSuccess = true;
+    bool bCancelled = false;
 
     // Save the current level using FEditorFileUtils
     ULevel* CurrentLevel = World->GetCurrentLevel();
@@ -1147,8 +1511,18 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSaveAll(const TSharedPtr
     FEditorFileUtils::GetDirtyContentPackages(PackagesToSave);
     FEditorFileUtils::GetDirtyWorldPackages(PackagesToSave);
 
-    for (UPackage* Package : PackagesToSave)
+    for (int32 PackageIndex = 0; PackageIndex < PackagesToSave.Num(); ++PackageIndex)
     {
+        // Stop between packages if the client gave up, what is saved so far stays saved
+        if (Context.IsCancelled())
+        {
+            bCancelled = true;
+            break;
+        }
+
+        UPackage* Package = PackagesToSave[PackageIndex];
+        Context.ReportProgress(TEXT("save"), PackageIndex, PackagesToSave.Num(), Package ? Package->GetName() : FString());
+
         if (Package && Package->IsDirty())
         {
             FString PackageFileName;
@@ -1164,6 +1538,11 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSaveAll(const TSharedPtr
         }
     }
 
+    if (!bCancelled)
+    {
+        Context.ReportProgress(TEXT("save"), PackagesToSave.Num(), PackagesToSave.Num());
+    }
+
     // Build response
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
     ResultObj->SetBoolField(TEXT("success"), bSuccess);
@@ -1176,7 +1555,12 @@ TSharedPtr<FJsonObject> FUnrealMCPEditorCommands::HandleSaveAll(const TSharedPtr
     }
     ResultObj->SetArrayField(TEXT("saved_items"), SavedArray);
 
-    if (SavedItems.Num() == 0)
+    if (bCancelled)
+    {
+        ResultObj->SetBoolField(TEXT("cancelled"), true);
+        ResultObj->SetStringField(TEXT("message"), FString::Printf(TEXT("Cancelled after saving %d item(s)"), SavedItems.Num()));
+    }
+    else if (SavedItems.Num() == 0)
     {
         ResultObj->SetStringField(TEXT("message"), TEXT("No dirty packages to save"));
     }
@@ -1,51 +1,41 @@
 #include "Commands/UnrealMCPProjectCommands.h"
 #include "Commands/UnrealMCPCommonUtils.h"
+#include "MCPTransaction.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 #include "GameFramework/InputSettings.h"
 #include "InputAction.h"
 #include "InputMappingContext.h"
 #include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/ARFilter.h"
 #include "UObject/SavePackage.h"
 
 FUnrealMCPProjectCommands::FUnrealMCPProjectCommands()
 {
 }
 
-TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params)
+void FUnrealMCPProjectCommands::RegisterCommands(FMCPCommandRegistry& Registry)
 {
-    if (CommandType == TEXT("create_input_mapping"))
-    {
-        return HandleCreateInputMapping(Params);
-    }
-    else if (CommandType == TEXT("create_input_action"))
-    {
-        return HandleCreateInputAction(Params);
-    }
-    else if (CommandType == TEXT("create_input_mapping_context"))
-    {
-        return HandleCreateInputMappingContext(Params);
-    }
-    else if (CommandType == TEXT("add_mapping_to_context"))
-    {
-        return HandleAddMappingToContext(Params);
-    }
-    else if (CommandType == TEXT("remove_mapping_from_context"))
-    {
-        return HandleRemoveMappingFromContext(Params);
-    }
-    else if (CommandType == TEXT("get_input_actions"))
-    {
-        return HandleGetInputActions(Params);
-    }
-    else if (CommandType == TEXT("get_input_mapping_contexts"))
-    {
-        return HandleGetInputMappingContexts(Params);
-    }
+    const FName Category(TEXT("project"));
+
+    // Legacy input mapping (deprecated)
+    Registry.RegisterMethod(TEXT("create_input_mapping"), this, &FUnrealMCPProjectCommands::HandleCreateInputMapping, Category);
 
-    return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Unknown project command: %s"), *CommandType));
+    // Enhanced Input System
+    Registry.RegisterMethod(TEXT("create_input_action"), this, &FUnrealMCPProjectCommands::HandleCreateInputAction, Category);
+    Registry.RegisterMethod(TEXT("create_input_mapping_context"), this, &FUnrealMCPProjectCommands::HandleCreateInputMappingContext, Category);
+    Registry.RegisterMethod(TEXT("add_mapping_to_context"), this, &FUnrealMCPProjectCommands::HandleAddMappingToContext, Category);
+    Registry.RegisterMethod(TEXT("remove_mapping_from_context"), this, &FUnrealMCPProjectCommands::HandleRemoveMappingFromContext, Category);
+    Registry.RegisterMethod(TEXT("get_input_actions"), this, &FUnrealMCPProjectCommands::HandleGetInputActions, Category, EMCPCommandFlags::ThreadSafe);
+    // Loads each context to list its mappings, so it stays on the game thread
+    Registry.RegisterMethod(TEXT("get_input_mapping_contexts"), this, &FUnrealMCPProjectCommands::HandleGetInputMappingContexts, Category);
+
+    Registry.RegisterMethod(TEXT("asset_exists"), this, &FUnrealMCPProjectCommands::HandleAssetExists, Category, EMCPCommandFlags::ThreadSafe);
 }
 
 TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCreateInputMapping(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPProjectCommands::HandleCreateInputMapping);
+
     // Get required parameters
     FString ActionName;
     if (!Params->TryGetStringField(TEXT("action_name"), ActionName))
@@ -101,6 +91,8 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCreateInputMapping(cons
 
 TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCreateInputAction(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPProjectCommands::HandleCreateInputAction);
+
     // Get required parameters
     FString Name;
     if (!Params->TryGetStringField(TEXT("name"), Name))
@@ -162,10 +154,7 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCreateInputAction(const
     Package->MarkPackageDirty();
 
     // Save the package
-    FString PackageFileName = FPackageName::LongPackageNameToFilename(PackagePath, FPackageName::GetAssetPackageExtension());
-    FSavePackageArgs SaveArgs;
-    SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
-    bool bSaved = UPackage::SavePackage(Package, NewAction, *PackageFileName, SaveArgs);
+    bool bSaved = FMCPTransaction::SavePackage(Package, NewAction);
 
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
     ResultObj->SetBoolField(TEXT("success"), bSaved);
@@ -177,6 +166,8 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCreateInputAction(const
 
 TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCreateInputMappingContext(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPProjectCommands::HandleCreateInputMappingContext);
+
     // Get required parameters
     FString Name;
     if (!Params->TryGetStringField(TEXT("name"), Name))
@@ -216,10 +207,7 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCreateInputMappingConte
     Package->MarkPackageDirty();
 
     // Save the package
-    FString PackageFileName = FPackageName::LongPackageNameToFilename(PackagePath, FPackageName::GetAssetPackageExtension());
-    FSavePackageArgs SaveArgs;
-    SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
-    bool bSaved = UPackage::SavePackage(Package, NewIMC, *PackageFileName, SaveArgs);
+    bool bSaved = FMCPTransaction::SavePackage(Package, NewIMC);
 
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
     ResultObj->SetBoolField(TEXT("success"), bSaved);
@@ -230,6 +218,8 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleCreateInputMappingConte
 
 TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleAddMappingToContext(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPProjectCommands::HandleAddMappingToContext);
+
     // Get required parameters
     FString ContextName;
     if (!Params->TryGetStringField(TEXT("context_name"), ContextName))
@@ -325,10 +315,7 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleAddMappingToContext(con
     UPackage* Package = IMC->GetOutermost();
     if (Package)
     {
-        FString PackageFileName = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
-        FSavePackageArgs SaveArgs;
-        SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
-        UPackage::SavePackage(Package, IMC, *PackageFileName, SaveArgs);
+        FMCPTransaction::SavePackage(Package, IMC);
     }
 
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
@@ -341,6 +328,8 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleAddMappingToContext(con
 
 TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleRemoveMappingFromContext(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPProjectCommands::HandleRemoveMappingFromContext);
+
     // Get required parameters
     FString ContextName;
     if (!Params->TryGetStringField(TEXT("context_name"), ContextName))
@@ -458,10 +447,7 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleRemoveMappingFromContex
     UPackage* Package = IMC->GetOutermost();
     if (Package)
     {
-        FString PackageFileName = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
-        FSavePackageArgs SaveArgs;
-        SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
-        UPackage::SavePackage(Package, IMC, *PackageFileName, SaveArgs);
+        FMCPTransaction::SavePackage(Package, IMC);
     }
 
     TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
@@ -475,16 +461,23 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleRemoveMappingFromContex
 
 TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleGetInputActions(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPProjectCommands::HandleGetInputActions);
+
     // Get optional path filter
     FString PathFilter = TEXT("/Game");
     Params->TryGetStringField(TEXT("path"), PathFilter);
 
-    // Query asset registry
-    FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry");
+    // Query asset registry. Runs on a worker, where modules must already be loaded rather than loaded here,
+    // and where only the registry's own data may be read: enumerating objects in memory is game thread only.
+    FAssetRegistryModule& AssetRegistryModule = FModuleManager::GetModuleChecked<FAssetRegistryModule>("AssetRegistry");
     IAssetRegistry& AssetRegistry = AssetRegistryModule.Get();
 
+    FARFilter Filter;
+    Filter.ClassPaths.Add(UInputAction::StaticClass()->GetClassPathName());
+    Filter.bIncludeOnlyOnDiskAssets = true;
+
     TArray<FAssetData> AssetList;
-    AssetRegistry.GetAssetsByClass(UInputAction::StaticClass()->GetClassPathName(), AssetList);
+    AssetRegistry.GetAssets(Filter, AssetList);
 
     TArray<TSharedPtr<FJsonValue>> ActionsArray;
     for (const FAssetData& Asset : AssetList)
@@ -507,6 +500,8 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleGetInputActions(const T
 
 TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleGetInputMappingContexts(const TSharedPtr<FJsonObject>& Params)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPProjectCommands::HandleGetInputMappingContexts);
+
     // Get optional path filter
     FString PathFilter = TEXT("/Game");
     Params->TryGetStringField(TEXT("path"), PathFilter);
@@ -555,4 +550,50 @@ TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleGetInputMappingContexts
     ResultObj->SetArrayField(TEXT("input_mapping_contexts"), ContextsArray);
     ResultObj->SetNumberField(TEXT("count"), ContextsArray.Num());
     return ResultObj;
-} 
\ No newline at end of file
+} 
+
+TSharedPtr<FJsonObject> FUnrealMCPProjectCommands::HandleAssetExists(const TSharedPtr<FJsonObject>& Params)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPProjectCommands::HandleAssetExists);
+
+    FString AssetPath;
+    if (!Params->TryGetStringField(TEXT("path"), AssetPath))
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Missing 'path' parameter"));
+    }
+
+    // Accept both /Game/Dir/Asset and /Game/Dir/Asset.Asset
+    FString PackageName = AssetPath;
+    FString AssetName;
+    AssetPath.Split(TEXT("."), &PackageName, &AssetName);
+
+    TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
+    ResultObj->SetStringField(TEXT("path"), AssetPath);
+
+    // The registry keys packages by FName, so a name that was never created can't be a package
+    const FName PackageFName(*PackageName, FNAME_Find);
+    TArray<FAssetData> AssetList;
+    if (!PackageFName.IsNone())
+    {
+        // Registry data only, as in HandleGetInputActions: this runs on a worker
+        FARFilter Filter;
+        Filter.PackageNames.Add(PackageFName);
+        Filter.bIncludeOnlyOnDiskAssets = true;
+
+        FAssetRegistryModule& AssetRegistryModule = FModuleManager::GetModuleChecked<FAssetRegistryModule>("AssetRegistry");
+        AssetRegistryModule.Get().GetAssets(Filter, AssetList);
+    }
+
+    const FAssetData* Found = AssetList.FindByPredicate([&AssetName](const FAssetData& Asset)
+    {
+        return AssetName.IsEmpty() || Asset.AssetName.ToString() == AssetName;
+    });
+
+    ResultObj->SetBoolField(TEXT("exists"), Found != nullptr);
+    if (Found)
+    {
+        ResultObj->SetStringField(TEXT("name"), Found->AssetName.ToString());
+        ResultObj->SetStringField(TEXT("class"), Found->AssetClassPath.ToString());
+    }
+    return ResultObj;
+}
@@ -1,5 +1,7 @@
 #include "Commands/UnrealMCPUMGCommands.h"
 #include "Commands/UnrealMCPCommonUtils.h"
+#include "MCPTransaction.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 #include "Editor.h"
 #include "EditorAssetLibrary.h"
 #include "AssetRegistry/AssetRegistryModule.h"
@@ -30,38 +32,22 @@ FUnrealMCPUMGCommands::FUnrealMCPUMGCommands()
 {
 }
 
-TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleCommand(const FString& CommandName, const TSharedPtr<FJsonObject>& Params)
+void FUnrealMCPUMGCommands::RegisterCommands(FMCPCommandRegistry& Registry)
 {
-	if (CommandName == TEXT("create_umg_widget_blueprint"))
-	{
-		return HandleCreateUMGWidgetBlueprint(Params);
-	}
-	else if (CommandName == TEXT("add_text_block_to_widget"))
-	{
-		return HandleAddTextBlockToWidget(Params);
-	}
-	else if (CommandName == TEXT("add_widget_to_viewport"))
-	{
-		return HandleAddWidgetToViewport(Params);
-	}
-	else if (CommandName == TEXT("add_button_to_widget"))
-	{
-		return HandleAddButtonToWidget(Params);
-	}
-	else if (CommandName == TEXT("bind_widget_event"))
-	{
-		return HandleBindWidgetEvent(Params);
-	}
-	else if (CommandName == TEXT("set_text_block_binding"))
-	{
-		return HandleSetTextBlockBinding(Params);
-	}
-
-	return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("Unknown UMG command: %s"), *CommandName));
+	const FName Category(TEXT("umg"));
+
+	Registry.RegisterMethod(TEXT("create_umg_widget_blueprint"), this, &FUnrealMCPUMGCommands::HandleCreateUMGWidgetBlueprint, Category);
+	Registry.RegisterMethod(TEXT("add_text_block_to_widget"), this, &FUnrealMCPUMGCommands::HandleAddTextBlockToWidget, Category);
+	Registry.RegisterMethod(TEXT("add_widget_to_viewport"), this, &FUnrealMCPUMGCommands::HandleAddWidgetToViewport, Category);
+	Registry.RegisterMethod(TEXT("add_button_to_widget"), this, &FUnrealMCPUMGCommands::HandleAddButtonToWidget, Category);
+	Registry.RegisterMethod(TEXT("bind_widget_event"), this, &FUnrealMCPUMGCommands::HandleBindWidgetEvent, Category);
+	Registry.RegisterMethod(TEXT("set_text_block_binding"), this, &FUnrealMCPUMGCommands::HandleSetTextBlockBinding, Category);
 }
 
 TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleCreateUMGWidgetBlueprint(const TSharedPtr<FJsonObject>& Params)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPUMGCommands::HandleCreateUMGWidgetBlueprint);
+
 	// Get required parameters
 	FString BlueprintName;
 	if (!Params->TryGetStringField(TEXT("name"), BlueprintName))
@@ -117,7 +103,7 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleCreateUMGWidgetBlueprint(co
 	FAssetRegistryModule::AssetCreated(WidgetBlueprint);
 
 	// Compile the blueprint
-	FKismetEditorUtilities::CompileBlueprint(WidgetBlueprint);
+	FMCPTransaction::CompileBlueprint(WidgetBlueprint);
 
 	// Create success response
 	TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
@@ -128,6 +114,8 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleCreateUMGWidgetBlueprint(co
 
 TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddTextBlockToWidget(const TSharedPtr<FJsonObject>& Params)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPUMGCommands::HandleAddTextBlockToWidget);
+
 	// Get required parameters
 	FString BlueprintName;
 	if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -186,7 +174,7 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddTextBlockToWidget(const
 
 	// Mark the package dirty and compile
 	WidgetBlueprint->MarkPackageDirty();
-	FKismetEditorUtilities::CompileBlueprint(WidgetBlueprint);
+	FMCPTransaction::CompileBlueprint(WidgetBlueprint);
 
 	// Create success response
 	TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
@@ -197,6 +185,8 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddTextBlockToWidget(const
 
 TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddWidgetToViewport(const TSharedPtr<FJsonObject>& Params)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPUMGCommands::HandleAddWidgetToViewport);
+
 	// Get required parameters
 	FString BlueprintName;
 	if (!Params->TryGetStringField(TEXT("blueprint_name"), BlueprintName))
@@ -217,6 +207,7 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddWidgetToViewport(const T
 	Params->TryGetNumberField(TEXT("z_order"), ZOrder);
 
 	// Create widget instance
+	FMCPTransaction::EnsureCompiled(WidgetBlueprint);
 	UClass* WidgetClass = WidgetBlueprint->GeneratedClass;
 	if (!WidgetClass)
 	{
@@ -238,6 +229,8 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddWidgetToViewport(const T
 
 TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddButtonToWidget(const TSharedPtr<FJsonObject>& Params)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPUMGCommands::HandleAddButtonToWidget);
+
 	TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
 
 	// Get required parameters
@@ -311,8 +304,8 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddButtonToWidget(const TSh
 	}
 
 	// Save the Widget Blueprint
-	FKismetEditorUtilities::CompileBlueprint(WidgetBlueprint);
-	UEditorAssetLibrary::SaveAsset(BlueprintPath, false);
+	FMCPTransaction::CompileBlueprint(WidgetBlueprint);
+	FMCPTransaction::SaveAsset(WidgetBlueprint);
 
 	Response->SetBoolField(TEXT("success"), true);
 	Response->SetStringField(TEXT("widget_name"), WidgetName);
@@ -321,6 +314,8 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleAddButtonToWidget(const TSh
 
 TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleBindWidgetEvent(const TSharedPtr<FJsonObject>& Params)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPUMGCommands::HandleBindWidgetEvent);
+
 	TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
 
 	// Get required parameters
@@ -433,8 +428,8 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleBindWidgetEvent(const TShar
 	}
 
 	// Save the Widget Blueprint
-	FKismetEditorUtilities::CompileBlueprint(WidgetBlueprint);
-	UEditorAssetLibrary::SaveAsset(BlueprintPath, false);
+	FMCPTransaction::CompileBlueprint(WidgetBlueprint);
+	FMCPTransaction::SaveAsset(WidgetBlueprint);
 
 	Response->SetBoolField(TEXT("success"), true);
 	Response->SetStringField(TEXT("event_name"), EventName);
@@ -443,6 +438,8 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleBindWidgetEvent(const TShar
 
 TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleSetTextBlockBinding(const TSharedPtr<FJsonObject>& Params)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FUnrealMCPUMGCommands::HandleSetTextBlockBinding);
+
 	TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
 
 	// Get required parameters
@@ -535,8 +532,8 @@ TSharedPtr<FJsonObject> FUnrealMCPUMGCommands::HandleSetTextBlockBinding(const T
 	}
 
 	// Save the Widget Blueprint
-	FKismetEditorUtilities::CompileBlueprint(WidgetBlueprint);
-	UEditorAssetLibrary::SaveAsset(BlueprintPath, false);
+	FMCPTransaction::CompileBlueprint(WidgetBlueprint);
+	FMCPTransaction::SaveAsset(WidgetBlueprint);
 
 	Response->SetBoolField(TEXT("success"), true);
 	Response->SetStringField(TEXT("binding_name"), BindingName);
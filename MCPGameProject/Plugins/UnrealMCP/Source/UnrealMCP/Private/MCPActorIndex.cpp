@@ -0,0 +1,347 @@
+#include "MCPActorIndex.h"
+#include "Engine/Engine.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "UObject/UObjectGlobals.h"
+#include "Components/SceneComponent.h"
+#include "Editor.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// Half size of the octree's root node. Actors beyond it still go in, at the root.
+const FVector::FReal ActorOctreeExtent = 2097152.0;
+
+FMCPActorIndex::FWorldOctree::FWorldOctree()
+    : Octree(FVector::ZeroVector, ActorOctreeExtent)
+{
+}
+
+FMCPActorIndex::FMCPActorIndex()
+{
+}
+
+FMCPActorIndex::~FMCPActorIndex()
+{
+    Stop();
+}
+
+void FMCPActorIndex::Start()
+{
+    if (ActorAddedHandle.IsValid() || !GEngine)
+    {
+        return;
+    }
+
+    ActorAddedHandle = GEngine->OnLevelActorAdded().AddRaw(this, &FMCPActorIndex::OnLevelActorAdded);
+    ActorDeletedHandle = GEngine->OnLevelActorDeleted().AddRaw(this, &FMCPActorIndex::OnLevelActorDeleted);
+    ObjectRenamedHandle = FCoreUObjectDelegates::OnObjectRenamed.AddRaw(this, &FMCPActorIndex::OnObjectRenamed);
+    LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddRaw(this, &FMCPActorIndex::OnLevelChanged);
+    LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddRaw(this, &FMCPActorIndex::OnLevelChanged);
+    WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddRaw(this, &FMCPActorIndex::OnWorldCleanup);
+    ActorMovedHandle = GEngine->OnActorMoved().AddRaw(this, &FMCPActorIndex::OnActorMoved);
+    PropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(this, &FMCPActorIndex::OnObjectPropertyChanged);
+    UndoRedoHandle = FEditorDelegates::PostUndoRedo.AddRaw(this, &FMCPActorIndex::OnUndoRedo);
+}
+
+void FMCPActorIndex::Stop()
+{
+    if (!ActorAddedHandle.IsValid())
+    {
+        return;
+    }
+
+    if (GEngine)
+    {
+        GEngine->OnLevelActorAdded().Remove(ActorAddedHandle);
+        GEngine->OnLevelActorDeleted().Remove(ActorDeletedHandle);
+        GEngine->OnActorMoved().Remove(ActorMovedHandle);
+    }
+    FCoreUObjectDelegates::OnObjectRenamed.Remove(ObjectRenamedHandle);
+    FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+    FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+    FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+    FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(PropertyChangedHandle);
+    FEditorDelegates::PostUndoRedo.Remove(UndoRedoHandle);
+    ActorAddedHandle.Reset();
+    Worlds.Empty();
+    Octrees.Empty();
+}
+
+AActor* FMCPActorIndex::FindActor(UWorld* World, const FString& Name)
+{
+    // A name that was never used can't belong to an actor, and FName(*Name) would add it to the name table
+    const FName ActorName(*Name, FNAME_Find);
+    return ActorName.IsNone() ? nullptr : FindActor(World, ActorName);
+}
+
+AActor* FMCPActorIndex::FindActor(UWorld* World, FName Name)
+{
+    check(IsInGameThread());
+    if (!World)
+    {
+        return nullptr;
+    }
+
+    FActorMap& Actors = GetWorldIndex(World);
+    if (const TWeakObjectPtr<AActor>* Entry = Actors.Find(Name))
+    {
+        AActor* Actor = Entry->Get();
+        if (IsValid(Actor) && Actor->GetFName() == Name && Actor->GetWorld() == World)
+        {
+            return Actor;
+        }
+        Actors.Remove(Name);
+    }
+
+    // Not indexed or stale, the actor may have arrived without an event
+    for (ULevel* Level : World->GetLevels())
+    {
+        AActor* Actor = Level ? FindObjectFast<AActor>(Level, Name) : nullptr;
+        if (IsValid(Actor))
+        {
+            Actors.Add(Name, Actor);
+            return Actor;
+        }
+    }
+    return nullptr;
+}
+
+void FMCPActorIndex::FindActorsInBox(UWorld* World, const FBox& Box, TArray<AActor*>& OutActors)
+{
+    check(IsInGameThread());
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPActorIndex::FindActorsInBox);
+    if (!World)
+    {
+        return;
+    }
+
+    GetWorldOctree(World).Octree.FindElementsWithBoundsTest(FBoxCenterAndExtent(Box), [&OutActors](const FOctreeElement& Element)
+    {
+        AActor* Actor = Element.Actor.Get();
+        if (IsValid(Actor))
+        {
+            OutActors.Add(Actor);
+        }
+    });
+}
+
+void FMCPActorIndex::UpdateActor(AActor* Actor)
+{
+    UWorld* World = Actor ? Actor->GetWorld() : nullptr;
+    TUniquePtr<FWorldOctree>* WorldOctree = World ? Octrees.Find(World) : nullptr;
+    if (!WorldOctree)
+    {
+        return;
+    }
+
+    RemoveFromOctree(**WorldOctree, Actor);
+    if (IsValid(Actor))
+    {
+        AddToOctree(**WorldOctree, Actor);
+    }
+}
+
+FBox FMCPActorIndex::GetActorBounds(AActor* Actor)
+{
+    const FBox Bounds = Actor->GetComponentsBoundingBox(true);
+    return Bounds.IsValid ? Bounds : FBox(Actor->GetActorLocation(), Actor->GetActorLocation());
+}
+
+int32 FMCPActorIndex::Num() const
+{
+    int32 Count = 0;
+    for (const TPair<FObjectKey, FActorMap>& Pair : Worlds)
+    {
+        Count += Pair.Value.Num();
+    }
+    return Count;
+}
+
+FMCPActorIndex::FActorMap& FMCPActorIndex::GetWorldIndex(UWorld* World)
+{
+    if (FActorMap* Existing = Worlds.Find(World))
+    {
+        return *Existing;
+    }
+
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPActorIndex::BuildWorldIndex);
+
+    FActorMap& Actors = Worlds.Add(World);
+    for (ULevel* Level : World->GetLevels())
+    {
+        if (!Level)
+        {
+            continue;
+        }
+        Actors.Reserve(Actors.Num() + Level->Actors.Num());
+        for (AActor* Actor : Level->Actors)
+        {
+            // The first of two same named actors in different levels wins, as with a scan
+            if (IsValid(Actor) && !Actors.Contains(Actor->GetFName()))
+            {
+                Actors.Add(Actor->GetFName(), Actor);
+            }
+        }
+    }
+    return Actors;
+}
+
+FMCPActorIndex::FWorldOctree& FMCPActorIndex::GetWorldOctree(UWorld* World)
+{
+    if (TUniquePtr<FWorldOctree>* Existing = Octrees.Find(World))
+    {
+        return **Existing;
+    }
+
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPActorIndex::BuildWorldOctree);
+
+    FWorldOctree& WorldOctree = *Octrees.Add(World, MakeUnique<FWorldOctree>());
+    for (ULevel* Level : World->GetLevels())
+    {
+        if (!Level)
+        {
+            continue;
+        }
+        for (AActor* Actor : Level->Actors)
+        {
+            if (IsValid(Actor))
+            {
+                AddToOctree(WorldOctree, Actor);
+            }
+        }
+    }
+    return WorldOctree;
+}
+
+void FMCPActorIndex::AddToOctree(FWorldOctree& WorldOctree, AActor* Actor)
+{
+    // Actors without a root component, like the world settings, have no place in the world
+    if (!Actor->GetRootComponent())
+    {
+        return;
+    }
+
+    FOctreeElement Element;
+    Element.Actor = Actor;
+    Element.ActorKey = Actor;
+    // Covering the location too, for queries that test it rather than the bounds
+    Element.Bounds = FBoxCenterAndExtent(GetActorBounds(Actor) + Actor->GetActorLocation());
+    Element.ElementIds = &WorldOctree.ElementIds;
+    WorldOctree.Octree.AddElement(Element);
+}
+
+void FMCPActorIndex::RemoveFromOctree(FWorldOctree& WorldOctree, FObjectKey ActorKey)
+{
+    FOctreeElementId2 ElementId;
+    if (WorldOctree.ElementIds.RemoveAndCopyValue(ActorKey, ElementId) && WorldOctree.Octree.IsValidElementId(ElementId))
+    {
+        WorldOctree.Octree.RemoveElement(ElementId);
+    }
+}
+
+void FMCPActorIndex::AddActor(AActor* Actor)
+{
+    UWorld* World = Actor->GetWorld();
+    if (FActorMap* Actors = World ? Worlds.Find(World) : nullptr)
+    {
+        Actors->Add(Actor->GetFName(), Actor);
+    }
+}
+
+void FMCPActorIndex::RemoveActor(AActor* Actor, FName Name)
+{
+    UWorld* World = Actor->GetWorld();
+    FActorMap* Actors = World ? Worlds.Find(World) : nullptr;
+    if (!Actors)
+    {
+        return;
+    }
+
+    // Only if the entry is this actor, another one may have taken the name since
+    const TWeakObjectPtr<AActor>* Entry = Actors->Find(Name);
+    if (Entry && (!Entry->IsValid() || Entry->Get() == Actor))
+    {
+        Actors->Remove(Name);
+    }
+}
+
+void FMCPActorIndex::OnLevelActorAdded(AActor* Actor)
+{
+    if (Actor)
+    {
+        AddActor(Actor);
+        UpdateActor(Actor);
+    }
+}
+
+void FMCPActorIndex::OnLevelActorDeleted(AActor* Actor)
+{
+    UWorld* World = Actor ? Actor->GetWorld() : nullptr;
+    if (!World)
+    {
+        return;
+    }
+
+    RemoveActor(Actor, Actor->GetFName());
+    if (TUniquePtr<FWorldOctree>* WorldOctree = Octrees.Find(World))
+    {
+        RemoveFromOctree(**WorldOctree, Actor);
+    }
+}
+
+void FMCPActorIndex::OnObjectRenamed(UObject* Object, UObject* OldOuter, FName OldName)
+{
+    // Called after the rename, so the actor already has its new name
+    if (AActor* Actor = Cast<AActor>(Object))
+    {
+        RemoveActor(Actor, OldName);
+        AddActor(Actor);
+    }
+}
+
+void FMCPActorIndex::OnLevelChanged(ULevel* Level, UWorld* World)
+{
+    // Rare enough to rebuild on the next lookup rather than patch
+    if (World)
+    {
+        Worlds.Remove(World);
+        Octrees.Remove(World);
+    }
+}
+
+void FMCPActorIndex::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+    if (World)
+    {
+        Worlds.Remove(World);
+        Octrees.Remove(World);
+    }
+}
+
+void FMCPActorIndex::OnActorMoved(AActor* Actor)
+{
+    UpdateActor(Actor);
+}
+
+void FMCPActorIndex::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& Event)
+{
+    // Transform and mesh edits in the details panel land on the actor or one of its components
+    if (Octrees.Num() == 0 || !Object)
+    {
+        return;
+    }
+
+    if (AActor* Actor = Cast<AActor>(Object))
+    {
+        UpdateActor(Actor);
+    }
+    else if (USceneComponent* Component = Cast<USceneComponent>(Object))
+    {
+        UpdateActor(Component->GetOwner());
+    }
+}
+
+void FMCPActorIndex::OnUndoRedo()
+{
+    Octrees.Empty();
+}
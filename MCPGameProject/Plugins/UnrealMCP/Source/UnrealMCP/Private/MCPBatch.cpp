@@ -0,0 +1,219 @@
+#include "MCPBatch.h"
+#include "UnrealMCPBridge.h"
+#include "MCPTransaction.h"
+#include "Commands/UnrealMCPCommonUtils.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+TSharedPtr<FJsonObject> FMCPBatch::Run(UUnrealMCPBridge& Bridge, const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPBatch::Run);
+
+    const TArray<TSharedPtr<FJsonValue>>* Commands = nullptr;
+    if (!Params->TryGetArrayField(TEXT("commands"), Commands))
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Missing 'commands' parameter"));
+    }
+    if (Commands->Num() > MaxEntries)
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(FString::Printf(TEXT("A batch can hold at most %d commands, got %d"), MaxEntries, Commands->Num()));
+    }
+
+    // Stop at the first failing command unless asked to carry on
+    bool bStopOnError = true;
+    Params->TryGetBoolField(TEXT("stop_on_error"), bStopOnError);
+
+    // One undo entry for the whole batch, with compiles and saves held back until the end
+    bool bTransaction = false;
+    Params->TryGetBoolField(TEXT("transaction"), bTransaction);
+    TOptional<FMCPTransaction> Transaction;
+    if (bTransaction)
+    {
+        FString Description = TEXT("MCP Batch");
+        Params->TryGetStringField(TEXT("description"), Description);
+        Transaction.Emplace(FText::FromString(Description));
+    }
+
+    FEntryResults Earlier;
+    Earlier.Results.SetNum(Commands->Num());
+
+    TArray<TSharedPtr<FJsonValue>> Responses;
+    Responses.Reserve(Commands->Num());
+    int32 FailedCount = 0;
+    bool bStopped = false;
+
+    for (int32 Index = 0; Index < Commands->Num(); ++Index)
+    {
+        if (Context.IsCancelled())
+        {
+            bStopped = true;
+            break;
+        }
+        Context.ReportProgress(TEXT("batch"), Index, Commands->Num());
+
+        TSharedPtr<FJsonObject> Response;
+        const TSharedPtr<FJsonObject>* Entry = nullptr;
+        FString CommandType;
+        if (!(*Commands)[Index]->TryGetObject(Entry) || !(*Entry)->TryGetStringField(TEXT("type"), CommandType))
+        {
+            Response = MakeShared<FJsonObject>();
+            Response->SetStringField(TEXT("status"), TEXT("error"));
+            Response->SetStringField(TEXT("error"), TEXT("Batch entry needs a 'type'"));
+        }
+        else if (CommandType == TEXT("batch"))
+        {
+            Response = MakeShared<FJsonObject>();
+            Response->SetStringField(TEXT("status"), TEXT("error"));
+            Response->SetStringField(TEXT("error"), TEXT("Batches can't be nested"));
+        }
+        else
+        {
+            FString Name;
+            if ((*Entry)->TryGetStringField(TEXT("id"), Name))
+            {
+                Earlier.Names.Add(Name, Index);
+            }
+
+            FString Error;
+            TSharedPtr<FJsonValue> EntryParams = (*Entry)->TryGetField(TEXT("params"));
+            TSharedPtr<FJsonValue> ResolvedParams = EntryParams.IsValid() ? ResolveReferences(EntryParams, Earlier, Error) : MakeShared<FJsonValueObject>(MakeShared<FJsonObject>());
+
+            const TSharedPtr<FJsonObject>* CommandParams = nullptr;
+            if (!Error.IsEmpty() || !ResolvedParams->TryGetObject(CommandParams))
+            {
+                Response = MakeShared<FJsonObject>();
+                Response->SetStringField(TEXT("status"), TEXT("error"));
+                Response->SetStringField(TEXT("error"), Error.IsEmpty() ? TEXT("Batch entry 'params' must be an object") : Error);
+            }
+            else
+            {
+                Response = Bridge.DispatchCommand(CommandType, *CommandParams, Context);
+            }
+        }
+
+        FString Status;
+        const TSharedPtr<FJsonObject>* Result = nullptr;
+        if (Response->TryGetStringField(TEXT("status"), Status) && Status == TEXT("success") && Response->TryGetObjectField(TEXT("result"), Result))
+        {
+            Earlier.Results[Index] = *Result;
+        }
+        else
+        {
+            ++FailedCount;
+        }
+        Responses.Add(MakeShared<FJsonValueObject>(Response));
+
+        if (FailedCount > 0 && bStopOnError)
+        {
+            bStopped = Index + 1 < Commands->Num();
+            break;
+        }
+    }
+
+    Context.ReportProgress(TEXT("batch"), Responses.Num(), Commands->Num());
+
+    TSharedPtr<FJsonObject> ResultObj = MakeShared<FJsonObject>();
+    ResultObj->SetArrayField(TEXT("results"), Responses);
+    ResultObj->SetNumberField(TEXT("completed"), Responses.Num() - FailedCount);
+    ResultObj->SetNumberField(TEXT("failed"), FailedCount);
+    ResultObj->SetBoolField(TEXT("stopped"), bStopped);
+    if (Transaction.IsSet())
+    {
+        ResultObj->SetObjectField(TEXT("transaction"), Transaction->Commit());
+    }
+    return ResultObj;
+}
+
+TSharedPtr<FJsonValue> FMCPBatch::ResolveReferences(const TSharedPtr<FJsonValue>& Value, const FEntryResults& Earlier, FString& OutError)
+{
+    if (Value->Type == EJson::Object)
+    {
+        const TSharedPtr<FJsonObject>& Object = Value->AsObject();
+        FString Path;
+        if (Object->Values.Num() == 1 && Object->TryGetStringField(TEXT("$ref"), Path))
+        {
+            return FindReference(Path, Earlier, OutError);
+        }
+
+        TSharedPtr<FJsonObject> Resolved = MakeShared<FJsonObject>();
+        for (const TPair<FString, TSharedPtr<FJsonValue>>& Pair : Object->Values)
+        {
+            TSharedPtr<FJsonValue> Field = ResolveReferences(Pair.Value, Earlier, OutError);
+            if (!Field.IsValid())
+            {
+                return nullptr;
+            }
+            Resolved->SetField(Pair.Key, Field);
+        }
+        return MakeShared<FJsonValueObject>(Resolved);
+    }
+
+    if (Value->Type == EJson::Array)
+    {
+        TArray<TSharedPtr<FJsonValue>> Resolved;
+        for (const TSharedPtr<FJsonValue>& Element : Value->AsArray())
+        {
+            TSharedPtr<FJsonValue> ResolvedElement = ResolveReferences(Element, Earlier, OutError);
+            if (!ResolvedElement.IsValid())
+            {
+                return nullptr;
+            }
+            Resolved.Add(ResolvedElement);
+        }
+        return MakeShared<FJsonValueArray>(Resolved);
+    }
+
+    return Value;
+}
+
+TSharedPtr<FJsonValue> FMCPBatch::FindReference(const FString& Path, const FEntryResults& Earlier, FString& OutError)
+{
+    TArray<FString> Segments;
+    Path.ParseIntoArray(Segments, TEXT("."));
+    if (Segments.Num() == 0)
+    {
+        OutError = TEXT("Empty $ref");
+        return nullptr;
+    }
+
+    int32 EntryIndex = INDEX_NONE;
+    if (const int32* Named = Earlier.Names.Find(Segments[0]))
+    {
+        EntryIndex = *Named;
+    }
+    else if (Segments[0].IsNumeric())
+    {
+        EntryIndex = FCString::Atoi(*Segments[0]);
+    }
+
+    if (!Earlier.Results.IsValidIndex(EntryIndex) || !Earlier.Results[EntryIndex].IsValid())
+    {
+        OutError = FString::Printf(TEXT("$ref '%s' refers to a command that hasn't run or failed"), *Path);
+        return nullptr;
+    }
+
+    TSharedPtr<FJsonValue> Value = MakeShared<FJsonValueObject>(Earlier.Results[EntryIndex]);
+    for (int32 SegmentIndex = 1; SegmentIndex < Segments.Num() && Value.IsValid(); ++SegmentIndex)
+    {
+        const FString& Segment = Segments[SegmentIndex];
+        if (Value->Type == EJson::Object)
+        {
+            Value = Value->AsObject()->TryGetField(Segment);
+        }
+        else if (Value->Type == EJson::Array && Segment.IsNumeric())
+        {
+            const TArray<TSharedPtr<FJsonValue>>& Array = Value->AsArray();
+            const int32 ElementIndex = FCString::Atoi(*Segment);
+            Value = Array.IsValidIndex(ElementIndex) ? Array[ElementIndex] : nullptr;
+        }
+        else
+        {
+            Value = nullptr;
+        }
+    }
+
+    if (!Value.IsValid())
+    {
+        OutError = FString::Printf(TEXT("$ref '%s' doesn't name a value in that command's result"), *Path);
+    }
+    return Value;
+}
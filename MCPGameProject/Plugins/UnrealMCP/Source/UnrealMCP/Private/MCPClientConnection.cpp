@@ -0,0 +1,995 @@
+#include "MCPClientConnection.h"
+#include "MCPProtocol.h"
+#include "UnrealMCPBridge.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformTLS.h"
+#include "Async/Async.h"
+#include "Misc/ScopeLock.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/MemoryWriter.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "MCPMessagePack.h"
+#include "Misc/Compression.h"
+#include "MCPSharedMemorySocket.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// Size of the chunk read from the socket in one Recv call when no frame size is known
+const int32 ReceiveChunkSize = 8192;
+
+// Receive and send buffers that grew beyond this for a large message are released once they drain
+const int32 BufferRetainSize = 1024 * 1024;
+
+// Longest time a client thread blocks in a socket wait before re-checking whether it should stop.
+// Stop() shuts the socket down, which wakes the wait immediately.
+const FTimespan ClientWaitTimeout = FTimespan::FromSeconds(1.0);
+
+// Wait used instead while requests are in flight, bounding how long output the background
+// task couldn't send sits there before the client thread notices it
+const FTimespan ResponsePollInterval = FTimespan::FromMilliseconds(5.0);
+
+// Longest a request that asked for progress goes without a progress frame while it is queued or running.
+// Well under the clients' receive timeout, so a long compile with no steps to report isn't given up on.
+const double ProgressHeartbeatSeconds = 1.0;
+
+FMCPClientConnection::FMCPClientConnection(UUnrealMCPBridge* InBridge, FSocket* InSocket, int32 InConnectionId)
+    : Bridge(InBridge)
+    , Socket(InSocket)
+    , ConnectionId(InConnectionId)
+    , Thread(nullptr)
+    , WireMode(EWireMode::Detect)
+    , MaxMessageSize(InBridge->GetMaxMessageSize())
+    , PendingFrameSize(INDEX_NONE)
+    , MessageStartTime(0.0)
+    , CompressionThreshold(InBridge->GetCompressionThreshold())
+    , bFlushScheduled(false)
+    , UnsentOffset(0)
+    , MaxUnsentBytes(InBridge->GetMaxUnsentResponseBytes())
+    , AwaitingResponses(0)
+    , ScanOffset(0)
+    , ScanDepth(0)
+    , bScanInString(false)
+    , bScanEscaped(false)
+    , bRunning(true)
+    , bFinished(false)
+{
+}
+
+FMCPClientConnection::~FMCPClientConnection()
+{
+    Shutdown();
+
+    if (Socket)
+    {
+        Socket->Close();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+        Socket = nullptr;
+    }
+}
+
+bool FMCPClientConnection::Start()
+{
+    const FString ThreadName = FString::Printf(TEXT("UnrealMCPClientThread_%d"), ConnectionId);
+    Thread = FRunnableThread::Create(this, *ThreadName, 0, TPri_Normal);
+    if (!Thread)
+    {
+        UE_LOG(LogTemp, Error, TEXT("MCPClientConnection[%d]: Failed to create client thread"), ConnectionId);
+        bFinished = true;
+        return false;
+    }
+    return true;
+}
+
+void FMCPClientConnection::Shutdown()
+{
+    // Owners wait for the thread before letting go of the connection, so the last reference is
+    // never released on the thread itself. If it ever were, it couldn't wait for itself to finish.
+    if (Thread && !ensureMsgf(FPlatformTLS::GetCurrentThreadId() != Thread->GetThreadID(),
+        TEXT("MCPClientConnection[%d]: Released on its own thread"), ConnectionId))
+    {
+        Stop();
+        Thread = nullptr;
+        return;
+    }
+
+    if (Thread)
+    {
+        Thread->Kill(true);
+        delete Thread;
+        Thread = nullptr;
+    }
+}
+
+uint32 FMCPClientConnection::Run()
+{
+    UE_LOG(LogTemp, Display, TEXT("MCPClientConnection[%d]: Client thread starting"), ConnectionId);
+
+    while (bRunning)
+    {
+        // Write what the client has room for of any output left over by the background task
+        bool bHasUnsent = false;
+        bool bAwaitingResponses = false;
+        if (!FlushUnsent(bHasUnsent, bAwaitingResponses))
+        {
+            UE_LOG(LogTemp, Display, TEXT("MCPClientConnection[%d]: Client disconnected or error while sending. Last error code: %d"),
+                ConnectionId, (int32)ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode());
+            break;
+        }
+        if (bAwaitingResponses)
+        {
+            SendProgressHeartbeats();
+        }
+
+        // Sleep until the client sends something, or has room for the rest of the output, instead of polling
+        const ESocketWaitConditions::Type WaitCondition = bHasUnsent ? ESocketWaitConditions::WaitForReadOrWrite : ESocketWaitConditions::WaitForRead;
+        const FTimespan WaitTime = !bHasUnsent && bAwaitingResponses ? ResponsePollInterval : ClientWaitTimeout;
+        if (!Socket->Wait(WaitCondition, WaitTime))
+        {
+            continue;
+        }
+
+        // Read straight into the receive buffer. While a frame is being collected the
+        // buffer already has room for all of it, so this doesn't reallocate.
+        const int32 ReceiveSize = GetReceiveSize();
+        const int32 OldNum = ReceiveBuffer.Num();
+        ReceiveBuffer.AddUninitialized(ReceiveSize);
+
+        int32 BytesRead = 0;
+        const bool bReadSuccess = Socket->Recv(ReceiveBuffer.GetData() + OldNum, ReceiveSize, BytesRead);
+        ReceiveBuffer.SetNum(OldNum + BytesRead, EAllowShrinking::No);
+
+        if (bReadSuccess)
+        {
+            if (BytesRead == 0)
+            {
+                UE_LOG(LogTemp, Display, TEXT("MCPClientConnection[%d]: Client disconnected (zero bytes)"), ConnectionId);
+                break;
+            }
+
+            // Receive time runs from the read that brought a message's first bytes to the one completing it
+            const double ReadTime = FPlatformTime::Seconds();
+            if (OldNum == 0)
+            {
+                MessageStartTime = ReadTime;
+            }
+
+            // A single read may carry several messages, or only part of one
+            int32 MessageOffset = 0;
+            int32 MessageLength = 0;
+            int32 Consumed = 0;
+            while (bRunning && ExtractMessage(MessageOffset, MessageLength, Consumed))
+            {
+                // Empty frames are keep-alives
+                if (MessageLength > 0)
+                {
+                    ProcessMessage(ReceiveBuffer.GetData() + MessageOffset, MessageLength, ReadTime - MessageStartTime);
+                }
+                ReceiveBuffer.RemoveAt(0, Consumed, EAllowShrinking::No);
+                MessageStartTime = ReadTime;
+            }
+
+            if (ReceiveBuffer.Num() == 0 && ReceiveBuffer.Max() > BufferRetainSize)
+            {
+                ReceiveBuffer.Empty();
+            }
+        }
+        else
+        {
+            int32 LastError = (int32)ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode();
+
+            // Spurious wakeups and interrupted calls just go back to waiting
+            if (LastError == SE_EWOULDBLOCK || LastError == SE_EINTR)
+            {
+                UE_LOG(LogTemp, Verbose, TEXT("MCPClientConnection[%d]: Socket read would block or was interrupted, continuing..."), ConnectionId);
+            }
+            else
+            {
+                UE_LOG(LogTemp, Display, TEXT("MCPClientConnection[%d]: Client disconnected or error. Last error code: %d"), ConnectionId, LastError);
+                break;
+            }
+        }
+    }
+
+    // Nobody is left to read the results of the client's commands
+    Bridge->GetCommandQueue().CancelClient(ConnectionId);
+
+    // The client's shared memory connections go with it, nothing else would notice it is gone.
+    // Their threads are waited for before they are released, as the server does with its own.
+    for (const TSharedPtr<FMCPClientConnection>& SharedMemoryConnection : SharedMemoryConnections)
+    {
+        SharedMemoryConnection->Stop();
+    }
+    for (const TSharedPtr<FMCPClientConnection>& SharedMemoryConnection : SharedMemoryConnections)
+    {
+        SharedMemoryConnection->Shutdown();
+    }
+    SharedMemoryConnections.Empty();
+
+    bFinished = true;
+    UE_LOG(LogTemp, Display, TEXT("MCPClientConnection[%d]: Client thread stopping"), ConnectionId);
+    return 0;
+}
+
+void FMCPClientConnection::Stop()
+{
+    bRunning = false;
+
+    // Unblocks a pending Wait on the client thread
+    if (Socket)
+    {
+        Socket->Shutdown(ESocketShutdownMode::ReadWrite);
+    }
+}
+
+int32 FMCPClientConnection::GetReceiveSize() const
+{
+    if (WireMode == EWireMode::Framed && PendingFrameSize != INDEX_NONE)
+    {
+        // Ask for exactly the rest of the current frame
+        const int32 Remaining = FMCPProtocol::FrameHeaderSize + PendingFrameSize - ReceiveBuffer.Num();
+        return FMath::Max(Remaining, 1);
+    }
+    return ReceiveChunkSize;
+}
+
+bool FMCPClientConnection::ExtractMessage(int32& OutOffset, int32& OutLength, int32& OutConsumed)
+{
+    if (WireMode == EWireMode::Detect && !DetectWireMode())
+    {
+        return false;
+    }
+
+    if (WireMode == EWireMode::Framed)
+    {
+        return ExtractFrame(OutOffset, OutLength, OutConsumed);
+    }
+    return ExtractJsonMessage(OutOffset, OutLength, OutConsumed);
+}
+
+bool FMCPClientConnection::DetectWireMode()
+{
+    // Skip whitespace and the zero byte some clients use as a liveness probe
+    int32 Skip = 0;
+    while (Skip < ReceiveBuffer.Num() && (ReceiveBuffer[Skip] == 0 || FChar::IsWhitespace(ReceiveBuffer[Skip])))
+    {
+        ++Skip;
+    }
+    ReceiveBuffer.RemoveAt(0, Skip, EAllowShrinking::No);
+
+    if (ReceiveBuffer.Num() == 0)
+    {
+        return false;
+    }
+
+    if (ReceiveBuffer[0] == '{')
+    {
+        WireMode = EWireMode::Json;
+        return true;
+    }
+
+    // Wait until the whole preamble is here before deciding
+    const int32 Compared = FMath::Min(ReceiveBuffer.Num(), (int32)sizeof(FMCPProtocol::Magic));
+    if (FMemory::Memcmp(ReceiveBuffer.GetData(), FMCPProtocol::Magic, Compared) == 0)
+    {
+        if (Compared < (int32)sizeof(FMCPProtocol::Magic))
+        {
+            return false;
+        }
+        ReceiveBuffer.RemoveAt(0, sizeof(FMCPProtocol::Magic), EAllowShrinking::No);
+        WireMode = EWireMode::Framed;
+        UE_LOG(LogTemp, Display, TEXT("MCPClientConnection[%d]: Client switched to framed mode"), ConnectionId);
+        return true;
+    }
+
+    UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Unrecognized protocol (first byte 0x%02X), closing connection"), ConnectionId, ReceiveBuffer[0]);
+    bRunning = false;
+    return false;
+}
+
+bool FMCPClientConnection::ExtractJsonMessage(int32& OutOffset, int32& OutLength, int32& OutConsumed)
+{
+    // Drop whitespace and newline terminators between messages
+    if (ScanOffset == 0)
+    {
+        int32 Skip = 0;
+        while (Skip < ReceiveBuffer.Num() && ReceiveBuffer[Skip] != '{')
+        {
+            if (!FChar::IsWhitespace(ReceiveBuffer[Skip]) && ReceiveBuffer[Skip] != 0)
+            {
+                UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Discarding unexpected byte 0x%02X before message"), ConnectionId, ReceiveBuffer[Skip]);
+            }
+            ++Skip;
+        }
+        ReceiveBuffer.RemoveAt(0, Skip, EAllowShrinking::No);
+    }
+
+    // Track nesting until the top level object closes. Braces inside strings don't count.
+    for (; ScanOffset < ReceiveBuffer.Num(); ++ScanOffset)
+    {
+        const uint8 Byte = ReceiveBuffer[ScanOffset];
+        if (bScanInString)
+        {
+            if (bScanEscaped)
+            {
+                bScanEscaped = false;
+            }
+            else if (Byte == '\\')
+            {
+                bScanEscaped = true;
+            }
+            else if (Byte == '"')
+            {
+                bScanInString = false;
+            }
+        }
+        else if (Byte == '"')
+        {
+            bScanInString = true;
+        }
+        else if (Byte == '{' || Byte == '[')
+        {
+            ++ScanDepth;
+        }
+        else if ((Byte == '}' || Byte == ']') && --ScanDepth == 0)
+        {
+            OutOffset = 0;
+            OutLength = ScanOffset + 1;
+            OutConsumed = OutLength;
+
+            ScanOffset = 0;
+            ScanDepth = 0;
+            return true;
+        }
+    }
+
+    if (ScanOffset > MaxMessageSize)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Message exceeds %d bytes, closing connection"), ConnectionId, MaxMessageSize);
+        bRunning = false;
+    }
+
+    return false;
+}
+
+bool FMCPClientConnection::ExtractFrame(int32& OutOffset, int32& OutLength, int32& OutConsumed)
+{
+    if (PendingFrameSize == INDEX_NONE)
+    {
+        if (ReceiveBuffer.Num() < FMCPProtocol::FrameHeaderSize)
+        {
+            return false;
+        }
+
+        uint32 Flags = 0;
+        const uint32 PayloadSize = FMCPProtocol::ReadFrameHeader(ReceiveBuffer.GetData(), Flags);
+        if (Flags != 0 || PayloadSize > (uint32)MaxMessageSize)
+        {
+            UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Rejecting frame of %u bytes (flags 0x%08X, limit %d), closing connection"),
+                ConnectionId, PayloadSize, Flags, MaxMessageSize);
+            bRunning = false;
+            return false;
+        }
+
+        // Size the buffer for the whole frame up front so it fills without reallocating
+        PendingFrameSize = (int32)PayloadSize;
+        ReceiveBuffer.Reserve(FMCPProtocol::FrameHeaderSize + PendingFrameSize);
+    }
+
+    if (ReceiveBuffer.Num() < FMCPProtocol::FrameHeaderSize + PendingFrameSize)
+    {
+        return false;
+    }
+
+    OutOffset = FMCPProtocol::FrameHeaderSize;
+    OutLength = PendingFrameSize;
+    OutConsumed = FMCPProtocol::FrameHeaderSize + PendingFrameSize;
+    PendingFrameSize = INDEX_NONE;
+    return true;
+}
+
+void FMCPClientConnection::ProcessMessage(const uint8* Data, int32 Length, double ReceiveSeconds)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::ProcessMessage);
+
+    UE_LOG(LogTemp, Verbose, TEXT("MCPClientConnection[%d]: Received %d bytes"), ConnectionId, Length);
+
+    const double ParseStartTime = FPlatformTime::Seconds();
+    TSharedPtr<FJsonObject> JsonObject = DecodeMessage(Data, Length);
+    const double ParseSeconds = FPlatformTime::Seconds() - ParseStartTime;
+    if (!JsonObject.IsValid())
+    {
+        return;
+    }
+
+    // Optional request id, echoed back so the client can match responses that arrive out of order
+    TSharedPtr<FJsonValue> RequestId = JsonObject->TryGetField(TEXT("id"));
+
+    // Get command type
+    FString CommandType;
+    if (!JsonObject->TryGetStringField(TEXT("type"), CommandType))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Missing 'type' field in command"), ConnectionId);
+        QueueError(TEXT("Missing 'type' field in command"), RequestId);
+        return;
+    }
+
+    // Parameters are optional
+    TSharedPtr<FJsonObject> Params = MakeShareable(new FJsonObject());
+    const TSharedPtr<FJsonObject>* ParamsObject = nullptr;
+    if (JsonObject->TryGetObjectField(TEXT("params"), ParamsObject))
+    {
+        Params = *ParamsObject;
+    }
+
+    if (CommandType == TEXT("hello"))
+    {
+        HandleHello(Params, RequestId);
+        return;
+    }
+    if (CommandType == TEXT("open_shared_memory"))
+    {
+        HandleOpenSharedMemory(Params, RequestId);
+        return;
+    }
+
+    Bridge->GetServerStats().RecordReceived(CommandType, Length, ReceiveSeconds, ParseSeconds);
+
+    // Liveness checks are answered right here, so a supervisor gets an answer in microseconds
+    // whether the game thread is idle, in the middle of a long compile, or hung
+    if (CommandType == TEXT("ping") || CommandType == TEXT("health"))
+    {
+        TSharedPtr<FJsonObject> Result = MakeShared<FJsonObject>();
+        if (CommandType == TEXT("ping"))
+        {
+            Result->SetStringField(TEXT("message"), TEXT("pong"));
+        }
+        else
+        {
+            Result = Bridge->GetHealth();
+        }
+
+        TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
+        Response->SetStringField(TEXT("status"), TEXT("success"));
+        Response->SetObjectField(TEXT("result"), Result);
+        if (RequestId.IsValid())
+        {
+            Response->SetField(TEXT("id"), RequestId);
+        }
+        QueueResponse(Response, CommandType);
+        return;
+    }
+
+    TWeakPtr<FMCPClientConnection> WeakThis = AsShared();
+
+    FMCPCommandRequest Request;
+    Request.ClientId = ConnectionId;
+    Request.CommandType = CommandType;
+    Request.Params = Params;
+    if (RequestId.IsValid())
+    {
+        Request.RequestKey = RequestId->AsString();
+    }
+
+    // Optional time budget, counted from now. Commands still queued when it runs out are dropped.
+    double DeadlineMs = 0.0;
+    if (JsonObject->TryGetNumberField(TEXT("deadline_ms"), DeadlineMs) && DeadlineMs > 0.0)
+    {
+        Request.Deadline = FPlatformTime::Seconds() + DeadlineMs / 1000.0;
+    }
+
+    // Progress frames are only sent to clients that ask for them, and need an id to be matched up
+    bool bWantsProgress = false;
+    if (RequestId.IsValid() && JsonObject->TryGetBoolField(TEXT("progress"), bWantsProgress) && bWantsProgress)
+    {
+        const FString RequestKey = Request.RequestKey;
+        {
+            FScopeLock Lock(&ProgressLock);
+            ProgressRequests.Add(RequestKey, { RequestId, FPlatformTime::Seconds() });
+        }
+
+        Request.OnProgress = [WeakThis, RequestId, RequestKey](TSharedPtr<FJsonObject> Progress)
+        {
+            TSharedPtr<FJsonObject> Event = MakeShared<FJsonObject>();
+            Event->SetField(TEXT("id"), RequestId);
+            Event->SetStringField(TEXT("status"), TEXT("progress"));
+            Event->SetObjectField(TEXT("progress"), Progress);
+            if (TSharedPtr<FMCPClientConnection> Connection = WeakThis.Pin())
+            {
+                Connection->UpdateProgressRequest(RequestKey, false);
+                Connection->QueueResponse(Event);
+            }
+        };
+    }
+
+    // Hand the command to the bridge and go straight back to reading. All connections funnel
+    // through the bridge's queue, which runs them one by one on the game thread.
+    Request.OnComplete = [WeakThis, RequestId, CommandType, bWantsProgress](TSharedPtr<FJsonObject> Response)
+    {
+        if (RequestId.IsValid())
+        {
+            Response->SetField(TEXT("id"), RequestId);
+        }
+        if (TSharedPtr<FMCPClientConnection> Connection = WeakThis.Pin())
+        {
+            // No heartbeat may follow the response
+            if (bWantsProgress)
+            {
+                Connection->UpdateProgressRequest(RequestId->AsString(), true);
+            }
+            Connection->QueueResponseWithFormat(Response, TOptional<FPayloadFormat>(), CommandType, true);
+        }
+    };
+    AwaitingResponses.fetch_add(1);
+    Bridge->ExecuteCommandAsync(MoveTemp(Request));
+}
+
+TSharedPtr<FJsonObject> FMCPClientConnection::DecodeMessage(const uint8* Data, int32 Length) const
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::DecodeMessage);
+
+    if (Format.Encoding == EMCPEncoding::MessagePack)
+    {
+        TSharedPtr<FJsonObject> JsonObject = FMCPMessagePack::Read(Data, Length);
+        if (!JsonObject.IsValid())
+        {
+            UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Failed to decode %d byte MessagePack request"), ConnectionId, Length);
+        }
+        return JsonObject;
+    }
+
+    // Parse the UTF-8 payload in place, without widening it to TCHAR first
+    FUtf8StringView MessageView(reinterpret_cast<const UTF8CHAR*>(Data), Length);
+    TSharedPtr<FJsonObject> JsonObject;
+    TSharedRef<TJsonReader<UTF8CHAR>> Reader = TJsonReaderFactory<UTF8CHAR>::CreateFromView(MessageView);
+
+    if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+    {
+        UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Failed to parse %d byte JSON request starting with: %s"), ConnectionId, Length, *FString(MessageView.Left(128)));
+        return nullptr;
+    }
+    return JsonObject;
+}
+
+void FMCPClientConnection::HandleHello(const TSharedPtr<FJsonObject>& Params, const TSharedPtr<FJsonValue>& RequestId)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::HandleHello);
+
+    // Binary payloads need framing to be delimited, bare JSON connections stay on JSON
+    TArray<EMCPEncoding> Supported;
+    if (WireMode == EWireMode::Framed)
+    {
+        Supported.Add(EMCPEncoding::MessagePack);
+    }
+    Supported.Add(EMCPEncoding::Json);
+
+    // The client lists encodings in order of preference, pick the first one we support
+    EMCPEncoding Chosen = EMCPEncoding::Json;
+    const TArray<TSharedPtr<FJsonValue>>* Requested = nullptr;
+    if (Params->TryGetArrayField(TEXT("encodings"), Requested))
+    {
+        for (const TSharedPtr<FJsonValue>& Value : *Requested)
+        {
+            EMCPEncoding Candidate;
+            if (FMCPProtocol::ParseEncodingName(Value->AsString(), Candidate) && Supported.Contains(Candidate))
+            {
+                Chosen = Candidate;
+                break;
+            }
+        }
+    }
+
+    TArray<TSharedPtr<FJsonValue>> SupportedNames;
+    for (EMCPEncoding Supports : Supported)
+    {
+        SupportedNames.Add(MakeShared<FJsonValueString>(FMCPProtocol::GetEncodingName(Supports)));
+    }
+
+    // Compression is opt-in and, like binary encodings, needs framing to be marked
+    TArray<FName> SupportedCompression;
+    if (WireMode == EWireMode::Framed)
+    {
+        SupportedCompression = FMCPProtocol::GetSupportedCompressionFormats();
+    }
+
+    FName ChosenCompression = NAME_None;
+    const TArray<TSharedPtr<FJsonValue>>* RequestedCompression = nullptr;
+    if (Params->TryGetArrayField(TEXT("compression"), RequestedCompression))
+    {
+        for (const TSharedPtr<FJsonValue>& Value : *RequestedCompression)
+        {
+            const FString Name = Value->AsString();
+            const FName* Match = SupportedCompression.FindByPredicate([&Name](FName Candidate)
+            {
+                return FMCPProtocol::GetCompressionName(Candidate) == Name;
+            });
+            if (Match)
+            {
+                ChosenCompression = *Match;
+                break;
+            }
+        }
+    }
+
+    TArray<TSharedPtr<FJsonValue>> CompressionNames;
+    for (FName Supports : SupportedCompression)
+    {
+        CompressionNames.Add(MakeShared<FJsonValueString>(FMCPProtocol::GetCompressionName(Supports)));
+    }
+
+    TSharedPtr<FJsonObject> Result = MakeShared<FJsonObject>();
+    Result->SetNumberField(TEXT("protocol"), FMCPProtocol::Version);
+    Result->SetStringField(TEXT("encoding"), FMCPProtocol::GetEncodingName(Chosen));
+    Result->SetArrayField(TEXT("encodings"), SupportedNames);
+    Result->SetStringField(TEXT("compression"), FMCPProtocol::GetCompressionName(ChosenCompression));
+    Result->SetArrayField(TEXT("compressions"), CompressionNames);
+    Result->SetNumberField(TEXT("compression_threshold"), CompressionThreshold);
+
+    UE_LOG(LogTemp, Display, TEXT("MCPClientConnection[%d]: Using %s encoding, compression %s"), ConnectionId,
+        FMCPProtocol::GetEncodingName(Chosen), *FMCPProtocol::GetCompressionName(ChosenCompression));
+
+    FPayloadFormat NewFormat;
+    NewFormat.Encoding = Chosen;
+    NewFormat.Compression = ChosenCompression;
+    QueueResult(Result, RequestId, NewFormat);
+}
+
+void FMCPClientConnection::HandleOpenSharedMemory(const TSharedPtr<FJsonObject>& Params, const TSharedPtr<FJsonValue>& RequestId)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::HandleOpenSharedMemory);
+
+#if WITH_MCP_SHARED_MEMORY
+    if (Socket->GetProtocol() == FMCPSharedMemorySocket::ProtocolName)
+    {
+        QueueError(TEXT("Already connected over shared memory"), RequestId);
+        return;
+    }
+
+    double RequestedRingSize = (double)FMCPSharedMemorySocket::DefaultRingSize;
+    Params->TryGetNumberField(TEXT("ring_size"), RequestedRingSize);
+
+    const int32 NewConnectionId = Bridge->AllocateConnectionId();
+    const FString Name = FString::Printf(TEXT("/UnrealMCP-%u-%d"), FPlatformProcess::GetCurrentProcessId(), NewConnectionId);
+    FMCPSharedMemorySocket* SharedSocket = FMCPSharedMemorySocket::Create(Name, (uint64)FMath::Max(RequestedRingSize, 0.0));
+    if (!SharedSocket)
+    {
+        QueueError(FString::Printf(TEXT("Failed to create shared memory %s"), *Name), RequestId);
+        return;
+    }
+
+    const uint64 RingSize = SharedSocket->GetRingSize();
+    TSharedPtr<FMCPClientConnection> Connection = MakeShared<FMCPClientConnection>(Bridge, SharedSocket, NewConnectionId);
+    if (!Connection->Start())
+    {
+        QueueError(TEXT("Failed to start shared memory connection"), RequestId);
+        return;
+    }
+    SharedMemoryConnections.RemoveAll([](const TSharedPtr<FMCPClientConnection>& Existing) { return Existing->IsFinished(); });
+    SharedMemoryConnections.Add(Connection);
+
+    UE_LOG(LogTemp, Display, TEXT("MCPClientConnection[%d]: Opened shared memory connection %d at %s with %llu byte rings"),
+        ConnectionId, NewConnectionId, *Name, RingSize);
+
+    TSharedPtr<FJsonObject> Result = MakeShared<FJsonObject>();
+    Result->SetStringField(TEXT("name"), Name);
+    Result->SetNumberField(TEXT("ring_size"), (double)RingSize);
+    Result->SetNumberField(TEXT("version"), FMCPSharedMemorySocket::Version);
+    Result->SetNumberField(TEXT("connection_id"), NewConnectionId);
+    QueueResult(Result, RequestId);
+#else
+    QueueError(TEXT("Shared memory connections are not supported on this platform"), RequestId);
+#endif
+}
+
+void FMCPClientConnection::UpdateProgressRequest(const FString& RequestKey, bool bAnswered)
+{
+    FScopeLock Lock(&ProgressLock);
+    if (bAnswered)
+    {
+        ProgressRequests.Remove(RequestKey);
+    }
+    else if (FProgressRequest* ProgressRequest = ProgressRequests.Find(RequestKey))
+    {
+        ProgressRequest->LastProgressTime = FPlatformTime::Seconds();
+    }
+}
+
+void FMCPClientConnection::SendProgressHeartbeats()
+{
+    // Queued while holding the lock, so a heartbeat always lands in the outbox ahead of the response
+    FScopeLock Lock(&ProgressLock);
+    const double Now = FPlatformTime::Seconds();
+    for (TPair<FString, FProgressRequest>& Pair : ProgressRequests)
+    {
+        if (Now - Pair.Value.LastProgressTime < ProgressHeartbeatSeconds)
+        {
+            continue;
+        }
+        Pair.Value.LastProgressTime = Now;
+
+        TSharedPtr<FJsonObject> Progress = MakeShared<FJsonObject>();
+        Progress->SetBoolField(TEXT("heartbeat"), true);
+
+        TSharedPtr<FJsonObject> Event = MakeShared<FJsonObject>();
+        Event->SetField(TEXT("id"), Pair.Value.RequestId);
+        Event->SetStringField(TEXT("status"), TEXT("progress"));
+        Event->SetObjectField(TEXT("progress"), Progress);
+        QueueResponse(Event);
+    }
+}
+
+void FMCPClientConnection::QueueResult(const TSharedPtr<FJsonObject>& Result, const TSharedPtr<FJsonValue>& RequestId, TOptional<FPayloadFormat> NewFormat)
+{
+    TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
+    Response->SetStringField(TEXT("status"), TEXT("success"));
+    Response->SetObjectField(TEXT("result"), Result);
+    if (RequestId.IsValid())
+    {
+        Response->SetField(TEXT("id"), RequestId);
+    }
+    QueueResponseWithFormat(Response, NewFormat);
+}
+
+void FMCPClientConnection::QueueError(const FString& Message, const TSharedPtr<FJsonValue>& RequestId)
+{
+    TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
+    Response->SetStringField(TEXT("status"), TEXT("error"));
+    Response->SetStringField(TEXT("error"), Message);
+    if (RequestId.IsValid())
+    {
+        Response->SetField(TEXT("id"), RequestId);
+    }
+    QueueResponse(Response);
+}
+
+void FMCPClientConnection::QueueResponse(TSharedPtr<FJsonObject> Response, const FString& CommandType)
+{
+    QueueResponseWithFormat(MoveTemp(Response), TOptional<FPayloadFormat>(), CommandType);
+}
+
+void FMCPClientConnection::QueueResponseWithFormat(TSharedPtr<FJsonObject> Response, TOptional<FPayloadFormat> NewFormat, const FString& CommandType, bool bAnswersRequest)
+{
+    {
+        FScopeLock Lock(&OutboxLock);
+        Outbox.Add({ MoveTemp(Response), Format, CommandType, bAnswersRequest });
+        if (NewFormat.IsSet())
+        {
+            Format = NewFormat.GetValue();
+        }
+        if (bFlushScheduled)
+        {
+            return;
+        }
+        bFlushScheduled = true;
+    }
+
+    // Serialize and send off the game thread so a large response never stalls the editor
+    TWeakPtr<FMCPClientConnection> WeakThis = AsShared();
+    AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [WeakThis]()
+    {
+        if (TSharedPtr<FMCPClientConnection> Connection = WeakThis.Pin())
+        {
+            Connection->FlushOutbox();
+        }
+    });
+}
+
+void FMCPClientConnection::FlushOutbox()
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::FlushOutbox);
+
+    FScopeLock SendScope(&SendLock);
+
+    TArray<FOutgoingResponse> Pending;
+    while (true)
+    {
+        {
+            FScopeLock Lock(&OutboxLock);
+            if (Outbox.Num() == 0)
+            {
+                bFlushScheduled = false;
+                return;
+            }
+            Swap(Pending, Outbox);
+        }
+
+        for (const FOutgoingResponse& Outgoing : Pending)
+        {
+            // Nothing more reaches the client once the connection is closing
+            if (bRunning && !SendResponse(Outgoing.Response, Outgoing.Format, Outgoing.CommandType))
+            {
+                UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Failed to send response"), ConnectionId);
+            }
+            if (Outgoing.bAnswersRequest)
+            {
+                AwaitingResponses.fetch_sub(1);
+            }
+        }
+        Pending.Reset();
+    }
+}
+
+bool FMCPClientConnection::SendResponse(const TSharedPtr<FJsonObject>& Response, const FPayloadFormat& ResponseFormat, const FString& CommandType)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::SendResponse);
+
+    const double SerializeStartTime = FPlatformTime::Seconds();
+
+    // Serialize straight into the send buffer, after room for the frame header
+    const int32 HeaderSize = WireMode == EWireMode::Framed ? FMCPProtocol::FrameHeaderSize : 0;
+    SendBuffer.Reset();
+    SendBuffer.AddUninitialized(HeaderSize);
+    if (ResponseFormat.Encoding == EMCPEncoding::MessagePack)
+    {
+        FMCPMessagePack::Write(Response.ToSharedRef(), SendBuffer);
+    }
+    else
+    {
+        FMemoryWriter Archive(SendBuffer, false, true);
+        TSharedRef<TJsonWriter<UTF8CHAR, TCondensedJsonPrintPolicy<UTF8CHAR>>> Writer =
+            TJsonWriterFactory<UTF8CHAR, TCondensedJsonPrintPolicy<UTF8CHAR>>::Create(&Archive);
+        if (!FJsonSerializer::Serialize(Response.ToSharedRef(), Writer))
+        {
+            return false;
+        }
+    }
+
+    const int32 EncodedSize = SendBuffer.Num() - HeaderSize;
+    uint32 FrameFlags = 0;
+    if (!ResponseFormat.Compression.IsNone() && EncodedSize >= CompressionThreshold)
+    {
+        FrameFlags = CompressPayload(HeaderSize, ResponseFormat.Compression);
+    }
+
+    const int32 PayloadSize = SendBuffer.Num() - HeaderSize;
+    if (HeaderSize > 0)
+    {
+        FMCPProtocol::WriteFrameHeader(SendBuffer.GetData(), (uint32)PayloadSize, FrameFlags);
+    }
+
+    UE_LOG(LogTemp, Verbose, TEXT("MCPClientConnection[%d]: Sending %d byte response (%d before compression)"), ConnectionId, PayloadSize, EncodedSize);
+
+    // Straight to the socket unless earlier output is still waiting, the rest goes to the client thread
+    const double SendStartTime = FPlatformTime::Seconds();
+    int32 BytesSent = 0;
+    bool bSent = UnsentOffset < Unsent.Num() || SendWithoutWaiting(SendBuffer.GetData(), SendBuffer.Num(), BytesSent);
+    if (bSent && BytesSent < SendBuffer.Num())
+    {
+        Unsent.Append(SendBuffer.GetData() + BytesSent, SendBuffer.Num() - BytesSent);
+        if (Unsent.Num() - UnsentOffset > MaxUnsentBytes)
+        {
+            UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Client left more than %d response bytes unread, closing connection"), ConnectionId, MaxUnsentBytes);
+            Unsent.Empty();
+            UnsentOffset = 0;
+            bSent = false;
+            Stop();
+        }
+    }
+
+    if (!CommandType.IsEmpty())
+    {
+        FString Status;
+        const bool bError = !Response->TryGetStringField(TEXT("status"), Status) || Status != TEXT("success");
+        Bridge->GetServerStats().RecordSent(CommandType, SendBuffer.Num(), SendStartTime - SerializeStartTime,
+            FPlatformTime::Seconds() - SendStartTime, bError || !bSent);
+    }
+
+    // Don't hold on to the memory of an unusually large response
+    if (SendBuffer.Max() > BufferRetainSize)
+    {
+        SendBuffer.Empty();
+    }
+    if (CompressBuffer.Max() > BufferRetainSize)
+    {
+        CompressBuffer.Empty();
+    }
+
+    return bSent;
+}
+
+uint32 FMCPClientConnection::CompressPayload(int32 HeaderSize, FName Compression)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::CompressPayload);
+
+    const int32 EncodedSize = SendBuffer.Num() - HeaderSize;
+
+    // Compressed payload: frame header, uncompressed size, compressed bytes
+    const int32 Prefix = HeaderSize + sizeof(uint32);
+    int32 CompressedSize = FCompression::CompressMemoryBound(Compression, EncodedSize);
+    CompressBuffer.SetNumUninitialized(Prefix + CompressedSize, EAllowShrinking::No);
+
+    if (!FCompression::CompressMemory(Compression, CompressBuffer.GetData() + Prefix, CompressedSize, SendBuffer.GetData() + HeaderSize, EncodedSize))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("MCPClientConnection[%d]: Failed to compress %d byte response with %s"), ConnectionId, EncodedSize, *Compression.ToString());
+        return 0;
+    }
+
+    // Not worth it, the client gets the plain payload
+    if (CompressedSize + (int32)sizeof(uint32) >= EncodedSize)
+    {
+        return 0;
+    }
+
+    const uint32 UncompressedSize = (uint32)EncodedSize;
+    uint8* SizeField = CompressBuffer.GetData() + HeaderSize;
+    SizeField[0] = (uint8)(UncompressedSize >> 24);
+    SizeField[1] = (uint8)(UncompressedSize >> 16);
+    SizeField[2] = (uint8)(UncompressedSize >> 8);
+    SizeField[3] = (uint8)(UncompressedSize);
+
+    CompressBuffer.SetNum(Prefix + CompressedSize, EAllowShrinking::No);
+    Swap(SendBuffer, CompressBuffer);
+    return FMCPProtocol::FrameFlagCompressed;
+}
+
+bool FMCPClientConnection::SendWithoutWaiting(const uint8* Data, int32 Length, int32& OutBytesSent)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::SendWithoutWaiting);
+
+    OutBytesSent = 0;
+    while (OutBytesSent < Length)
+    {
+        int32 BytesSent = 0;
+        if (!Socket->Send(Data + OutBytesSent, Length - OutBytesSent, BytesSent))
+        {
+            // A full send buffer isn't an error, the caller keeps the rest for later
+            return (int32)ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode() == SE_EWOULDBLOCK;
+        }
+        if (BytesSent == 0)
+        {
+            break;
+        }
+        OutBytesSent += BytesSent;
+    }
+    return true;
+}
+
+bool FMCPClientConnection::FlushUnsent(bool& bOutHasUnsent, bool& bOutAwaitingResponses)
+{
+    FScopeLock SendScope(&SendLock);
+
+    bOutAwaitingResponses = AwaitingResponses.load() > 0;
+    bOutHasUnsent = false;
+    if (UnsentOffset == Unsent.Num())
+    {
+        return true;
+    }
+
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPClientConnection::FlushUnsent);
+
+    int32 BytesSent = 0;
+    if (!SendWithoutWaiting(Unsent.GetData() + UnsentOffset, Unsent.Num() - UnsentOffset, BytesSent))
+    {
+        return false;
+    }
+    UnsentOffset += BytesSent;
+
+    if (UnsentOffset < Unsent.Num())
+    {
+        // Drop the sent front once it is most of the buffer, so a client that keeps up slowly doesn't grow it forever
+        if (UnsentOffset > Unsent.Num() / 2)
+        {
+            Unsent.RemoveAt(0, UnsentOffset, EAllowShrinking::No);
+            UnsentOffset = 0;
+        }
+        bOutHasUnsent = true;
+        return true;
+    }
+
+    // Drained, start over at the front and let go of memory held for a burst of output
+    UnsentOffset = 0;
+    if (Unsent.Max() > BufferRetainSize)
+    {
+        Unsent.Empty();
+    }
+    else
+    {
+        Unsent.Reset();
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#include "MCPCommandContext.h"
+#include "HAL/PlatformTime.h"
+
+// Minimum time between two progress events of the same request
+const double ProgressInterval = 0.25;
+
+FMCPCommandContext::FMCPCommandContext(FMCPProgressCallback InOnProgress, TSharedPtr<std::atomic<bool>> InCancelFlag, double InDeadline, int32 InClientId)
+    : OnProgress(MoveTemp(InOnProgress))
+    , CancelFlag(MoveTemp(InCancelFlag))
+    , Deadline(InDeadline)
+    , ClientId(InClientId)
+{
+}
+
+bool FMCPCommandContext::IsCancelled() const
+{
+    if (CancelFlag.IsValid() && CancelFlag->load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    return Deadline > 0.0 && FPlatformTime::Seconds() > Deadline;
+}
+
+void FMCPCommandContext::ReportProgress(const FString& Stage, int32 Completed, int32 Total, const FString& Item) const
+{
+    if (!OnProgress)
+    {
+        return;
+    }
+
+    const double Now = FPlatformTime::Seconds();
+    if (Completed > 0 && Completed < Total && Now - LastProgressTime < ProgressInterval)
+    {
+        return;
+    }
+    LastProgressTime = Now;
+
+    TSharedPtr<FJsonObject> Progress = MakeShared<FJsonObject>();
+    Progress->SetStringField(TEXT("stage"), Stage);
+    Progress->SetNumberField(TEXT("completed"), Completed);
+    Progress->SetNumberField(TEXT("total"), Total);
+    if (!Item.IsEmpty())
+    {
+        Progress->SetStringField(TEXT("item"), Item);
+    }
+    OnProgress(Progress);
+}
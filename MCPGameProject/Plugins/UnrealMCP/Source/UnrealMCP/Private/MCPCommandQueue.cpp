@@ -0,0 +1,474 @@
+#include "MCPCommandQueue.h"
+#include "UnrealMCPBridge.h"
+#include "MCPTrace.h"
+#include "Misc/ScopeLock.h"
+#include "HAL/PlatformTime.h"
+#include "Editor/EditorPerformanceSettings.h"
+#include "Editor.h"
+
+// Bounds of the retry hint sent with a busy response
+const int32 MinRetryAfterMs = 50;
+const int32 MaxRetryAfterMs = 5000;
+
+// Weight of the newest sample in the average command run time
+const double RunTimeSmoothing = 0.1;
+
+// How long the background throttle stays lifted after the last queued command, so a client
+// pausing between commands doesn't make the next one wait for a throttled frame
+const double ThrottleRestoreDelaySeconds = 2.0;
+
+FMCPCommandQueue::FMCPCommandQueue(UUnrealMCPBridge* InBridge)
+    : Bridge(InBridge)
+    , bTicking(false)
+    , RunningClientId(0)
+    , RunningStartTime(0.0)
+    , LastTickTime(0.0)
+    , MaxDepth(DefaultMaxDepth)
+    , MaxDepthPerClient(DefaultMaxDepthPerClient)
+    , FrameBudgetSeconds(DefaultFrameBudgetMs / 1000.0)
+    , bLiftBackgroundThrottle(true)
+    , bThrottleLifted(false)
+    , LastWorkTime(0.0)
+    , PeakDepth(0)
+    , AcceptedCount(0)
+    , RejectedCount(0)
+    , RejectedByClientQuotaCount(0)
+    , CompletedCount(0)
+    , ExpiredCount(0)
+    , CancelledCount(0)
+    , DequeuedCount(0)
+    , TotalWaitSeconds(0.0)
+    , MaxWaitSeconds(0.0)
+    , AverageRunSeconds(0.0)
+    , BusyFrameCount(0)
+    , BudgetExhaustedFrameCount(0)
+    , MaxCommandsPerFrame(0)
+    , ThrottleLiftCount(0)
+{
+}
+
+FMCPCommandQueue::~FMCPCommandQueue()
+{
+    Stop();
+}
+
+void FMCPCommandQueue::Configure(int32 InMaxDepth, int32 InMaxDepthPerClient, float InFrameBudgetMs, bool bInLiftBackgroundThrottle)
+{
+    FScopeLock ScopeLock(&Lock);
+    MaxDepth = FMath::Max(InMaxDepth, 1);
+    MaxDepthPerClient = FMath::Clamp(InMaxDepthPerClient, 1, MaxDepth);
+    FrameBudgetSeconds = FMath::Max(InFrameBudgetMs, 0.0f) / 1000.0;
+    bLiftBackgroundThrottle = bInLiftBackgroundThrottle;
+}
+
+void FMCPCommandQueue::Start()
+{
+    if (!TickerHandle.IsValid())
+    {
+        TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FMCPCommandQueue::Tick));
+    }
+    if (!ThrottleOverrideHandle.IsValid() && GEditor)
+    {
+        ThrottleOverrideHandle = GEditor->AddShouldDisableCPUThrottlingDelegate(
+            UEditorEngine::FShouldDisableCPUThrottling::CreateRaw(this, &FMCPCommandQueue::ShouldDisableCPUThrottling));
+    }
+}
+
+void FMCPCommandQueue::Stop()
+{
+    if (TickerHandle.IsValid())
+    {
+        FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+        TickerHandle.Reset();
+    }
+    RestoreBackgroundThrottle();
+    if (ThrottleOverrideHandle.IsValid())
+    {
+        if (GEditor)
+        {
+            GEditor->RemoveShouldDisableCPUThrottlingDelegate(ThrottleOverrideHandle);
+        }
+        ThrottleOverrideHandle.Reset();
+    }
+}
+
+bool FMCPCommandQueue::Enqueue(FMCPCommandRequest&& Request, int32& OutRetryAfterMs)
+{
+    FScopeLock ScopeLock(&Lock);
+
+    int32& ClientDepth = QueuedPerClient.FindOrAdd(Request.ClientId);
+    if (Commands.Num() >= MaxDepth || ClientDepth >= MaxDepthPerClient)
+    {
+        const bool bClientQuota = Commands.Num() < MaxDepth;
+        ++RejectedCount;
+        RejectedByClientQuotaCount += bClientQuota ? 1 : 0;
+        OutRetryAfterMs = EstimateRetryAfterMs(bClientQuota ? ClientDepth : Commands.Num());
+        if (ClientDepth == 0)
+        {
+            QueuedPerClient.Remove(Request.ClientId);
+        }
+
+        UE_LOG(LogTemp, Warning, TEXT("MCPCommandQueue: Refused %s from client %d (%d queued, %d from this client)"),
+            *Request.CommandType, Request.ClientId, Commands.Num(), ClientDepth);
+        return false;
+    }
+
+    ++ClientDepth;
+    ++AcceptedCount;
+
+    // Picked up by the next tick, no task is posted per command
+    FQueuedCommand& Queued = Commands.AddDefaulted_GetRef();
+    Queued.Request = MoveTemp(Request);
+    if (!Queued.Request.CancelFlag.IsValid())
+    {
+        Queued.Request.CancelFlag = MakeShared<std::atomic<bool>>(false);
+    }
+    Queued.EnqueueTime = FPlatformTime::Seconds();
+    PeakDepth = FMath::Max(PeakDepth, Commands.Num());
+    return true;
+}
+
+bool FMCPCommandQueue::Tick(float DeltaTime)
+{
+    check(IsInGameThread());
+
+    LastTickTime.store(FPlatformTime::Seconds(), std::memory_order_relaxed);
+    if (bTicking)
+    {
+        return true;
+    }
+    TGuardValue<bool> TickingGuard(bTicking, true);
+
+    double BudgetSeconds = 0.0;
+    bool bHasWork = false;
+    {
+        FScopeLock ScopeLock(&Lock);
+        bHasWork = Commands.Num() > 0;
+        BudgetSeconds = FrameBudgetSeconds;
+    }
+
+    UpdateBackgroundThrottle(bHasWork);
+    if (!bHasWork)
+    {
+        return true;
+    }
+
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPCommandQueue::Tick);
+
+    // Always make progress, then keep going while the frame has budget left
+    const double FrameStartTime = FPlatformTime::Seconds();
+    int32 RunCount = 0;
+    double Elapsed = 0.0;
+    while (RunNext())
+    {
+        ++RunCount;
+        Elapsed = FPlatformTime::Seconds() - FrameStartTime;
+        if (Elapsed >= BudgetSeconds)
+        {
+            break;
+        }
+    }
+
+    FScopeLock ScopeLock(&Lock);
+    ++BusyFrameCount;
+    BudgetExhaustedFrameCount += Elapsed >= BudgetSeconds ? 1 : 0;
+    MaxCommandsPerFrame = FMath::Max(MaxCommandsPerFrame, RunCount);
+    return true;
+}
+
+void FMCPCommandQueue::UpdateBackgroundThrottle(bool bHasWork)
+{
+    const double Now = FPlatformTime::Seconds();
+    if (bHasWork)
+    {
+        LastWorkTime = Now;
+    }
+
+    if (!bThrottleLifted)
+    {
+        // The user's setting is only read: the editor asks ShouldDisableCPUThrottling each frame it
+        // would throttle, so there is nothing to put back and nothing that could end up saved
+        if (!bHasWork || !bLiftBackgroundThrottle || !ThrottleOverrideHandle.IsValid()
+            || !GetDefault<UEditorPerformanceSettings>()->bThrottleCPUWhenNotForeground)
+        {
+            return;
+        }
+
+        FScopeLock ScopeLock(&Lock);
+        bThrottleLifted = true;
+        ++ThrottleLiftCount;
+        UE_LOG(LogTemp, Verbose, TEXT("MCPCommandQueue: Lifted the editor's background throttle"));
+    }
+    else if (Now - LastWorkTime > ThrottleRestoreDelaySeconds)
+    {
+        RestoreBackgroundThrottle();
+    }
+}
+
+void FMCPCommandQueue::RestoreBackgroundThrottle()
+{
+    if (!bThrottleLifted)
+    {
+        return;
+    }
+
+    FScopeLock ScopeLock(&Lock);
+    bThrottleLifted = false;
+    UE_LOG(LogTemp, Verbose, TEXT("MCPCommandQueue: Restored the editor's background throttle"));
+}
+
+bool FMCPCommandQueue::ShouldDisableCPUThrottling() const
+{
+    return bThrottleLifted;
+}
+
+bool FMCPCommandQueue::RunNext()
+{
+    check(IsInGameThread());
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPCommandQueue::RunNext);
+
+    FQueuedCommand Queued;
+    bool bExpired = false;
+    double WaitSeconds = 0.0;
+    {
+        FScopeLock ScopeLock(&Lock);
+        if (Commands.Num() == 0)
+        {
+            return false;
+        }
+
+        Queued = RemoveCommand(0);
+
+        const double Now = FPlatformTime::Seconds();
+        WaitSeconds = Now - Queued.EnqueueTime;
+        TotalWaitSeconds += WaitSeconds;
+        ++DequeuedCount;
+        MaxWaitSeconds = FMath::Max(MaxWaitSeconds, WaitSeconds);
+
+        bExpired = Queued.Request.Deadline > 0.0 && Now > Queued.Request.Deadline;
+        if (bExpired)
+        {
+            ++ExpiredCount;
+        }
+        else
+        {
+            RunningClientId = Queued.Request.ClientId;
+            RunningRequestKey = Queued.Request.RequestKey;
+            RunningCommandType = Queued.Request.CommandType;
+            RunningStartTime = Now;
+            RunningCancelFlag = Queued.Request.CancelFlag;
+        }
+    }
+
+    FMCPCommandRequest& Request = Queued.Request;
+    MCP_TRACE_REQUEST(Request.CommandType, Request.RequestKey, Request.ClientId);
+    if (bExpired)
+    {
+        // Whoever sent it has stopped waiting, skip the work and send only a short error
+        UE_LOG(LogTemp, Display, TEXT("MCPCommandQueue: Dropped %s from client %d, deadline passed while queued"), *Request.CommandType, Request.ClientId);
+        Bridge->GetServerStats().RecordRun(Request.CommandType, WaitSeconds, TOptional<double>());
+        Request.OnComplete(MakeDroppedResponse(TEXT("Deadline exceeded before the command ran"), TEXT("deadline_exceeded")));
+        return true;
+    }
+
+    TSharedPtr<FJsonObject> Response;
+    double RunSeconds = 0.0;
+    if (!Request.OnStart || Request.OnStart())
+    {
+        const double StartTime = FPlatformTime::Seconds();
+        FMCPCommandContext Context(MoveTemp(Request.OnProgress), Request.CancelFlag, Request.Deadline, Request.ClientId);
+        Response = Bridge->DispatchCommand(Request.CommandType, Request.Params, Context);
+        RunSeconds = FPlatformTime::Seconds() - StartTime;
+    }
+    Bridge->GetServerStats().RecordRun(Request.CommandType, WaitSeconds, Response.IsValid() ? TOptional<double>(RunSeconds) : TOptional<double>());
+
+    {
+        FScopeLock ScopeLock(&Lock);
+        RunningClientId = 0;
+        RunningRequestKey.Reset();
+        RunningCommandType.Reset();
+        RunningCancelFlag.Reset();
+        if (!Response.IsValid())
+        {
+            return true;
+        }
+        ++CompletedCount;
+        AverageRunSeconds = CompletedCount == 1 ? RunSeconds : FMath::Lerp(AverageRunSeconds, RunSeconds, RunTimeSmoothing);
+    }
+
+    Request.OnComplete(Response);
+    return true;
+}
+
+FMCPCommandQueue::FQueuedCommand FMCPCommandQueue::RemoveCommand(int32 Index)
+{
+    FQueuedCommand Queued = MoveTemp(Commands[Index]);
+    Commands.RemoveAt(Index, 1, EAllowShrinking::No);
+
+    int32& ClientDepth = QueuedPerClient.FindChecked(Queued.Request.ClientId);
+    if (--ClientDepth == 0)
+    {
+        QueuedPerClient.Remove(Queued.Request.ClientId);
+    }
+    return Queued;
+}
+
+void FMCPCommandQueue::Reset(const FString& Reason)
+{
+    TArray<FQueuedCommand> Dropped;
+    {
+        FScopeLock ScopeLock(&Lock);
+        Dropped = MoveTemp(Commands);
+        QueuedPerClient.Empty();
+    }
+
+    for (FQueuedCommand& Queued : Dropped)
+    {
+        TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
+        Response->SetStringField(TEXT("status"), TEXT("error"));
+        Response->SetStringField(TEXT("error"), Reason);
+        Queued.Request.OnComplete(Response);
+    }
+}
+
+bool FMCPCommandQueue::Cancel(int32 ClientId, const FString& RequestKey, bool& bOutWasRunning)
+{
+    bOutWasRunning = false;
+    if (RequestKey.IsEmpty())
+    {
+        return false;
+    }
+
+    TArray<FQueuedCommand> Dropped;
+    {
+        FScopeLock ScopeLock(&Lock);
+        for (int32 Index = Commands.Num() - 1; Index >= 0; --Index)
+        {
+            const FMCPCommandRequest& Request = Commands[Index].Request;
+            if (Request.ClientId == ClientId && Request.RequestKey == RequestKey)
+            {
+                Dropped.Add(RemoveCommand(Index));
+            }
+        }
+        CancelledCount += Dropped.Num();
+
+        if (RunningCancelFlag.IsValid() && RunningClientId == ClientId && RunningRequestKey == RequestKey)
+        {
+            RunningCancelFlag->store(true, std::memory_order_relaxed);
+            bOutWasRunning = true;
+        }
+    }
+
+    for (FQueuedCommand& Queued : Dropped)
+    {
+        Queued.Request.OnComplete(MakeDroppedResponse(TEXT("Cancelled before the command ran"), TEXT("cancelled")));
+    }
+    return Dropped.Num() > 0 || bOutWasRunning;
+}
+
+void FMCPCommandQueue::CancelClient(int32 ClientId)
+{
+    int32 DroppedCount = 0;
+    {
+        FScopeLock ScopeLock(&Lock);
+        // Nobody is left to read the answers, so the dropped commands are just forgotten
+        for (int32 Index = Commands.Num() - 1; Index >= 0; --Index)
+        {
+            const FMCPCommandRequest& Request = Commands[Index].Request;
+            if (Request.ClientId == ClientId && !Request.bDetached)
+            {
+                RemoveCommand(Index);
+                ++DroppedCount;
+            }
+        }
+        CancelledCount += DroppedCount;
+
+        if (RunningCancelFlag.IsValid() && RunningClientId == ClientId)
+        {
+            RunningCancelFlag->store(true, std::memory_order_relaxed);
+        }
+    }
+
+    if (DroppedCount > 0)
+    {
+        UE_LOG(LogTemp, Display, TEXT("MCPCommandQueue: Dropped %d queued command(s) of disconnected client %d"), DroppedCount, ClientId);
+    }
+}
+
+TSharedPtr<FJsonObject> FMCPCommandQueue::MakeDroppedResponse(const FString& Message, const TCHAR* Flag)
+{
+    TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
+    Response->SetStringField(TEXT("status"), TEXT("error"));
+    Response->SetStringField(TEXT("error"), Message);
+    Response->SetBoolField(Flag, true);
+    return Response;
+}
+
+int32 FMCPCommandQueue::EstimateRetryAfterMs(int32 Depth) const
+{
+    const double EstimateMs = Depth * AverageRunSeconds * 1000.0;
+    return FMath::Clamp((int32)EstimateMs, MinRetryAfterMs, MaxRetryAfterMs);
+}
+
+TSharedPtr<FJsonObject> FMCPCommandQueue::MakeBusyResponse(int32 RetryAfterMs)
+{
+    TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
+    Response->SetStringField(TEXT("status"), TEXT("error"));
+    Response->SetStringField(TEXT("error"), FString::Printf(TEXT("Server busy, retry after %d ms"), RetryAfterMs));
+    Response->SetBoolField(TEXT("busy"), true);
+    Response->SetNumberField(TEXT("retry_after_ms"), RetryAfterMs);
+    return Response;
+}
+
+int32 FMCPCommandQueue::GetDepth() const
+{
+    FScopeLock ScopeLock(&Lock);
+    return Commands.Num();
+}
+
+bool FMCPCommandQueue::GetRunningCommand(FString& OutCommandType, int32& OutClientId, double& OutRunningSeconds) const
+{
+    FScopeLock ScopeLock(&Lock);
+    if (RunningCommandType.IsEmpty())
+    {
+        return false;
+    }
+    OutCommandType = RunningCommandType;
+    OutClientId = RunningClientId;
+    OutRunningSeconds = FPlatformTime::Seconds() - RunningStartTime;
+    return true;
+}
+
+double FMCPCommandQueue::GetSecondsSinceTick() const
+{
+    const double TickTime = LastTickTime.load(std::memory_order_relaxed);
+    return TickTime > 0.0 ? FPlatformTime::Seconds() - TickTime : -1.0;
+}
+
+TSharedPtr<FJsonObject> FMCPCommandQueue::GetStats() const
+{
+    FScopeLock ScopeLock(&Lock);
+
+    TSharedPtr<FJsonObject> Stats = MakeShared<FJsonObject>();
+    Stats->SetNumberField(TEXT("depth"), Commands.Num());
+    Stats->SetNumberField(TEXT("peak_depth"), PeakDepth);
+    Stats->SetNumberField(TEXT("max_depth"), MaxDepth);
+    Stats->SetNumberField(TEXT("max_depth_per_client"), MaxDepthPerClient);
+    Stats->SetNumberField(TEXT("clients_waiting"), QueuedPerClient.Num());
+    Stats->SetNumberField(TEXT("accepted"), (double)AcceptedCount);
+    Stats->SetNumberField(TEXT("completed"), (double)CompletedCount);
+    Stats->SetNumberField(TEXT("rejected"), (double)RejectedCount);
+    Stats->SetNumberField(TEXT("rejected_client_quota"), (double)RejectedByClientQuotaCount);
+    Stats->SetNumberField(TEXT("expired"), (double)ExpiredCount);
+    Stats->SetNumberField(TEXT("cancelled"), (double)CancelledCount);
+    Stats->SetNumberField(TEXT("average_wait_ms"), DequeuedCount > 0 ? TotalWaitSeconds * 1000.0 / DequeuedCount : 0.0);
+    Stats->SetNumberField(TEXT("max_wait_ms"), MaxWaitSeconds * 1000.0);
+    Stats->SetNumberField(TEXT("average_run_ms"), AverageRunSeconds * 1000.0);
+    Stats->SetNumberField(TEXT("frame_budget_ms"), FrameBudgetSeconds * 1000.0);
+    Stats->SetNumberField(TEXT("busy_frames"), (double)BusyFrameCount);
+    Stats->SetNumberField(TEXT("budget_exhausted_frames"), (double)BudgetExhaustedFrameCount);
+    Stats->SetNumberField(TEXT("max_commands_per_frame"), MaxCommandsPerFrame);
+    Stats->SetBoolField(TEXT("background_throttle_lifted"), bThrottleLifted);
+    Stats->SetNumberField(TEXT("background_throttle_lifts"), (double)ThrottleLiftCount);
+    return Stats;
+}
@@ -0,0 +1,86 @@
+#include "MCPCommandRegistry.h"
+#include "Misc/ScopeRWLock.h"
+#include "Dom/JsonValue.h"
+
+bool FMCPCommandRegistry::RegisterCommand(FName CommandType, FMCPCommandHandler Handler, FName Category, EMCPCommandFlags Flags)
+{
+    TSharedRef<FMCPRegisteredCommand> Command = MakeShared<FMCPRegisteredCommand>();
+    Command->Handler = MoveTemp(Handler);
+    Command->Category = Category;
+    Command->Flags = Flags;
+    return AddCommand(CommandType, Command);
+}
+
+bool FMCPCommandRegistry::RegisterDeferredCommand(FName CommandType, FMCPDeferredCommandHandler Handler, FName Category, EMCPCommandFlags Flags)
+{
+    // Called on the network thread the request arrives on
+    check(EnumHasAnyFlags(Flags, EMCPCommandFlags::ThreadSafe));
+
+    TSharedRef<FMCPRegisteredCommand> Command = MakeShared<FMCPRegisteredCommand>();
+    Command->DeferredHandler = MoveTemp(Handler);
+    Command->Category = Category;
+    Command->Flags = Flags;
+    return AddCommand(CommandType, Command);
+}
+
+bool FMCPCommandRegistry::AddCommand(FName CommandType, TSharedRef<FMCPRegisteredCommand> Command)
+{
+    check(IsInGameThread());
+
+    FWriteScopeLock ScopeLock(Lock);
+    if (Commands.Contains(CommandType))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("MCPCommandRegistry: Command %s is already registered"), *CommandType.ToString());
+        return false;
+    }
+    Commands.Add(CommandType, Command);
+    return true;
+}
+
+bool FMCPCommandRegistry::UnregisterCommand(FName CommandType)
+{
+    check(IsInGameThread());
+
+    FWriteScopeLock ScopeLock(Lock);
+    return Commands.Remove(CommandType) > 0;
+}
+
+TSharedPtr<const FMCPRegisteredCommand> FMCPCommandRegistry::FindCommand(const FString& CommandType) const
+{
+    // FNAME_Find so unknown names sent by clients don't grow the name table
+    const FName Name(*CommandType, FNAME_Find);
+    if (Name.IsNone())
+    {
+        return nullptr;
+    }
+
+    FReadScopeLock ScopeLock(Lock);
+    const TSharedRef<const FMCPRegisteredCommand>* Command = Commands.Find(Name);
+    return Command ? TSharedPtr<const FMCPRegisteredCommand>(*Command) : nullptr;
+}
+
+TSharedPtr<FJsonObject> FMCPCommandRegistry::Describe() const
+{
+    FReadScopeLock ScopeLock(Lock);
+
+    TArray<FName> Names;
+    Commands.GetKeys(Names);
+    Names.Sort(FNameLexicalLess());
+
+    TArray<TSharedPtr<FJsonValue>> CommandArray;
+    CommandArray.Reserve(Names.Num());
+    for (const FName& Name : Names)
+    {
+        const FMCPRegisteredCommand& Command = *Commands[Name];
+        TSharedPtr<FJsonObject> CommandObj = MakeShared<FJsonObject>();
+        CommandObj->SetStringField(TEXT("name"), Name.ToString());
+        CommandObj->SetStringField(TEXT("category"), Command.Category.IsNone() ? TEXT("") : Command.Category.ToString());
+        CommandObj->SetBoolField(TEXT("thread_safe"), EnumHasAnyFlags(Command.Flags, EMCPCommandFlags::ThreadSafe));
+        CommandArray.Add(MakeShared<FJsonValueObject>(CommandObj));
+    }
+
+    TSharedPtr<FJsonObject> Result = MakeShared<FJsonObject>();
+    Result->SetArrayField(TEXT("commands"), CommandArray);
+    Result->SetNumberField(TEXT("count"), CommandArray.Num());
+    return Result;
+}
@@ -0,0 +1,386 @@
+#include "MCPJobManager.h"
+#include "UnrealMCPBridge.h"
+#include "Misc/ScopeLock.h"
+#include "HAL/PlatformTime.h"
+#include "Dom/JsonValue.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// Finished jobs whose result is never collected are forgotten after this long
+const double JobRetentionSeconds = 10.0 * 60.0;
+
+// How often the table is checked for such jobs, whether or not anyone submits new ones
+const float JobEvictionIntervalSeconds = 60.0f;
+
+namespace MCPJobManager
+{
+    const TCHAR* GetStateName(EMCPJobState State)
+    {
+        switch (State)
+        {
+        case EMCPJobState::Queued:
+            return TEXT("queued");
+        case EMCPJobState::Running:
+            return TEXT("running");
+        case EMCPJobState::Succeeded:
+            return TEXT("succeeded");
+        case EMCPJobState::Failed:
+            return TEXT("failed");
+        default:
+            return TEXT("cancelled");
+        }
+    }
+
+    bool IsFinished(EMCPJobState State)
+    {
+        return State != EMCPJobState::Queued && State != EMCPJobState::Running;
+    }
+
+    TSharedPtr<FJsonObject> MakeSuccess(const TSharedPtr<FJsonObject>& Result)
+    {
+        TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
+        Response->SetStringField(TEXT("status"), TEXT("success"));
+        Response->SetObjectField(TEXT("result"), Result);
+        return Response;
+    }
+
+    TSharedPtr<FJsonObject> MakeError(const FString& Message)
+    {
+        TSharedPtr<FJsonObject> Response = MakeShared<FJsonObject>();
+        Response->SetStringField(TEXT("status"), TEXT("error"));
+        Response->SetStringField(TEXT("error"), Message);
+        return Response;
+    }
+}
+
+FMCPJobManager::FMCPJobManager(UUnrealMCPBridge* InBridge)
+    : Bridge(InBridge)
+    , NextJobId(1)
+{
+    EvictionTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this](float DeltaTime)
+    {
+        FScopeLock ScopeLock(&Lock);
+        EvictExpiredJobs();
+        return true;
+    }), JobEvictionIntervalSeconds);
+}
+
+FMCPJobManager::~FMCPJobManager()
+{
+    FTSTicker::GetCoreTicker().RemoveTicker(EvictionTickerHandle);
+}
+
+bool FMCPJobManager::IsJobCommand(const FString& CommandType)
+{
+    return CommandType == TEXT("submit") ||
+           CommandType == TEXT("job_status") ||
+           CommandType == TEXT("job_result") ||
+           CommandType == TEXT("job_cancel");
+}
+
+void FMCPJobManager::HandleCommand(int32 ClientId, const FString& CommandType, const TSharedPtr<FJsonObject>& Params, FMCPResponseCallback OnComplete)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(FMCPJobManager::HandleCommand);
+
+    if (CommandType == TEXT("job_result"))
+    {
+        // May keep OnComplete until the job finishes
+        GetResult(ClientId, Params, OnComplete);
+        return;
+    }
+
+    TSharedPtr<FJsonObject> Response;
+    if (CommandType == TEXT("submit"))
+    {
+        Response = Submit(ClientId, Params);
+    }
+    else if (CommandType == TEXT("job_status"))
+    {
+        Response = GetStatus(ClientId, Params);
+    }
+    else
+    {
+        Response = Cancel(ClientId, Params);
+    }
+    OnComplete(Response);
+}
+
+void FMCPJobManager::Reset()
+{
+    TArray<FMCPResponseCallback> Waiters;
+    {
+        FScopeLock ScopeLock(&Lock);
+        for (const TPair<int64, TSharedPtr<FJob>>& Pair : Jobs)
+        {
+            if (!MCPJobManager::IsFinished(Pair.Value->State))
+            {
+                Waiters.Append(FinishJob(*Pair.Value, EMCPJobState::Cancelled, MCPJobManager::MakeError(TEXT("Server stopped"))));
+            }
+        }
+        Jobs.Empty();
+    }
+
+    for (FMCPResponseCallback& Waiter : Waiters)
+    {
+        Waiter(MCPJobManager::MakeError(TEXT("Server stopped")));
+    }
+}
+
+TSharedPtr<FJsonObject> FMCPJobManager::Submit(int32 ClientId, const TSharedPtr<FJsonObject>& Params)
+{
+    FString CommandType;
+    if (!Params->TryGetStringField(TEXT("type"), CommandType))
+    {
+        return MCPJobManager::MakeError(TEXT("Missing 'type' parameter"));
+    }
+    if (IsJobCommand(CommandType))
+    {
+        return MCPJobManager::MakeError(FString::Printf(TEXT("'%s' can't run as a job"), *CommandType));
+    }
+
+    TSharedPtr<FJob> Job = MakeShared<FJob>();
+    Job->ClientId = ClientId;
+    Job->CommandType = CommandType;
+    Job->SubmitTime = FPlatformTime::Seconds();
+
+    const TSharedPtr<FJsonObject>* CommandParams = nullptr;
+    Job->Params = Params->TryGetObjectField(TEXT("params"), CommandParams) ? *CommandParams : MakeShared<FJsonObject>();
+
+    {
+        FScopeLock ScopeLock(&Lock);
+        EvictExpiredJobs();
+        Job->Id = NextJobId++;
+    }
+
+    FMCPCommandRequest Request;
+    Request.ClientId = ClientId;
+    Request.CommandType = CommandType;
+    Request.Params = Job->Params;
+    Request.CancelFlag = Job->CancelFlag = MakeShared<std::atomic<bool>>(false);
+    Request.bDetached = true;
+    Request.OnStart = [this, Job]()
+    {
+        return StartJob(Job);
+    };
+    Request.OnProgress = [this, Job](TSharedPtr<FJsonObject> Progress)
+    {
+        // Kept for job_status
+        FScopeLock ScopeLock(&Lock);
+        Job->Progress = Progress;
+    };
+    Request.OnComplete = [this, Job](TSharedPtr<FJsonObject> Response)
+    {
+        CompleteJob(Job, Response);
+    };
+
+    // Added to the table first, the queue may start it before Enqueue returns
+    TSharedPtr<FJsonObject> Result;
+    {
+        FScopeLock ScopeLock(&Lock);
+        Jobs.Add(Job->Id, Job);
+        Result = DescribeJob(*Job);
+    }
+
+    int32 RetryAfterMs = 0;
+    if (!Bridge->GetCommandQueue().Enqueue(MoveTemp(Request), RetryAfterMs))
+    {
+        FScopeLock ScopeLock(&Lock);
+        Jobs.Remove(Job->Id);
+        return FMCPCommandQueue::MakeBusyResponse(RetryAfterMs);
+    }
+
+    UE_LOG(LogTemp, Display, TEXT("MCPJobManager: Job %lld queued: %s"), Job->Id, *CommandType);
+    return MCPJobManager::MakeSuccess(Result);
+}
+
+bool FMCPJobManager::StartJob(const TSharedPtr<FJob>& Job)
+{
+    FScopeLock ScopeLock(&Lock);
+    if (Job->State != EMCPJobState::Queued)
+    {
+        // Cancelled before it got its turn
+        return false;
+    }
+    Job->State = EMCPJobState::Running;
+    Job->StartTime = FPlatformTime::Seconds();
+    return true;
+}
+
+void FMCPJobManager::CompleteJob(const TSharedPtr<FJob>& Job, const TSharedPtr<FJsonObject>& Response)
+{
+    FString Status;
+    const bool bSucceeded = Response->TryGetStringField(TEXT("status"), Status) && Status == TEXT("success");
+
+    TArray<FMCPResponseCallback> Waiters;
+    TSharedPtr<FJsonObject> Result;
+    {
+        FScopeLock ScopeLock(&Lock);
+        if (MCPJobManager::IsFinished(Job->State))
+        {
+            // Already cancelled, by job_cancel or when the server stopped
+            return;
+        }
+        Waiters = FinishJob(*Job, bSucceeded ? EMCPJobState::Succeeded : EMCPJobState::Failed, Response);
+        if (Waiters.Num() > 0)
+        {
+            // Whoever waited collects the result
+            Result = DescribeJob(*Job);
+            Jobs.Remove(Job->Id);
+        }
+    }
+
+    UE_LOG(LogTemp, Display, TEXT("MCPJobManager: Job %lld %s after %.3fs"), Job->Id, MCPJobManager::GetStateName(Job->State), Job->FinishTime - Job->StartTime);
+
+    for (FMCPResponseCallback& Waiter : Waiters)
+    {
+        Waiter(MCPJobManager::MakeSuccess(Result));
+    }
+}
+
+TArray<FMCPResponseCallback> FMCPJobManager::FinishJob(FJob& Job, EMCPJobState State, const TSharedPtr<FJsonObject>& Response)
+{
+    Job.State = State;
+    Job.Response = Response;
+    Job.FinishTime = FPlatformTime::Seconds();
+    return MoveTemp(Job.Waiters);
+}
+
+TSharedPtr<FJsonObject> FMCPJobManager::GetStatus(int32 ClientId, const TSharedPtr<FJsonObject>& Params)
+{
+    FScopeLock ScopeLock(&Lock);
+    TSharedPtr<FJob> Job = FindJob(ClientId, Params);
+    if (!Job.IsValid())
+    {
+        return MCPJobManager::MakeError(TEXT("Unknown job_id"));
+    }
+    return MCPJobManager::MakeSuccess(DescribeJob(*Job));
+}
+
+void FMCPJobManager::GetResult(int32 ClientId, const TSharedPtr<FJsonObject>& Params, FMCPResponseCallback& OnComplete)
+{
+    bool bWait = false;
+    Params->TryGetBoolField(TEXT("wait"), bWait);
+
+    TSharedPtr<FJsonObject> Response;
+    {
+        FScopeLock ScopeLock(&Lock);
+        TSharedPtr<FJob> Job = FindJob(ClientId, Params);
+        if (!Job.IsValid())
+        {
+            Response = MCPJobManager::MakeError(TEXT("Unknown job_id"));
+        }
+        else if (MCPJobManager::IsFinished(Job->State))
+        {
+            // The result is handed out once, then the job is forgotten
+            Response = MCPJobManager::MakeSuccess(DescribeJob(*Job));
+            Jobs.Remove(Job->Id);
+        }
+        else if (bWait && IsInGameThread())
+        {
+            // Inside a batch or a job, where the job can't run until this returns
+            Response = MCPJobManager::MakeError(TEXT("job_result can't wait on the game thread, as inside a batch or a job"));
+        }
+        else if (bWait)
+        {
+            Job->Waiters.Add(MoveTemp(OnComplete));
+            return;
+        }
+        else
+        {
+            Response = MCPJobManager::MakeSuccess(DescribeJob(*Job));
+        }
+    }
+    OnComplete(Response);
+}
+
+TSharedPtr<FJsonObject> FMCPJobManager::Cancel(int32 ClientId, const TSharedPtr<FJsonObject>& Params)
+{
+    TArray<FMCPResponseCallback> Waiters;
+    TSharedPtr<FJsonObject> Result;
+    {
+        FScopeLock ScopeLock(&Lock);
+        TSharedPtr<FJob> Job = FindJob(ClientId, Params);
+        if (!Job.IsValid())
+        {
+            return MCPJobManager::MakeError(TEXT("Unknown job_id"));
+        }
+
+        if (Job->State == EMCPJobState::Queued)
+        {
+            Waiters = FinishJob(*Job, EMCPJobState::Cancelled, MCPJobManager::MakeError(TEXT("Job cancelled")));
+        }
+        else if (Job->State == EMCPJobState::Running)
+        {
+            // Commands that check for it stop at their next checkpoint, others run to the end
+            Job->bCancelRequested = true;
+            Job->CancelFlag->store(true, std::memory_order_relaxed);
+        }
+        Result = DescribeJob(*Job);
+        if (Waiters.Num() > 0)
+        {
+            Jobs.Remove(Job->Id);
+        }
+    }
+
+    for (FMCPResponseCallback& Waiter : Waiters)
+    {
+        Waiter(MCPJobManager::MakeSuccess(Result));
+    }
+    return MCPJobManager::MakeSuccess(Result);
+}
+
+TSharedPtr<FMCPJobManager::FJob> FMCPJobManager::FindJob(int32 ClientId, const TSharedPtr<FJsonObject>& Params) const
+{
+    double JobId = 0;
+    if (!Params->TryGetNumberField(TEXT("job_id"), JobId))
+    {
+        return nullptr;
+    }
+    // Another client's job is reported as unknown, not as forbidden, so ids can't be probed
+    const TSharedPtr<FJob>* Job = Jobs.Find((int64)JobId);
+    return Job && (*Job)->ClientId == ClientId ? *Job : nullptr;
+}
+
+void FMCPJobManager::EvictExpiredJobs()
+{
+    const double Now = FPlatformTime::Seconds();
+    for (auto It = Jobs.CreateIterator(); It; ++It)
+    {
+        const FJob& Job = *It.Value();
+        if (MCPJobManager::IsFinished(Job.State) && Now - Job.FinishTime > JobRetentionSeconds)
+        {
+            It.RemoveCurrent();
+        }
+    }
+}
+
+TSharedPtr<FJsonObject> FMCPJobManager::DescribeJob(const FJob& Job) const
+{
+    TSharedPtr<FJsonObject> Result = MakeShared<FJsonObject>();
+    Result->SetNumberField(TEXT("job_id"), (double)Job.Id);
+    Result->SetStringField(TEXT("type"), Job.CommandType);
+    Result->SetStringField(TEXT("state"), MCPJobManager::GetStateName(Job.State));
+    if (Job.bCancelRequested)
+    {
+        Result->SetBoolField(TEXT("cancel_requested"), true);
+    }
+
+    const double Now = FPlatformTime::Seconds();
+    if (Job.State == EMCPJobState::Queued)
+    {
+        Result->SetNumberField(TEXT("queued_seconds"), Now - Job.SubmitTime);
+    }
+    else if (Job.State == EMCPJobState::Running)
+    {
+        Result->SetNumberField(TEXT("running_seconds"), Now - Job.StartTime);
+        if (Job.Progress.IsValid())
+        {
+            Result->SetObjectField(TEXT("progress"), Job.Progress);
+        }
+    }
+    else
+    {
+        Result->SetNumberField(TEXT("elapsed_seconds"), Job.FinishTime - Job.SubmitTime);
+        Result->SetObjectField(TEXT("response"), Job.Response);
+    }
+    return Result;
+}
@@ -0,0 +1,537 @@
+#include "MCPMessagePack.h"
+#include "Dom/JsonValue.h"
+#include "Misc/ByteSwap.h"
+
+// Nesting limit when decoding, so a hostile message can't exhaust the stack
+const int32 MessagePackMaxDepth = 128;
+
+namespace MCPMessagePack
+{
+    void WriteBigEndian(TArray<uint8>& Out, uint64 Value, int32 NumBytes)
+    {
+        const int32 Start = Out.AddUninitialized(NumBytes);
+        for (int32 Index = NumBytes - 1; Index >= 0; --Index)
+        {
+            Out[Start + Index] = (uint8)(Value & 0xFF);
+            Value >>= 8;
+        }
+    }
+
+    // Writes the smallest header for a str, array or map of Length elements
+    void WriteLengthHeader(TArray<uint8>& Out, uint32 Length, uint8 FixMarker, uint32 FixMax, uint8 Marker8, uint8 Marker16, uint8 Marker32)
+    {
+        if (Length <= FixMax)
+        {
+            Out.Add(FixMarker | (uint8)Length);
+        }
+        else if (Marker8 != 0 && Length <= 0xFF)
+        {
+            Out.Add(Marker8);
+            Out.Add((uint8)Length);
+        }
+        else if (Length <= 0xFFFF)
+        {
+            Out.Add(Marker16);
+            WriteBigEndian(Out, Length, 2);
+        }
+        else
+        {
+            Out.Add(Marker32);
+            WriteBigEndian(Out, Length, 4);
+        }
+    }
+
+    void WriteString(TArray<uint8>& Out, const FString& Value)
+    {
+        FTCHARToUTF8 Utf8(*Value, Value.Len());
+        WriteLengthHeader(Out, (uint32)Utf8.Length(), 0xA0, 31, 0xD9, 0xDA, 0xDB);
+        Out.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+    }
+
+    bool IsWholeNumber(double Value)
+    {
+        return Value == FMath::FloorToDouble(Value) && FMath::Abs(Value) <= 9007199254740992.0;
+    }
+
+    void WriteNumber(TArray<uint8>& Out, double Value)
+    {
+        if (!IsWholeNumber(Value))
+        {
+            Out.Add(0xCB);
+            WriteBigEndian(Out, BitCast<uint64>(Value), 8);
+            return;
+        }
+
+        const int64 Integer = (int64)Value;
+        if (Integer >= 0)
+        {
+            if (Integer <= 0x7F)
+            {
+                Out.Add((uint8)Integer);
+            }
+            else if (Integer <= 0xFF)
+            {
+                Out.Add(0xCC);
+                WriteBigEndian(Out, Integer, 1);
+            }
+            else if (Integer <= 0xFFFF)
+            {
+                Out.Add(0xCD);
+                WriteBigEndian(Out, Integer, 2);
+            }
+            else if (Integer <= 0xFFFFFFFFll)
+            {
+                Out.Add(0xCE);
+                WriteBigEndian(Out, Integer, 4);
+            }
+            else
+            {
+                Out.Add(0xCF);
+                WriteBigEndian(Out, Integer, 8);
+            }
+        }
+        else if (Integer >= -32)
+        {
+            Out.Add((uint8)(int8)Integer);
+        }
+        else if (Integer >= MIN_int8)
+        {
+            Out.Add(0xD0);
+            WriteBigEndian(Out, (uint64)Integer, 1);
+        }
+        else if (Integer >= MIN_int16)
+        {
+            Out.Add(0xD1);
+            WriteBigEndian(Out, (uint64)Integer, 2);
+        }
+        else if (Integer >= MIN_int32)
+        {
+            Out.Add(0xD2);
+            WriteBigEndian(Out, (uint64)Integer, 4);
+        }
+        else
+        {
+            Out.Add(0xD3);
+            WriteBigEndian(Out, (uint64)Integer, 8);
+        }
+    }
+
+    // Arrays of numbers with a fractional element go out as one packed float64 extension
+    bool TryWritePackedFloats(TArray<uint8>& Out, const TArray<TSharedPtr<FJsonValue>>& Values)
+    {
+        if (Values.Num() < 2)
+        {
+            return false;
+        }
+
+        bool bHasFraction = false;
+        for (const TSharedPtr<FJsonValue>& Value : Values)
+        {
+            if (!Value.IsValid() || Value->Type != EJson::Number)
+            {
+                return false;
+            }
+            bHasFraction |= !IsWholeNumber(Value->AsNumber());
+        }
+        if (!bHasFraction)
+        {
+            return false;
+        }
+
+        const uint32 DataSize = (uint32)Values.Num() * sizeof(double);
+        switch (DataSize)
+        {
+        case 8:
+            Out.Add(0xD7);
+            break;
+        case 16:
+            Out.Add(0xD8);
+            break;
+        default:
+            if (DataSize <= 0xFF)
+            {
+                Out.Add(0xC7);
+                WriteBigEndian(Out, DataSize, 1);
+            }
+            else if (DataSize <= 0xFFFF)
+            {
+                Out.Add(0xC8);
+                WriteBigEndian(Out, DataSize, 2);
+            }
+            else
+            {
+                Out.Add(0xC9);
+                WriteBigEndian(Out, DataSize, 4);
+            }
+            break;
+        }
+        Out.Add((uint8)FMCPMessagePack::PackedFloat64ExtType);
+
+        const int32 Start = Out.AddUninitialized(DataSize);
+        uint8* Dest = Out.GetData() + Start;
+        for (const TSharedPtr<FJsonValue>& Value : Values)
+        {
+            const double Number = Value->AsNumber();
+#if PLATFORM_LITTLE_ENDIAN
+            FMemory::Memcpy(Dest, &Number, sizeof(double));
+#else
+            const uint64 Bits = ByteSwap(BitCast<uint64>(Number));
+            FMemory::Memcpy(Dest, &Bits, sizeof(double));
+#endif
+            Dest += sizeof(double);
+        }
+        return true;
+    }
+
+    void WriteObject(TArray<uint8>& Out, const FJsonObject& Object);
+
+    void WriteValue(TArray<uint8>& Out, const TSharedPtr<FJsonValue>& Value)
+    {
+        if (!Value.IsValid())
+        {
+            Out.Add(0xC0);
+            return;
+        }
+
+        switch (Value->Type)
+        {
+        case EJson::Boolean:
+            Out.Add(Value->AsBool() ? 0xC3 : 0xC2);
+            break;
+        case EJson::Number:
+            WriteNumber(Out, Value->AsNumber());
+            break;
+        case EJson::String:
+            WriteString(Out, Value->AsString());
+            break;
+        case EJson::Array:
+        {
+            const TArray<TSharedPtr<FJsonValue>>& Values = Value->AsArray();
+            if (!TryWritePackedFloats(Out, Values))
+            {
+                WriteLengthHeader(Out, (uint32)Values.Num(), 0x90, 15, 0, 0xDC, 0xDD);
+                for (const TSharedPtr<FJsonValue>& Element : Values)
+                {
+                    WriteValue(Out, Element);
+                }
+            }
+            break;
+        }
+        case EJson::Object:
+        {
+            const TSharedPtr<FJsonObject>& Object = Value->AsObject();
+            if (Object.IsValid())
+            {
+                WriteObject(Out, *Object);
+            }
+            else
+            {
+                Out.Add(0xC0);
+            }
+            break;
+        }
+        default:
+            Out.Add(0xC0);
+            break;
+        }
+    }
+
+    void WriteObject(TArray<uint8>& Out, const FJsonObject& Object)
+    {
+        WriteLengthHeader(Out, (uint32)Object.Values.Num(), 0x80, 15, 0, 0xDE, 0xDF);
+        for (const TPair<FString, TSharedPtr<FJsonValue>>& Pair : Object.Values)
+        {
+            WriteString(Out, Pair.Key);
+            WriteValue(Out, Pair.Value);
+        }
+    }
+
+    /** Bounds checked cursor over the bytes being decoded */
+    struct FReader
+    {
+        const uint8* Data;
+        int32 Length;
+        int32 Offset;
+
+        bool ReadBigEndian(int32 NumBytes, uint64& OutValue)
+        {
+            if (Length - Offset < NumBytes)
+            {
+                return false;
+            }
+            OutValue = 0;
+            for (int32 Index = 0; Index < NumBytes; ++Index)
+            {
+                OutValue = (OutValue << 8) | Data[Offset++];
+            }
+            return true;
+        }
+
+        bool ReadString(uint32 Size, FString& OutValue)
+        {
+            if ((uint32)(Length - Offset) < Size)
+            {
+                return false;
+            }
+            FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Data + Offset), (int32)Size);
+            OutValue = FString(Converted.Length(), Converted.Get());
+            Offset += (int32)Size;
+            return true;
+        }
+
+        bool ReadValue(TSharedPtr<FJsonValue>& OutValue, int32 Depth);
+        bool ReadArray(uint32 Count, TSharedPtr<FJsonValue>& OutValue, int32 Depth);
+        bool ReadMap(uint32 Count, TSharedPtr<FJsonObject>& OutObject, int32 Depth);
+        bool ReadExt(uint32 Size, TSharedPtr<FJsonValue>& OutValue);
+    };
+
+    bool FReader::ReadArray(uint32 Count, TSharedPtr<FJsonValue>& OutValue, int32 Depth)
+    {
+        // Every element takes at least one byte, reject counts the message can't hold
+        if ((uint32)(Length - Offset) < Count)
+        {
+            return false;
+        }
+
+        TArray<TSharedPtr<FJsonValue>> Values;
+        Values.Reserve(Count);
+        for (uint32 Index = 0; Index < Count; ++Index)
+        {
+            TSharedPtr<FJsonValue> Element;
+            if (!ReadValue(Element, Depth + 1))
+            {
+                return false;
+            }
+            Values.Add(MoveTemp(Element));
+        }
+        OutValue = MakeShared<FJsonValueArray>(MoveTemp(Values));
+        return true;
+    }
+
+    bool FReader::ReadMap(uint32 Count, TSharedPtr<FJsonObject>& OutObject, int32 Depth)
+    {
+        if ((uint32)(Length - Offset) / 2 < Count)
+        {
+            return false;
+        }
+
+        OutObject = MakeShared<FJsonObject>();
+        OutObject->Values.Reserve(Count);
+        for (uint32 Index = 0; Index < Count; ++Index)
+        {
+            TSharedPtr<FJsonValue> Key;
+            if (!ReadValue(Key, Depth + 1) || !Key.IsValid() || Key->Type != EJson::String)
+            {
+                return false;
+            }
+            TSharedPtr<FJsonValue> Value;
+            if (!ReadValue(Value, Depth + 1))
+            {
+                return false;
+            }
+            OutObject->SetField(Key->AsString(), Value);
+        }
+        return true;
+    }
+
+    bool FReader::ReadExt(uint32 Size, TSharedPtr<FJsonValue>& OutValue)
+    {
+        if (Offset >= Length || (uint32)(Length - Offset - 1) < Size)
+        {
+            return false;
+        }
+        const int8 ExtType = (int8)Data[Offset++];
+        if (ExtType != FMCPMessagePack::PackedFloat64ExtType || Size % sizeof(double) != 0)
+        {
+            return false;
+        }
+
+        TArray<TSharedPtr<FJsonValue>> Values;
+        Values.Reserve(Size / sizeof(double));
+        for (uint32 Index = 0; Index < Size; Index += sizeof(double))
+        {
+            uint64 Bits;
+            FMemory::Memcpy(&Bits, Data + Offset + Index, sizeof(double));
+#if !PLATFORM_LITTLE_ENDIAN
+            Bits = ByteSwap(Bits);
+#endif
+            Values.Add(MakeShared<FJsonValueNumber>(BitCast<double>(Bits)));
+        }
+        Offset += (int32)Size;
+        OutValue = MakeShared<FJsonValueArray>(MoveTemp(Values));
+        return true;
+    }
+
+    bool FReader::ReadValue(TSharedPtr<FJsonValue>& OutValue, int32 Depth)
+    {
+        if (Depth > MessagePackMaxDepth || Offset >= Length)
+        {
+            return false;
+        }
+
+        const uint8 Marker = Data[Offset++];
+        uint64 Size = 0;
+
+        // Fixed width families
+        if (Marker <= 0x7F)
+        {
+            OutValue = MakeShared<FJsonValueNumber>(Marker);
+            return true;
+        }
+        if (Marker >= 0xE0)
+        {
+            OutValue = MakeShared<FJsonValueNumber>((int8)Marker);
+            return true;
+        }
+        if ((Marker & 0xE0) == 0xA0)
+        {
+            FString Value;
+            if (!ReadString(Marker & 0x1F, Value))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueString>(MoveTemp(Value));
+            return true;
+        }
+        if ((Marker & 0xF0) == 0x90)
+        {
+            return ReadArray(Marker & 0x0F, OutValue, Depth);
+        }
+        if ((Marker & 0xF0) == 0x80)
+        {
+            TSharedPtr<FJsonObject> Object;
+            if (!ReadMap(Marker & 0x0F, Object, Depth))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueObject>(Object);
+            return true;
+        }
+
+        switch (Marker)
+        {
+        case 0xC0:
+            OutValue = MakeShared<FJsonValueNull>();
+            return true;
+        case 0xC2:
+        case 0xC3:
+            OutValue = MakeShared<FJsonValueBoolean>(Marker == 0xC3);
+            return true;
+        case 0xCA:
+            if (!ReadBigEndian(4, Size))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueNumber>(BitCast<float>((uint32)Size));
+            return true;
+        case 0xCB:
+            if (!ReadBigEndian(8, Size))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueNumber>(BitCast<double>(Size));
+            return true;
+        case 0xCC:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            if (!ReadBigEndian(1 << (Marker - 0xCC), Size))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueNumber>((double)Size);
+            return true;
+        case 0xD0:
+            if (!ReadBigEndian(1, Size))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueNumber>((int8)Size);
+            return true;
+        case 0xD1:
+            if (!ReadBigEndian(2, Size))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueNumber>((int16)Size);
+            return true;
+        case 0xD2:
+            if (!ReadBigEndian(4, Size))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueNumber>((int32)Size);
+            return true;
+        case 0xD3:
+            if (!ReadBigEndian(8, Size))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueNumber>((double)(int64)Size);
+            return true;
+        case 0xD9:
+        case 0xDA:
+        case 0xDB:
+        {
+            FString Value;
+            if (!ReadBigEndian(1 << (Marker - 0xD9), Size) || !ReadString((uint32)Size, Value))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueString>(MoveTemp(Value));
+            return true;
+        }
+        case 0xDC:
+        case 0xDD:
+            if (!ReadBigEndian(Marker == 0xDC ? 2 : 4, Size))
+            {
+                return false;
+            }
+            return ReadArray((uint32)Size, OutValue, Depth);
+        case 0xDE:
+        case 0xDF:
+        {
+            TSharedPtr<FJsonObject> Object;
+            if (!ReadBigEndian(Marker == 0xDE ? 2 : 4, Size) || !ReadMap((uint32)Size, Object, Depth))
+            {
+                return false;
+            }
+            OutValue = MakeShared<FJsonValueObject>(Object);
+            return true;
+        }
+        case 0xD4:
+        case 0xD5:
+        case 0xD6:
+        case 0xD7:
+        case 0xD8:
+            return ReadExt(1u << (Marker - 0xD4), OutValue);
+        case 0xC7:
+        case 0xC8:
+        case 0xC9:
+            if (!ReadBigEndian(1 << (Marker - 0xC7), Size))
+            {
+                return false;
+            }
+            return ReadExt((uint32)Size, OutValue);
+        default:
+            // bin types and the unused marker have no JSON equivalent
+            return false;
+        }
+    }
+}
+
+void FMCPMessagePack::Write(const TSharedRef<FJsonObject>& Object, TArray<uint8>& Out)
+{
+    MCPMessagePack::WriteObject(Out, *Object);
+}
+
+TSharedPtr<FJsonObject> FMCPMessagePack::Read(const uint8* Data, int32 Length)
+{
+    MCPMessagePack::FReader Reader{ Data, Length, 0 };
+    TSharedPtr<FJsonValue> Value;
+    if (!Reader.ReadValue(Value, 0) || Reader.Offset != Length || !Value.IsValid() || Value->Type != EJson::Object)
+    {
+        return nullptr;
+    }
+    return Value->AsObject();
+}
@@ -0,0 +1,219 @@
+#include "MCPServerStats.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/FileHelper.h"
+#include "Misc/DateTime.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+
+// Command type the requests beyond FMCPServerStats::MaxCommandTypes are counted under
+static const TCHAR* OverflowCommandType = TEXT("(other)");
+
+void FMCPLatencyHistogram::Add(double Seconds)
+{
+    const uint64 Micros = (uint64)FMath::Max(Seconds * 1000000.0, 0.0);
+
+    // Values below 4 us get a bucket each, above that four buckets per power of two
+    int32 Index = (int32)Micros;
+    if (Micros >= 4)
+    {
+        const int32 Exponent = (int32)FMath::FloorLog2_64(Micros);
+        const int32 Fraction = (int32)((Micros >> (Exponent - 2)) & 3);
+        Index = Exponent * 4 + Fraction;
+    }
+    ++Buckets[FMath::Min(Index, NumBuckets - 1)];
+
+    ++Count;
+    TotalSeconds += Seconds;
+    MaxSeconds = FMath::Max(MaxSeconds, Seconds);
+}
+
+double FMCPLatencyHistogram::GetPercentileMs(double Fraction) const
+{
+    if (Count == 0)
+    {
+        return 0.0;
+    }
+
+    const int64 Target = FMath::Max((int64)FMath::CeilToDouble(Fraction * Count), (int64)1);
+    int64 Seen = 0;
+    for (int32 Index = 0; Index < NumBuckets; ++Index)
+    {
+        Seen += Buckets[Index];
+        if (Seen < Target)
+        {
+            continue;
+        }
+
+        // Middle of the bucket, never above the largest sample
+        double Micros = (double)Index;
+        if (Index >= 8)
+        {
+            const int32 Exponent = Index / 4;
+            const double Lower = (double)((4 + Index % 4) * (1ull << (Exponent - 2)));
+            const double Width = (double)(1ull << (Exponent - 2));
+            Micros = Lower + Width * 0.5;
+        }
+        return FMath::Min(Micros / 1000.0, MaxSeconds * 1000.0);
+    }
+    return MaxSeconds * 1000.0;
+}
+
+TSharedPtr<FJsonObject> FMCPLatencyHistogram::ToJson() const
+{
+    TSharedPtr<FJsonObject> Json = MakeShared<FJsonObject>();
+    Json->SetNumberField(TEXT("count"), (double)Count);
+    Json->SetNumberField(TEXT("average_ms"), Count > 0 ? TotalSeconds * 1000.0 / Count : 0.0);
+    Json->SetNumberField(TEXT("p50_ms"), GetPercentileMs(0.50));
+    Json->SetNumberField(TEXT("p95_ms"), GetPercentileMs(0.95));
+    Json->SetNumberField(TEXT("p99_ms"), GetPercentileMs(0.99));
+    Json->SetNumberField(TEXT("max_ms"), MaxSeconds * 1000.0);
+    return Json;
+}
+
+FMCPServerStats::FMCPServerStats()
+    : StartTime(FPlatformTime::Seconds())
+{
+}
+
+const TCHAR* FMCPServerStats::GetStageName(EMCPStatStage Stage)
+{
+    switch (Stage)
+    {
+    case EMCPStatStage::Receive:    return TEXT("receive");
+    case EMCPStatStage::Parse:      return TEXT("parse");
+    case EMCPStatStage::QueueWait:  return TEXT("queue_wait");
+    case EMCPStatStage::Handler:    return TEXT("handler");
+    case EMCPStatStage::Serialize:  return TEXT("serialize");
+    case EMCPStatStage::Send:       return TEXT("send");
+    default:                        return TEXT("unknown");
+    }
+}
+
+FMCPServerStats::FCommandStats& FMCPServerStats::FindOrAdd(const FString& CommandType)
+{
+    if (FCommandStats* Existing = Commands.Find(CommandType))
+    {
+        return *Existing;
+    }
+    if (Commands.Num() >= MaxCommandTypes)
+    {
+        return Commands.FindOrAdd(OverflowCommandType);
+    }
+    return Commands.Add(CommandType);
+}
+
+void FMCPServerStats::RecordReceived(const FString& CommandType, int32 RequestBytes, double ReceiveSeconds, double ParseSeconds)
+{
+    FScopeLock ScopeLock(&Lock);
+    FCommandStats& Stats = FindOrAdd(CommandType);
+    ++Stats.Requests;
+    Stats.RequestBytes += RequestBytes;
+    Stats.MaxRequestBytes = FMath::Max(Stats.MaxRequestBytes, (int64)RequestBytes);
+    Stats.Stages[(int32)EMCPStatStage::Receive].Add(ReceiveSeconds);
+    Stats.Stages[(int32)EMCPStatStage::Parse].Add(ParseSeconds);
+}
+
+void FMCPServerStats::RecordRun(const FString& CommandType, double WaitSeconds, TOptional<double> HandlerSeconds)
+{
+    FScopeLock ScopeLock(&Lock);
+    FCommandStats& Stats = FindOrAdd(CommandType);
+    Stats.Stages[(int32)EMCPStatStage::QueueWait].Add(WaitSeconds);
+    if (HandlerSeconds.IsSet())
+    {
+        Stats.Stages[(int32)EMCPStatStage::Handler].Add(HandlerSeconds.GetValue());
+    }
+}
+
+void FMCPServerStats::RecordSent(const FString& CommandType, int32 ResponseBytes, double SerializeSeconds, double SendSeconds, bool bError)
+{
+    FScopeLock ScopeLock(&Lock);
+    FCommandStats& Stats = FindOrAdd(CommandType);
+    ++Stats.Responses;
+    Stats.Errors += bError ? 1 : 0;
+    Stats.ResponseBytes += ResponseBytes;
+    Stats.MaxResponseBytes = FMath::Max(Stats.MaxResponseBytes, (int64)ResponseBytes);
+    Stats.Stages[(int32)EMCPStatStage::Serialize].Add(SerializeSeconds);
+    Stats.Stages[(int32)EMCPStatStage::Send].Add(SendSeconds);
+}
+
+TSharedPtr<FJsonObject> FMCPServerStats::ToJson() const
+{
+    FScopeLock ScopeLock(&Lock);
+
+    int64 TotalRequests = 0;
+    int64 TotalErrors = 0;
+    TSharedPtr<FJsonObject> CommandsJson = MakeShared<FJsonObject>();
+    for (const TPair<FString, FCommandStats>& Pair : Commands)
+    {
+        const FCommandStats& Stats = Pair.Value;
+        TotalRequests += Stats.Requests;
+        TotalErrors += Stats.Errors;
+
+        TSharedPtr<FJsonObject> CommandJson = MakeShared<FJsonObject>();
+        CommandJson->SetNumberField(TEXT("requests"), (double)Stats.Requests);
+        CommandJson->SetNumberField(TEXT("errors"), (double)Stats.Errors);
+
+        TSharedPtr<FJsonObject> RequestBytes = MakeShared<FJsonObject>();
+        RequestBytes->SetNumberField(TEXT("total"), (double)Stats.RequestBytes);
+        RequestBytes->SetNumberField(TEXT("average"), Stats.Requests > 0 ? (double)Stats.RequestBytes / Stats.Requests : 0.0);
+        RequestBytes->SetNumberField(TEXT("max"), (double)Stats.MaxRequestBytes);
+        CommandJson->SetObjectField(TEXT("request_bytes"), RequestBytes);
+
+        TSharedPtr<FJsonObject> ResponseBytes = MakeShared<FJsonObject>();
+        ResponseBytes->SetNumberField(TEXT("total"), (double)Stats.ResponseBytes);
+        ResponseBytes->SetNumberField(TEXT("average"), Stats.Responses > 0 ? (double)Stats.ResponseBytes / Stats.Responses : 0.0);
+        ResponseBytes->SetNumberField(TEXT("max"), (double)Stats.MaxResponseBytes);
+        CommandJson->SetObjectField(TEXT("response_bytes"), ResponseBytes);
+
+        for (int32 Stage = 0; Stage < (int32)EMCPStatStage::Count; ++Stage)
+        {
+            CommandJson->SetObjectField(GetStageName((EMCPStatStage)Stage), Stats.Stages[Stage].ToJson());
+        }
+        CommandsJson->SetObjectField(Pair.Key, CommandJson);
+    }
+
+    TSharedPtr<FJsonObject> Json = MakeShared<FJsonObject>();
+    Json->SetNumberField(TEXT("uptime_seconds"), FPlatformTime::Seconds() - StartTime);
+    Json->SetNumberField(TEXT("requests"), (double)TotalRequests);
+    Json->SetNumberField(TEXT("errors"), (double)TotalErrors);
+    Json->SetObjectField(TEXT("commands"), CommandsJson);
+    return Json;
+}
+
+bool FMCPServerStats::AppendCsv(const FString& Path) const
+{
+    const FString Timestamp = FDateTime::UtcNow().ToIso8601();
+
+    FString Csv;
+    if (IFileManager::Get().FileSize(*Path) <= 0)
+    {
+        Csv += TEXT("timestamp,command,requests,errors,request_bytes,response_bytes,stage,count,average_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+    }
+
+    {
+        FScopeLock ScopeLock(&Lock);
+        for (const TPair<FString, FCommandStats>& Pair : Commands)
+        {
+            const FCommandStats& Stats = Pair.Value;
+            for (int32 Stage = 0; Stage < (int32)EMCPStatStage::Count; ++Stage)
+            {
+                const FMCPLatencyHistogram& Histogram = Stats.Stages[Stage];
+                Csv += FString::Printf(TEXT("%s,%s,%lld,%lld,%lld,%lld,%s,%lld,%.3f,%.3f,%.3f,%.3f,%.3f\n"),
+                    *Timestamp, *Pair.Key, Stats.Requests, Stats.Errors, Stats.RequestBytes, Stats.ResponseBytes,
+                    GetStageName((EMCPStatStage)Stage), Histogram.Count,
+                    Histogram.Count > 0 ? Histogram.TotalSeconds * 1000.0 / Histogram.Count : 0.0,
+                    Histogram.GetPercentileMs(0.50), Histogram.GetPercentileMs(0.95), Histogram.GetPercentileMs(0.99),
+                    Histogram.MaxSeconds * 1000.0);
+            }
+        }
+    }
+
+    return FFileHelper::SaveStringToFile(Csv, *Path, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+void FMCPServerStats::Reset()
+{
+    FScopeLock ScopeLock(&Lock);
+    Commands.Empty();
+    StartTime = FPlatformTime::Seconds();
+}
@@ -0,0 +1,340 @@
+#include "MCPSharedMemorySocket.h"
+
+#if WITH_MCP_SHARED_MEMORY
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+const FName FMCPSharedMemorySocket::ProtocolName(TEXT("SharedMemory"));
+
+struct FMCPSharedMemoryControl
+{
+    uint8 Magic[4];
+    uint32 Version;
+    uint64 RingSize;
+    std::atomic<uint32> ClientClosed;
+    std::atomic<uint32> EditorClosed;
+};
+
+/** Header of one byte ring; producer and consumer fields sit on separate cache lines */
+struct FMCPSharedRing
+{
+    alignas(64) std::atomic<uint64> Head;
+    alignas(64) std::atomic<uint64> Tail;
+    alignas(64) std::atomic<uint32> DataDoorbell;
+    std::atomic<uint32> ReaderAsleep;
+    alignas(64) std::atomic<uint32> SpaceDoorbell;
+    std::atomic<uint32> WriterAsleep;
+};
+
+static_assert(sizeof(FMCPSharedMemoryControl) <= FMCPSharedMemorySocket::ControlSize, "Shared memory control block overflows its slot");
+static_assert(sizeof(FMCPSharedRing) <= FMCPSharedMemorySocket::RingHeaderSize, "Shared ring header overflows its slot");
+static_assert(offsetof(FMCPSharedRing, Tail) == 64 && offsetof(FMCPSharedRing, DataDoorbell) == 128 && offsetof(FMCPSharedRing, SpaceDoorbell) == 192,
+    "Shared ring header layout is part of the protocol");
+static_assert(std::atomic<uint64>::is_always_lock_free && std::atomic<uint32>::is_always_lock_free,
+    "Shared memory atomics must be lock free to work across processes");
+
+namespace MCPSharedMemory
+{
+    // Futexes on a shared mapping must not use the process private variants
+    void FutexWait(std::atomic<uint32>& Word, uint32 Expected, const FTimespan& WaitTime)
+    {
+        timespec Timeout;
+        const int64 Nanoseconds = WaitTime.GetTicks() * ETimespan::NanosecondsPerTick;
+        Timeout.tv_sec = (time_t)(Nanoseconds / 1000000000);
+        Timeout.tv_nsec = (long)(Nanoseconds % 1000000000);
+        syscall(SYS_futex, reinterpret_cast<uint32*>(&Word), FUTEX_WAIT, Expected, &Timeout, nullptr, 0);
+    }
+
+    void FutexWakeAll(std::atomic<uint32>& Word)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32*>(&Word), FUTEX_WAKE, MAX_int32, nullptr, nullptr, 0);
+    }
+
+    // Ring the doorbell, paying for the syscall only when the other side sleeps on it
+    void Ring(std::atomic<uint32>& Doorbell, std::atomic<uint32>& Asleep)
+    {
+        Doorbell.fetch_add(1);
+        if (Asleep.load() != 0)
+        {
+            FutexWakeAll(Doorbell);
+        }
+    }
+
+    void WakeEverything(FMCPSharedRing& Ring)
+    {
+        Ring.DataDoorbell.fetch_add(1);
+        Ring.SpaceDoorbell.fetch_add(1);
+        FutexWakeAll(Ring.DataDoorbell);
+        FutexWakeAll(Ring.SpaceDoorbell);
+    }
+}
+
+FMCPSharedMemorySocket* FMCPSharedMemorySocket::Create(const FString& Name, uint64 RequestedRingSize)
+{
+    const uint64 RingSize = FMath::RoundUpToPowerOfTwo64(FMath::Clamp(RequestedRingSize, MinRingSize, MaxRingSize));
+    const uint64 RegionSize = DataOffset + 2 * RingSize;
+
+    FTCHARToUTF8 Utf8Name(*Name);
+    const int Descriptor = shm_open(Utf8Name.Get(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (Descriptor < 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("MCPSharedMemorySocket: Failed to create %s (errno %d)"), *Name, errno);
+        return nullptr;
+    }
+
+    uint8* Region = nullptr;
+    if (ftruncate(Descriptor, (off_t)RegionSize) == 0)
+    {
+        void* Mapped = mmap(nullptr, RegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, Descriptor, 0);
+        Region = Mapped != MAP_FAILED ? static_cast<uint8*>(Mapped) : nullptr;
+    }
+    const int MapError = errno;
+
+    // The mapping keeps the memory alive, the descriptor isn't needed anymore
+    close(Descriptor);
+
+    if (!Region)
+    {
+        UE_LOG(LogTemp, Error, TEXT("MCPSharedMemorySocket: Failed to map %llu bytes for %s (errno %d)"), RegionSize, *Name, MapError);
+        shm_unlink(Utf8Name.Get());
+        return nullptr;
+    }
+
+    // A fresh object is zero filled, which is the empty state of both rings
+    return new FMCPSharedMemorySocket(Name, Region, RegionSize, RingSize);
+}
+
+FMCPSharedMemorySocket::FMCPSharedMemorySocket(const FString& InName, uint8* InRegion, uint64 InRegionSize, uint64 InRingSize)
+    : FMCPLocalSocket(TEXT("UnrealMCPSharedMemory"), ProtocolName)
+    , Name(InName)
+    , Region(InRegion)
+    , RegionSize(InRegionSize)
+    , RingSize(InRingSize)
+{
+    Control = new (Region) FMCPSharedMemoryControl();
+    RequestRing = new (Region + ControlSize) FMCPSharedRing();
+    ResponseRing = new (Region + ControlSize + RingHeaderSize) FMCPSharedRing();
+    RequestData = Region + DataOffset;
+    ResponseData = Region + DataOffset + RingSize;
+
+    Control->Version = Version;
+    Control->RingSize = RingSize;
+    // Written last, a client that sees the magic sees a complete header
+    std::atomic_thread_fence(std::memory_order_release);
+    FMemory::Memcpy(Control->Magic, "UMSM", 4);
+}
+
+FMCPSharedMemorySocket::~FMCPSharedMemorySocket()
+{
+    Close();
+}
+
+bool FMCPSharedMemorySocket::IsClosed() const
+{
+    return Control->ClientClosed.load() != 0 || Control->EditorClosed.load() != 0;
+}
+
+bool FMCPSharedMemorySocket::Shutdown(ESocketShutdownMode Mode)
+{
+    if (!Region)
+    {
+        return false;
+    }
+
+    // Both sides' waits are woken, including the editor's own connection thread
+    Control->EditorClosed.store(1);
+    MCPSharedMemory::WakeEverything(*RequestRing);
+    MCPSharedMemory::WakeEverything(*ResponseRing);
+    return true;
+}
+
+bool FMCPSharedMemorySocket::Close()
+{
+    if (!Region)
+    {
+        return false;
+    }
+
+    Shutdown(ESocketShutdownMode::ReadWrite);
+    munmap(Region, RegionSize);
+    Region = nullptr;
+
+    // Usually already gone, the client unlinks the name once it has mapped the region
+    shm_unlink(TCHAR_TO_UTF8(*Name));
+    return true;
+}
+
+bool FMCPSharedMemorySocket::HasPendingData(uint32& PendingDataSize)
+{
+    const uint64 Available = RequestRing->Head.load(std::memory_order_acquire) - RequestRing->Tail.load(std::memory_order_relaxed);
+    PendingDataSize = (uint32)FMath::Min<uint64>(Available, MAX_uint32);
+    return PendingDataSize > 0;
+}
+
+bool FMCPSharedMemorySocket::Send(const uint8* Data, int32 Count, int32& BytesSent)
+{
+    BytesSent = 0;
+    if (IsClosed())
+    {
+        errno = EPIPE;
+        return false;
+    }
+
+    const uint64 Head = ResponseRing->Head.load(std::memory_order_relaxed);
+    const uint64 Tail = ResponseRing->Tail.load(std::memory_order_acquire);
+    if (!CheckRing(Head, Tail, TEXT("response")))
+    {
+        return false;
+    }
+
+    const uint64 Free = RingSize - (Head - Tail);
+    if (Free == 0)
+    {
+        errno = EAGAIN;
+        return false;
+    }
+
+    // Copy in up to two pieces when the write wraps around the end of the ring
+    const uint64 ToWrite = FMath::Min3<uint64>(Free, (uint64)Count, RingSize);
+    const uint64 Start = Head & (RingSize - 1);
+    const uint64 FirstPart = FMath::Min<uint64>(ToWrite, RingSize - Start);
+    FMemory::Memcpy(ResponseData + Start, Data, FirstPart);
+    FMemory::Memcpy(ResponseData, Data + FirstPart, ToWrite - FirstPart);
+
+    ResponseRing->Head.store(Head + ToWrite, std::memory_order_seq_cst);
+    MCPSharedMemory::Ring(ResponseRing->DataDoorbell, ResponseRing->ReaderAsleep);
+
+    BytesSent = (int32)ToWrite;
+    return true;
+}
+
+bool FMCPSharedMemorySocket::Recv(uint8* Data, int32 BufferSize, int32& BytesRead, ESocketReceiveFlags::Type Flags)
+{
+    BytesRead = 0;
+
+    const uint64 Tail = RequestRing->Tail.load(std::memory_order_relaxed);
+    const uint64 Head = RequestRing->Head.load(std::memory_order_acquire);
+    if (!CheckRing(Head, Tail, TEXT("request")))
+    {
+        return false;
+    }
+
+    const uint64 Available = Head - Tail;
+    if (Available == 0)
+    {
+        // Zero bytes from a successful read is how a closed peer shows up on a socket too
+        if (IsClosed())
+        {
+            return true;
+        }
+        errno = EAGAIN;
+        return false;
+    }
+
+    const uint64 ToRead = FMath::Min3<uint64>(Available, (uint64)BufferSize, RingSize);
+    const uint64 Start = Tail & (RingSize - 1);
+    const uint64 FirstPart = FMath::Min<uint64>(ToRead, RingSize - Start);
+    FMemory::Memcpy(Data, RequestData + Start, FirstPart);
+    FMemory::Memcpy(Data + FirstPart, RequestData, ToRead - FirstPart);
+
+    if ((Flags & ESocketReceiveFlags::Peek) == 0)
+    {
+        RequestRing->Tail.store(Tail + ToRead, std::memory_order_seq_cst);
+        MCPSharedMemory::Ring(RequestRing->SpaceDoorbell, RequestRing->WriterAsleep);
+    }
+
+    BytesRead = (int32)ToRead;
+    return true;
+}
+
+bool FMCPSharedMemorySocket::CheckRing(uint64 Head, uint64 Tail, const TCHAR* RingName)
+{
+    // Both counters live in memory the client can write, a ring holding more than its size was corrupted
+    if (Head - Tail <= RingSize)
+    {
+        return true;
+    }
+
+    UE_LOG(LogTemp, Error, TEXT("MCPSharedMemorySocket: Closing %s, %s ring head %llu and tail %llu are %llu bytes apart in a ring of %llu"),
+        *Name, RingName, Head, Tail, Head - Tail, RingSize);
+    Shutdown(ESocketShutdownMode::ReadWrite);
+    errno = EPROTO;
+    return false;
+}
+
+bool FMCPSharedMemorySocket::WaitOnRing(FMCPSharedRing& Ring, bool bForData, FTimespan WaitTime)
+{
+    std::atomic<uint32>& Doorbell = bForData ? Ring.DataDoorbell : Ring.SpaceDoorbell;
+    std::atomic<uint32>& Asleep = bForData ? Ring.ReaderAsleep : Ring.WriterAsleep;
+
+    auto IsReady = [this, &Ring, bForData]()
+    {
+        const uint64 Used = Ring.Head.load() - Ring.Tail.load();
+        return IsClosed() || (bForData ? Used > 0 : Used < RingSize);
+    };
+
+    const double Deadline = FPlatformTime::Seconds() + WaitTime.GetTotalSeconds();
+    while (true)
+    {
+        if (IsReady())
+        {
+            return true;
+        }
+
+        // Announce the sleep, then check again so a ring between the two can't be missed
+        const uint32 Seen = Doorbell.load();
+        Asleep.store(1);
+        if (IsReady())
+        {
+            Asleep.store(0);
+            return true;
+        }
+
+        const double Remaining = Deadline - FPlatformTime::Seconds();
+        if (Remaining <= 0.0)
+        {
+            Asleep.store(0);
+            return false;
+        }
+        MCPSharedMemory::FutexWait(Doorbell, Seen, FTimespan::FromSeconds(Remaining));
+        Asleep.store(0);
+    }
+}
+
+bool FMCPSharedMemorySocket::Wait(ESocketWaitConditions::Type Condition, FTimespan WaitTime)
+{
+    if (!Region)
+    {
+        return false;
+    }
+
+    switch (Condition)
+    {
+    case ESocketWaitConditions::WaitForRead:
+        return WaitOnRing(*RequestRing, true, WaitTime);
+    case ESocketWaitConditions::WaitForWrite:
+        return WaitOnRing(*ResponseRing, false, WaitTime);
+    default:
+    {
+        // Used while output waits for the client. Sleeps on the space doorbell only, a request
+        // arriving meanwhile is noticed when the client frees space or the wait times out.
+        uint32 Pending = 0;
+        return HasPendingData(Pending) || WaitOnRing(*ResponseRing, false, WaitTime);
+    }
+    }
+}
+
+ESocketConnectionState FMCPSharedMemorySocket::GetConnectionState()
+{
+    return Region && !IsClosed() ? SCS_Connected : SCS_ConnectionError;
+}
+
+#endif // WITH_MCP_SHARED_MEMORY
@@ -0,0 +1,138 @@
+#include "MCPTransaction.h"
+#include "ScopedTransaction.h"
+#include "EditorAssetLibrary.h"
+#include "Engine/Blueprint.h"
+#include "Kismet2/KismetEditorUtilities.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+FMCPTransaction* FMCPTransaction::Current = nullptr;
+
+FMCPTransaction::FMCPTransaction(const FText& Description)
+    : HeldBackCompileCount(0)
+    , HeldBackSaveCount(0)
+{
+    check(IsInGameThread());
+    check(Current == nullptr);
+
+    Transaction = MakeUnique<FScopedTransaction>(Description);
+    Current = this;
+}
+
+FMCPTransaction::~FMCPTransaction()
+{
+    if (Current == this)
+    {
+        Commit();
+    }
+}
+
+TSharedPtr<FJsonObject> FMCPTransaction::Commit()
+{
+    check(Current == this);
+    Current = nullptr;
+
+    // Compile first, the saves should write the compiled blueprints
+    int32 CompiledCount = 0;
+    for (const TWeakObjectPtr<UBlueprint>& Blueprint : PendingCompiles)
+    {
+        if (Blueprint.IsValid())
+        {
+            FKismetEditorUtilities::CompileBlueprint(Blueprint.Get());
+            ++CompiledCount;
+        }
+    }
+
+    int32 SavedCount = 0;
+    int32 FailedSaveCount = 0;
+    for (const FPendingSave& Save : PendingSaves)
+    {
+        if (Save.Package.IsValid())
+        {
+            if (SavePackageNow(Save.Package.Get(), Save.Asset.Get()))
+            {
+                ++SavedCount;
+            }
+            else
+            {
+                ++FailedSaveCount;
+            }
+        }
+    }
+
+    Transaction.Reset();
+
+    UE_LOG(LogTemp, Display, TEXT("MCPTransaction: Committed, %d compile(s) instead of %d, %d save(s) instead of %d"),
+        CompiledCount, HeldBackCompileCount, SavedCount + FailedSaveCount, HeldBackSaveCount);
+
+    TSharedPtr<FJsonObject> Result = MakeShared<FJsonObject>();
+    Result->SetNumberField(TEXT("compiled"), CompiledCount);
+    Result->SetNumberField(TEXT("saved"), SavedCount);
+    Result->SetNumberField(TEXT("failed_saves"), FailedSaveCount);
+    Result->SetNumberField(TEXT("compiles_requested"), HeldBackCompileCount);
+    Result->SetNumberField(TEXT("saves_requested"), HeldBackSaveCount);
+    return Result;
+}
+
+void FMCPTransaction::CompileBlueprint(UBlueprint* Blueprint)
+{
+    if (!Current)
+    {
+        FKismetEditorUtilities::CompileBlueprint(Blueprint);
+        return;
+    }
+
+    ++Current->HeldBackCompileCount;
+    Current->PendingCompiles.AddUnique(Blueprint);
+}
+
+void FMCPTransaction::EnsureCompiled(UBlueprint* Blueprint)
+{
+    if (Current && Current->PendingCompiles.Remove(Blueprint) > 0)
+    {
+        FKismetEditorUtilities::CompileBlueprint(Blueprint);
+    }
+}
+
+void FMCPTransaction::CompileBlueprintNow(UBlueprint* Blueprint)
+{
+    // Edits made after this compile hold back a new one
+    if (Current)
+    {
+        Current->PendingCompiles.Remove(Blueprint);
+    }
+    FKismetEditorUtilities::CompileBlueprint(Blueprint);
+}
+
+bool FMCPTransaction::SavePackage(UPackage* Package, UObject* Asset)
+{
+    if (!Current)
+    {
+        return SavePackageNow(Package, Asset);
+    }
+
+    ++Current->HeldBackSaveCount;
+    if (!Current->PendingSaves.ContainsByPredicate([Package](const FPendingSave& Save) { return Save.Package == Package; }))
+    {
+        Current->PendingSaves.Add({Package, Asset});
+    }
+    return true;
+}
+
+bool FMCPTransaction::SaveAsset(UObject* Asset)
+{
+    if (!Current)
+    {
+        return UEditorAssetLibrary::SaveLoadedAsset(Asset, false);
+    }
+    return SavePackage(Asset->GetOutermost(), Asset);
+}
+
+bool FMCPTransaction::SavePackageNow(UPackage* Package, UObject* Asset)
+{
+    FString PackageFileName = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+    FSavePackageArgs SaveArgs;
+    SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+    return UPackage::SavePackage(Package, Asset, *PackageFileName, SaveArgs);
+}
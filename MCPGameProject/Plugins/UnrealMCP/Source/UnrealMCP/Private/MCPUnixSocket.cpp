@@ -0,0 +1,300 @@
+#include "MCPUnixSocket.h"
+
+#if WITH_MCP_UNIX_SOCKET
+
+#include "SocketSubsystem.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const FName FMCPUnixSocket::ProtocolName(TEXT("Unix"));
+
+namespace MCPUnixSocket
+{
+    bool MakeAddress(const FString& Path, sockaddr_un& OutAddress)
+    {
+        FTCHARToUTF8 Utf8Path(*Path);
+        if (Utf8Path.Length() >= (int32)sizeof(OutAddress.sun_path))
+        {
+            return false;
+        }
+
+        FMemory::Memzero(OutAddress);
+        OutAddress.sun_family = AF_UNIX;
+        FMemory::Memcpy(OutAddress.sun_path, Utf8Path.Get(), Utf8Path.Length());
+        return true;
+    }
+
+    bool IsSocketFile(const FString& Path)
+    {
+        struct stat FileStat;
+        return lstat(TCHAR_TO_UTF8(*Path), &FileStat) == 0 && S_ISSOCK(FileStat.st_mode);
+    }
+
+    // poll() on a single descriptor, retrying when a signal interrupts it
+    int32 PollOne(int Descriptor, short Events, const FTimespan& WaitTime, short& OutRevents)
+    {
+        pollfd PollFd;
+        PollFd.fd = Descriptor;
+        PollFd.events = Events;
+        PollFd.revents = 0;
+
+        const int TimeoutMs = WaitTime < FTimespan::Zero() ? -1 : (int)FMath::Min(WaitTime.GetTotalMilliseconds(), (double)MAX_int32);
+        int Result;
+        do
+        {
+            Result = poll(&PollFd, 1, TimeoutMs);
+        }
+        while (Result < 0 && errno == EINTR);
+
+        OutRevents = PollFd.revents;
+        return Result;
+    }
+}
+
+FMCPUnixSocket* FMCPUnixSocket::CreateListener(const FString& Path, int32 MaxBacklog)
+{
+    sockaddr_un Address;
+    if (!MCPUnixSocket::MakeAddress(Path, Address))
+    {
+        UE_LOG(LogTemp, Error, TEXT("MCPUnixSocket: Socket path is too long: %s"), *Path);
+        return nullptr;
+    }
+
+    const int Descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (Descriptor < 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("MCPUnixSocket: Failed to create socket (errno %d)"), errno);
+        return nullptr;
+    }
+
+    // A socket file left behind by an editor that didn't shut down cleanly would make bind fail.
+    // Only remove it if nobody is listening on it, so two editors can't steal each other's path.
+    if (MCPUnixSocket::IsSocketFile(Path))
+    {
+        const int Probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool bInUse = Probe >= 0 && connect(Probe, (const sockaddr*)&Address, sizeof(Address)) == 0;
+        if (Probe >= 0)
+        {
+            close(Probe);
+        }
+        if (bInUse)
+        {
+            UE_LOG(LogTemp, Error, TEXT("MCPUnixSocket: Another process is already listening on %s"), *Path);
+            close(Descriptor);
+            return nullptr;
+        }
+        unlink(TCHAR_TO_UTF8(*Path));
+    }
+
+    if (bind(Descriptor, (const sockaddr*)&Address, sizeof(Address)) != 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("MCPUnixSocket: Failed to bind %s (errno %d)"), *Path, errno);
+        close(Descriptor);
+        return nullptr;
+    }
+
+    // Same-user access only, the socket drives the editor
+    chmod(TCHAR_TO_UTF8(*Path), S_IRUSR | S_IWUSR);
+
+    FMCPUnixSocket* Listener = new FMCPUnixSocket(Descriptor, Path, true, TEXT("UnrealMCPUnixListener"));
+    if (!Listener->Listen(MaxBacklog))
+    {
+        UE_LOG(LogTemp, Error, TEXT("MCPUnixSocket: Failed to listen on %s (errno %d)"), *Path, errno);
+        delete Listener;
+        return nullptr;
+    }
+    return Listener;
+}
+
+FMCPUnixSocket::FMCPUnixSocket(int InDescriptor, const FString& InPath, bool bInOwnsPath, const FString& InSocketDescription)
+    : FMCPLocalSocket(InSocketDescription, ProtocolName)
+    , Descriptor(InDescriptor)
+    , Path(InPath)
+    , bOwnsPath(bInOwnsPath)
+{
+}
+
+FMCPUnixSocket::~FMCPUnixSocket()
+{
+    Close();
+}
+
+void FMCPUnixSocket::WakeListener()
+{
+    // A throwaway connection makes the listener readable, same as for the TCP listener
+    sockaddr_un Address;
+    if (!MCPUnixSocket::MakeAddress(Path, Address))
+    {
+        return;
+    }
+
+    const int WakeDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (WakeDescriptor >= 0)
+    {
+        connect(WakeDescriptor, (const sockaddr*)&Address, sizeof(Address));
+        close(WakeDescriptor);
+    }
+}
+
+bool FMCPUnixSocket::Shutdown(ESocketShutdownMode Mode)
+{
+    int How = SHUT_RDWR;
+    if (Mode == ESocketShutdownMode::Read)
+    {
+        How = SHUT_RD;
+    }
+    else if (Mode == ESocketShutdownMode::Write)
+    {
+        How = SHUT_WR;
+    }
+    return shutdown(Descriptor, How) == 0;
+}
+
+bool FMCPUnixSocket::Close()
+{
+    if (Descriptor < 0)
+    {
+        return false;
+    }
+
+    close(Descriptor);
+    Descriptor = -1;
+    if (bOwnsPath)
+    {
+        unlink(TCHAR_TO_UTF8(*Path));
+        bOwnsPath = false;
+    }
+    return true;
+}
+
+bool FMCPUnixSocket::Listen(int32 MaxBacklog)
+{
+    return listen(Descriptor, MaxBacklog) == 0;
+}
+
+bool FMCPUnixSocket::WaitForPendingConnection(bool& bHasPendingConnection, const FTimespan& WaitTime)
+{
+    bHasPendingConnection = false;
+
+    short Revents = 0;
+    const int32 Result = MCPUnixSocket::PollOne(Descriptor, POLLIN, WaitTime, Revents);
+    if (Result < 0)
+    {
+        return false;
+    }
+
+    bHasPendingConnection = Result > 0 && (Revents & POLLIN) != 0;
+    return true;
+}
+
+bool FMCPUnixSocket::HasPendingData(uint32& PendingDataSize)
+{
+    int Available = 0;
+    if (ioctl(Descriptor, FIONREAD, &Available) != 0)
+    {
+        PendingDataSize = 0;
+        return false;
+    }
+    PendingDataSize = (uint32)Available;
+    return PendingDataSize > 0;
+}
+
+FSocket* FMCPUnixSocket::Accept(const FString& InSocketDescription)
+{
+    const int ClientDescriptor = accept4(Descriptor, nullptr, nullptr, SOCK_CLOEXEC);
+    if (ClientDescriptor < 0)
+    {
+        return nullptr;
+    }
+    return new FMCPUnixSocket(ClientDescriptor, Path, false, InSocketDescription);
+}
+
+bool FMCPUnixSocket::Send(const uint8* Data, int32 Count, int32& BytesSent)
+{
+    // MSG_NOSIGNAL: a client that went away must not raise SIGPIPE in the editor
+    const ssize_t Result = send(Descriptor, Data, Count, MSG_NOSIGNAL);
+    BytesSent = Result > 0 ? (int32)Result : 0;
+    return Result >= 0;
+}
+
+bool FMCPUnixSocket::Recv(uint8* Data, int32 BufferSize, int32& BytesRead, ESocketReceiveFlags::Type Flags)
+{
+    int NativeFlags = 0;
+    if (Flags & ESocketReceiveFlags::Peek)
+    {
+        NativeFlags |= MSG_PEEK;
+    }
+    if (Flags & ESocketReceiveFlags::WaitAll)
+    {
+        NativeFlags |= MSG_WAITALL;
+    }
+
+    const ssize_t Result = recv(Descriptor, Data, BufferSize, NativeFlags);
+    BytesRead = Result > 0 ? (int32)Result : 0;
+    return Result >= 0;
+}
+
+bool FMCPUnixSocket::Wait(ESocketWaitConditions::Type Condition, FTimespan WaitTime)
+{
+    short Events = 0;
+    if (Condition == ESocketWaitConditions::WaitForRead || Condition == ESocketWaitConditions::WaitForReadOrWrite)
+    {
+        Events |= POLLIN;
+    }
+    if (Condition == ESocketWaitConditions::WaitForWrite || Condition == ESocketWaitConditions::WaitForReadOrWrite)
+    {
+        Events |= POLLOUT;
+    }
+
+    // Hang-ups and errors count as ready, so the caller's Recv/Send reports them
+    short Revents = 0;
+    return MCPUnixSocket::PollOne(Descriptor, Events, WaitTime, Revents) > 0 && (Revents & (Events | POLLHUP | POLLERR)) != 0;
+}
+
+ESocketConnectionState FMCPUnixSocket::GetConnectionState()
+{
+    if (Descriptor < 0)
+    {
+        return SCS_ConnectionError;
+    }
+
+    short Revents = 0;
+    if (MCPUnixSocket::PollOne(Descriptor, POLLOUT, FTimespan::Zero(), Revents) < 0 || (Revents & (POLLHUP | POLLERR)) != 0)
+    {
+        return SCS_ConnectionError;
+    }
+    return SCS_Connected;
+}
+
+bool FMCPUnixSocket::SetNonBlocking(bool bIsNonBlocking)
+{
+    const int Flags = fcntl(Descriptor, F_GETFL, 0);
+    if (Flags < 0)
+    {
+        return false;
+    }
+    return fcntl(Descriptor, F_SETFL, bIsNonBlocking ? (Flags | O_NONBLOCK) : (Flags & ~O_NONBLOCK)) == 0;
+}
+
+bool FMCPUnixSocket::SetSendBufferSize(int32 Size, int32& NewSize)
+{
+    setsockopt(Descriptor, SOL_SOCKET, SO_SNDBUF, &Size, sizeof(Size));
+    socklen_t OptionSize = sizeof(NewSize);
+    return getsockopt(Descriptor, SOL_SOCKET, SO_SNDBUF, &NewSize, &OptionSize) == 0;
+}
+
+bool FMCPUnixSocket::SetReceiveBufferSize(int32 Size, int32& NewSize)
+{
+    setsockopt(Descriptor, SOL_SOCKET, SO_RCVBUF, &Size, sizeof(Size));
+    socklen_t OptionSize = sizeof(NewSize);
+    return getsockopt(Descriptor, SOL_SOCKET, SO_RCVBUF, &NewSize, &OptionSize) == 0;
+}
+
+#endif // WITH_MCP_UNIX_SOCKET
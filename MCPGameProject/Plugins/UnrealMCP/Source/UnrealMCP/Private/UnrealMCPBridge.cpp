@@ -1,5 +1,13 @@
 #include "UnrealMCPBridge.h"
 #include "MCPServerRunnable.h"
+#include "MCPProtocol.h"
+#include "MCPUnixSocket.h"
+#include "MCPBatch.h"
+#include "MCPTrace.h"
+#include "Misc/Paths.h"
+#include "Containers/Ticker.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
 #include "Sockets.h"
 #include "SocketSubsystem.h"
 #include "HAL/RunnableThread.h"
@@ -62,13 +70,23 @@
 #define MCP_SERVER_HOST "127.0.0.1"
 #define MCP_SERVER_PORT_DEFAULT 55557
 
+// Thread-safe commands allowed to run on workers at once, more are refused as busy
+const int32 MaxWorkerCommands = 64;
+const int32 WorkerRetryAfterMs = 50;
+
 UUnrealMCPBridge::UUnrealMCPBridge()
 {
-    EditorCommands = MakeShared<FUnrealMCPEditorCommands>();
+    ActorIndex = MakeShared<FMCPActorIndex>();
+    EditorCommands = MakeShared<FUnrealMCPEditorCommands>(*ActorIndex);
     BlueprintCommands = MakeShared<FUnrealMCPBlueprintCommands>();
     BlueprintNodeCommands = MakeShared<FUnrealMCPBlueprintNodeCommands>();
     ProjectCommands = MakeShared<FUnrealMCPProjectCommands>();
     UMGCommands = MakeShared<FUnrealMCPUMGCommands>();
+    CommandQueue = MakeShared<FMCPCommandQueue>(this);
+    ServerStats = MakeShared<FMCPServerStats>();
+    JobManager = MakeShared<FMCPJobManager>(this);
+
+    RegisterBuiltInCommands();
 }
 
 UUnrealMCPBridge::~UUnrealMCPBridge()
@@ -78,6 +96,74 @@ UUnrealMCPBridge::~UUnrealMCPBridge()
     BlueprintNodeCommands.Reset();
     ProjectCommands.Reset();
     UMGCommands.Reset();
+    JobManager.Reset();
+    CommandQueue.Reset();
+    ServerStats.Reset();
+    ActorIndex.Reset();
+}
+
+void UUnrealMCPBridge::RegisterBuiltInCommands()
+{
+    const FName Category(TEXT("bridge"));
+
+    CommandRegistry.RegisterCommand(TEXT("ping"), [](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+    {
+        TSharedPtr<FJsonObject> ResultJson = MakeShareable(new FJsonObject);
+        ResultJson->SetStringField(TEXT("message"), TEXT("pong"));
+        return ResultJson;
+    }, Category, EMCPCommandFlags::ThreadSafe);
+
+    // Several commands in one game thread task
+    CommandRegistry.RegisterCommand(TEXT("batch"), [this](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+    {
+        return FMCPBatch::Run(*this, Params, Context);
+    }, Category);
+
+    CommandRegistry.RegisterCommand(TEXT("list_commands"), [this](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+    {
+        return CommandRegistry.Describe();
+    }, Category, EMCPCommandFlags::ThreadSafe);
+
+    CommandRegistry.RegisterCommand(TEXT("get_queue_stats"), [this](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+    {
+        return CommandQueue->GetStats();
+    }, Category, EMCPCommandFlags::ThreadSafe);
+
+    CommandRegistry.RegisterCommand(TEXT("get_server_stats"), [this](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+    {
+        return HandleGetServerStats(Params);
+    }, Category, EMCPCommandFlags::ThreadSafe);
+
+    CommandRegistry.RegisterCommand(TEXT("cancel"), [this](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+    {
+        return HandleCancel(Params, Context);
+    }, Category, EMCPCommandFlags::ThreadSafe);
+
+    // Answered by the job manager, job_result possibly only once its job has finished
+    for (const TCHAR* JobCommand : { TEXT("submit"), TEXT("job_status"), TEXT("job_result"), TEXT("job_cancel") })
+    {
+        const FString JobCommandType(JobCommand);
+        CommandRegistry.RegisterDeferredCommand(JobCommand, [this, JobCommandType](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context, FMCPResponseCallback OnComplete)
+        {
+            JobManager->HandleCommand(Context.GetClientId(), JobCommandType, Params, MoveTemp(OnComplete));
+        }, Category);
+    }
+
+    EditorCommands->RegisterCommands(CommandRegistry);
+    BlueprintCommands->RegisterCommands(CommandRegistry);
+    BlueprintNodeCommands->RegisterCommands(CommandRegistry);
+    ProjectCommands->RegisterCommands(CommandRegistry);
+    UMGCommands->RegisterCommands(CommandRegistry);
+}
+
+bool UUnrealMCPBridge::RegisterCommand(FName CommandType, FMCPCommandHandler Handler, FName Category, EMCPCommandFlags Flags)
+{
+    return CommandRegistry.RegisterCommand(CommandType, MoveTemp(Handler), Category, Flags);
+}
+
+bool UUnrealMCPBridge::UnregisterCommand(FName CommandType)
+{
+    return CommandRegistry.UnregisterCommand(CommandType);
 }
 
 // Initialize subsystem
@@ -86,9 +172,7 @@ void UUnrealMCPBridge::Initialize(FSubsystemCollectionBase& Collection)
     UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Initializing"));
 
     bIsRunning = false;
-    ListenerSocket = nullptr;
-    ConnectionSocket = nullptr;
-    ServerThread = nullptr;
+    ServerStartTime = 0.0;
 
     // Read port from config, default to 55557
     // Config section [UnrealMCP] in DefaultGame.ini
@@ -107,6 +191,90 @@ void UUnrealMCPBridge::Initialize(FSubsystemCollectionBase& Collection)
         }
     }
 
+    // Largest request a client may send, in bytes
+    MaxMessageSize = FMCPProtocol::DefaultMaxMessageSize;
+    if (GConfig)
+    {
+        GConfig->GetInt(TEXT("UnrealMCP"), TEXT("MaxMessageSize"), MaxMessageSize, GGameIni);
+    }
+
+    // Responses at least this large are compressed for clients that asked for it
+    CompressionThreshold = FMCPProtocol::DefaultCompressionThreshold;
+    if (GConfig)
+    {
+        GConfig->GetInt(TEXT("UnrealMCP"), TEXT("CompressionThreshold"), CompressionThreshold, GGameIni);
+    }
+
+    // A client that leaves more response bytes than this unread is disconnected
+    MaxUnsentResponseBytes = FMCPProtocol::DefaultMaxUnsentResponseBytes;
+    if (GConfig)
+    {
+        GConfig->GetInt(TEXT("UnrealMCP"), TEXT("MaxUnsentResponseBytes"), MaxUnsentResponseBytes, GGameIni);
+    }
+
+    // Same-host clients can skip the TCP stack through a unix socket (Linux only),
+    // and the TCP listener can be turned off to avoid port collisions between editors
+    bEnableTcp = true;
+    UnixSocketPath.Reset();
+    if (GConfig)
+    {
+        GConfig->GetBool(TEXT("UnrealMCP"), TEXT("EnableTcp"), bEnableTcp, GGameIni);
+        GConfig->GetString(TEXT("UnrealMCP"), TEXT("UnixSocketPath"), UnixSocketPath, GGameIni);
+    }
+    if (!UnixSocketPath.IsEmpty() && FPaths::IsRelative(UnixSocketPath))
+    {
+        UnixSocketPath = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir(), UnixSocketPath);
+    }
+
+    // Commands waiting for the game thread, in total and from any one client
+    int32 MaxQueuedCommands = FMCPCommandQueue::DefaultMaxDepth;
+    int32 MaxQueuedCommandsPerClient = FMCPCommandQueue::DefaultMaxDepthPerClient;
+    if (GConfig)
+    {
+        GConfig->GetInt(TEXT("UnrealMCP"), TEXT("MaxQueuedCommands"), MaxQueuedCommands, GGameIni);
+        GConfig->GetInt(TEXT("UnrealMCP"), TEXT("MaxQueuedCommandsPerClient"), MaxQueuedCommandsPerClient, GGameIni);
+    }
+
+    // Game thread time per frame given to commands. A headless editor has no one to stay responsive for.
+    const bool bHeadless = FParse::Param(FCommandLine::Get(), TEXT("nullrhi"));
+    float FrameBudgetMs = bHeadless ? FMCPCommandQueue::DefaultHeadlessFrameBudgetMs : FMCPCommandQueue::DefaultFrameBudgetMs;
+    if (GConfig)
+    {
+        GConfig->GetFloat(TEXT("UnrealMCP"), bHeadless ? TEXT("HeadlessCommandFrameBudgetMs") : TEXT("CommandFrameBudgetMs"), FrameBudgetMs, GGameIni);
+    }
+    UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Running commands for up to %.1f ms per frame%s"), FrameBudgetMs, bHeadless ? TEXT(" (headless)") : TEXT(""));
+
+    // Don't let a backgrounded editor's throttling hold up commands
+    bool bLiftBackgroundThrottle = true;
+    if (GConfig)
+    {
+        GConfig->GetBool(TEXT("UnrealMCP"), TEXT("LiftBackgroundThrottle"), bLiftBackgroundThrottle, GGameIni);
+    }
+
+    CommandQueue->Configure(MaxQueuedCommands, MaxQueuedCommandsPerClient, FrameBudgetMs, bLiftBackgroundThrottle);
+    CommandQueue->Start();
+
+    // Optionally dump the server stats to a CSV on a timer, for runs nobody is watching live
+    StatsCsvPath.Reset();
+    float StatsCsvIntervalSeconds = 60.0f;
+    if (GConfig)
+    {
+        GConfig->GetString(TEXT("UnrealMCP"), TEXT("StatsCsvPath"), StatsCsvPath, GGameIni);
+        GConfig->GetFloat(TEXT("UnrealMCP"), TEXT("StatsCsvIntervalSeconds"), StatsCsvIntervalSeconds, GGameIni);
+    }
+    if (!StatsCsvPath.IsEmpty())
+    {
+        if (FPaths::IsRelative(StatsCsvPath))
+        {
+            StatsCsvPath = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir(), StatsCsvPath);
+        }
+        StatsCsvTickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+            FTickerDelegate::CreateUObject(this, &UUnrealMCPBridge::WriteStatsCsv), FMath::Max(StatsCsvIntervalSeconds, 1.0f));
+        UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Writing stats to %s every %.0f seconds"), *StatsCsvPath, StatsCsvIntervalSeconds);
+    }
+
+    ActorIndex->Start();
+
     FIPv4Address::Parse(MCP_SERVER_HOST, ServerAddress);
 
     // Start the server automatically
@@ -118,6 +286,17 @@ void UUnrealMCPBridge::Deinitialize()
 {
     UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Shutting down"));
     StopServer();
+    // Commands other modules ran while the server was stopped
+    WaitForWorkers();
+    CommandQueue->Stop();
+    ActorIndex->Stop();
+
+    if (StatsCsvTickerHandle.IsValid())
+    {
+        FTSTicker::GetCoreTicker().RemoveTicker(StatsCsvTickerHandle);
+        StatsCsvTickerHandle.Reset();
+        WriteStatsCsv(0.0f);
+    }
 }
 
 // Start the MCP server
@@ -129,12 +308,34 @@ void UUnrealMCPBridge::StartServer()
         return;
     }
 
+    bIsRunning = true;
+    ServerStartTime = FPlatformTime::Seconds();
+
+    if (bEnableTcp)
+    {
+        StartListener(CreateTcpListener(), TEXT("UnrealMCPServerThread"));
+    }
+
+    if (!UnixSocketPath.IsEmpty())
+    {
+        StartListener(CreateUnixListener(), TEXT("UnrealMCPUnixServerThread"));
+    }
+
+    if (ServerThreads.Num() == 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("UnrealMCPBridge: No listener could be started"));
+        StopServer();
+    }
+}
+
+TSharedPtr<FSocket> UUnrealMCPBridge::CreateTcpListener()
+{
     // Create socket subsystem
     ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
     if (!SocketSubsystem)
     {
         UE_LOG(LogTemp, Error, TEXT("UnrealMCPBridge: Failed to get socket subsystem"));
-        return;
+        return nullptr;
     }
 
     // Create listener socket
@@ -142,7 +343,7 @@ void UUnrealMCPBridge::StartServer()
     if (!NewListenerSocket.IsValid())
     {
         UE_LOG(LogTemp, Error, TEXT("UnrealMCPBridge: Failed to create listener socket"));
-        return;
+        return nullptr;
     }
 
     // Allow address reuse for quick restarts
@@ -154,33 +355,61 @@ void UUnrealMCPBridge::StartServer()
     if (!NewListenerSocket->Bind(*Endpoint.ToInternetAddr()))
     {
         UE_LOG(LogTemp, Error, TEXT("UnrealMCPBridge: Failed to bind listener socket to %s:%d"), *ServerAddress.ToString(), Port);
-        return;
+        return nullptr;
     }
 
     // Start listening
-    if (!NewListenerSocket->Listen(5))
+    if (!NewListenerSocket->Listen(16))
     {
         UE_LOG(LogTemp, Error, TEXT("UnrealMCPBridge: Failed to start listening"));
-        return;
+        return nullptr;
     }
 
-    ListenerSocket = NewListenerSocket;
-    bIsRunning = true;
     UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Server started on %s:%d"), *ServerAddress.ToString(), Port);
+    return NewListenerSocket;
+}
+
+TSharedPtr<FSocket> UUnrealMCPBridge::CreateUnixListener()
+{
+#if WITH_MCP_UNIX_SOCKET
+    TSharedPtr<FSocket> NewListenerSocket = MakeShareable(FMCPUnixSocket::CreateListener(UnixSocketPath, 16));
+    if (!NewListenerSocket.IsValid())
+    {
+        return nullptr;
+    }
+
+    NewListenerSocket->SetNonBlocking(true);
+    UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Server started on unix socket %s"), *UnixSocketPath);
+    return NewListenerSocket;
+#else
+    UE_LOG(LogTemp, Warning, TEXT("UnrealMCPBridge: UnixSocketPath is set but unix sockets are not supported on this platform"));
+    return nullptr;
+#endif
+}
+
+bool UUnrealMCPBridge::StartListener(const TSharedPtr<FSocket>& Listener, const TCHAR* ThreadName)
+{
+    if (!Listener.IsValid())
+    {
+        return false;
+    }
 
     // Start server thread
-    ServerThread = FRunnableThread::Create(
-        new FMCPServerRunnable(this, ListenerSocket),
-        TEXT("UnrealMCPServerThread"),
+    FRunnableThread* ServerThread = FRunnableThread::Create(
+        new FMCPServerRunnable(this, Listener),
+        ThreadName,
         0, TPri_Normal
     );
 
     if (!ServerThread)
     {
-        UE_LOG(LogTemp, Error, TEXT("UnrealMCPBridge: Failed to create server thread"));
-        StopServer();
-        return;
+        UE_LOG(LogTemp, Error, TEXT("UnrealMCPBridge: Failed to create server thread %s"), ThreadName);
+        return false;
     }
+
+    ListenerSockets.Add(Listener);
+    ServerThreads.Add(ServerThread);
+    return true;
 }
 
 // Stop the MCP server
@@ -193,170 +422,274 @@ void UUnrealMCPBridge::StopServer()
 
     bIsRunning = false;
 
-    // Clean up thread
-    if (ServerThread)
+    // Clean up threads
+    for (FRunnableThread* ServerThread : ServerThreads)
     {
         ServerThread->Kill(true);
         delete ServerThread;
-        ServerThread = nullptr;
     }
+    ServerThreads.Empty();
 
-    // Close sockets
-    if (ConnectionSocket.IsValid())
+    // The connections are gone, so no more commands arrive, but those already on workers still call back into the bridge
+    WaitForWorkers();
+
+    // Close sockets. The shared pointers own them, so they are deleted when released
+    // rather than handed to DestroySocket, which would free them a second time.
+    for (const TSharedPtr<FSocket>& Listener : ListenerSockets)
     {
-        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ConnectionSocket.Get());
-        ConnectionSocket.Reset();
+        Listener->Close();
     }
+    ListenerSockets.Empty();
+
+    CommandQueue->Reset(TEXT("Server stopped"));
+    JobManager->Reset();
+
+    UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Server stopped"));
+}
+
+// Queue a command for the game thread. OnComplete is called on the game thread with the response,
+// except for commands answered on the calling thread: deferred commands like the job commands, and
+// commands refused because the queue is full; and thread-safe commands, answered on a worker.
+// OnProgress, if set, receives the progress events of commands that report them.
+void UUnrealMCPBridge::ExecuteCommandAsync(FMCPCommandRequest&& Request)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(UUnrealMCPBridge::ExecuteCommandAsync);
 
-    if (ListenerSocket.IsValid())
+    UE_LOG(LogTemp, Verbose, TEXT("UnrealMCPBridge: Executing command: %s"), *Request.CommandType);
+
+    TSharedPtr<const FMCPRegisteredCommand> Command = CommandRegistry.FindCommand(Request.CommandType);
+
+    // Deferred commands only do bookkeeping before handing OnComplete on, so they are answered right here
+    if (Command.IsValid() && Command->DeferredHandler)
     {
-        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ListenerSocket.Get());
-        ListenerSocket.Reset();
+        FMCPCommandContext Context(MoveTemp(Request.OnProgress), Request.CancelFlag, Request.Deadline, Request.ClientId);
+        Command->DeferredHandler(Request.Params, Context, MoveTemp(Request.OnComplete));
+        return;
     }
 
-    UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Server stopped"));
+    // Commands that don't need the game thread don't wait behind compiles and saves
+    if (Command.IsValid() && EnumHasAnyFlags(Command->Flags, EMCPCommandFlags::ThreadSafe))
+    {
+        RunOnWorker(MoveTemp(Request), MoveTemp(Command));
+        return;
+    }
+
+    // Enqueue only takes the request when it accepts it, so a refused one can still be answered
+    int32 RetryAfterMs = 0;
+    if (!CommandQueue->Enqueue(MoveTemp(Request), RetryAfterMs))
+    {
+        Request.OnComplete(FMCPCommandQueue::MakeBusyResponse(RetryAfterMs));
+    }
 }
 
-// Execute a command received from a client
-FString UUnrealMCPBridge::ExecuteCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params)
+void UUnrealMCPBridge::RunOnWorker(FMCPCommandRequest&& Request, TSharedPtr<const FMCPRegisteredCommand> Command)
 {
-    UE_LOG(LogTemp, Display, TEXT("UnrealMCPBridge: Executing command: %s"), *CommandType);
-    
-    // Create a promise to wait for the result
-    TPromise<FString> Promise;
-    TFuture<FString> Future = Promise.GetFuture();
-    
-    // Queue execution on Game Thread
-    AsyncTask(ENamedThreads::GameThread, [this, CommandType, Params, Promise = MoveTemp(Promise)]() mutable
+    if (WorkerCommandCount.Increment() > MaxWorkerCommands)
+    {
+        WorkerCommandCount.Decrement();
+        Request.OnComplete(FMCPCommandQueue::MakeBusyResponse(WorkerRetryAfterMs));
+        return;
+    }
+
+    const double EnqueueTime = FPlatformTime::Seconds();
+    AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this, Request = MoveTemp(Request), Command = MoveTemp(Command), EnqueueTime]() mutable
+    {
+        TRACE_CPUPROFILER_EVENT_SCOPE(UUnrealMCPBridge::RunOnWorker);
+        MCP_TRACE_REQUEST(Request.CommandType, Request.RequestKey, Request.ClientId);
+
+        const double StartTime = FPlatformTime::Seconds();
+        TSharedPtr<FJsonObject> Response;
+        if (Request.Deadline > 0.0 && StartTime > Request.Deadline)
+        {
+            Response = MakeShared<FJsonObject>();
+            Response->SetStringField(TEXT("status"), TEXT("error"));
+            Response->SetStringField(TEXT("error"), TEXT("Deadline exceeded before the command ran"));
+            Response->SetBoolField(TEXT("deadline_exceeded"), true);
+            ServerStats->RecordRun(Request.CommandType, StartTime - EnqueueTime, TOptional<double>());
+        }
+        else
+        {
+            FMCPCommandContext Context(MoveTemp(Request.OnProgress), Request.CancelFlag, Request.Deadline, Request.ClientId);
+            Response = RunHandler(*Command, Request.CommandType, Request.Params, Context);
+            ServerStats->RecordRun(Request.CommandType, StartTime - EnqueueTime, FPlatformTime::Seconds() - StartTime);
+        }
+
+        // Only after OnComplete, which records the response in the stats, so WaitForWorkers covers it too
+        Request.OnComplete(Response);
+        WorkerCommandCount.Decrement();
+    });
+}
+
+void UUnrealMCPBridge::WaitForWorkers()
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(UUnrealMCPBridge::WaitForWorkers);
+
+    // Thread-safe commands never wait on the game thread, so this can't deadlock
+    while (WorkerCommandCount.GetValue() > 0)
+    {
+        FPlatformProcess::Sleep(0.001f);
+    }
+}
+
+// Cancel one of the client's own requests, found by the id it was sent with
+TSharedPtr<FJsonObject> UUnrealMCPBridge::HandleCancel(const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(UUnrealMCPBridge::HandleCancel);
+
+    TSharedPtr<FJsonValue> RequestId = Params->TryGetField(TEXT("request_id"));
+    if (!RequestId.IsValid())
+    {
+        return FUnrealMCPCommonUtils::CreateErrorResponse(TEXT("Missing 'request_id' parameter"));
+    }
+
+    bool bWasRunning = false;
+    const bool bFound = CommandQueue->Cancel(Context.GetClientId(), RequestId->AsString(), bWasRunning);
+
+    TSharedPtr<FJsonObject> ResultJson = MakeShareable(new FJsonObject);
+    ResultJson->SetBoolField(TEXT("found"), bFound);
+    ResultJson->SetStringField(TEXT("state"), !bFound ? TEXT("not_found") : bWasRunning ? TEXT("cancel_requested") : TEXT("cancelled"));
+    return ResultJson;
+}
+
+TSharedPtr<FJsonObject> UUnrealMCPBridge::GetHealth() const
+{
+    TSharedPtr<FJsonObject> ResultJson = MakeShareable(new FJsonObject);
+    ResultJson->SetNumberField(TEXT("uptime_seconds"), bIsRunning ? FPlatformTime::Seconds() - ServerStartTime : 0.0);
+    ResultJson->SetNumberField(TEXT("queue_depth"), CommandQueue->GetDepth());
+    ResultJson->SetNumberField(TEXT("worker_commands"), WorkerCommandCount.GetValue());
+
+    FString RunningCommandType;
+    int32 RunningClientId = 0;
+    double RunningSeconds = 0.0;
+    if (CommandQueue->GetRunningCommand(RunningCommandType, RunningClientId, RunningSeconds))
+    {
+        TSharedPtr<FJsonObject> CurrentJson = MakeShareable(new FJsonObject);
+        CurrentJson->SetStringField(TEXT("type"), RunningCommandType);
+        CurrentJson->SetNumberField(TEXT("client"), RunningClientId);
+        CurrentJson->SetNumberField(TEXT("running_ms"), RunningSeconds * 1000.0);
+        ResultJson->SetObjectField(TEXT("current_command"), CurrentJson);
+    }
+    else
+    {
+        ResultJson->SetField(TEXT("current_command"), MakeShared<FJsonValueNull>());
+    }
+
+    // Negative until the queue's ticker has run once
+    const double SecondsSinceTick = CommandQueue->GetSecondsSinceTick();
+    if (SecondsSinceTick >= 0.0)
+    {
+        ResultJson->SetNumberField(TEXT("game_thread_heartbeat_ms"), SecondsSinceTick * 1000.0);
+    }
+    else
+    {
+        ResultJson->SetField(TEXT("game_thread_heartbeat_ms"), MakeShared<FJsonValueNull>());
+    }
+    return ResultJson;
+}
+
+// Per command stats, plus the queue's, optionally starting a new measurement period
+TSharedPtr<FJsonObject> UUnrealMCPBridge::HandleGetServerStats(const TSharedPtr<FJsonObject>& Params)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(UUnrealMCPBridge::HandleGetServerStats);
+
+    TSharedPtr<FJsonObject> ResultJson = ServerStats->ToJson();
+    ResultJson->SetObjectField(TEXT("queue"), CommandQueue->GetStats());
+
+    bool bReset = false;
+    if (Params->TryGetBoolField(TEXT("reset"), bReset) && bReset)
+    {
+        ServerStats->Reset();
+    }
+    return ResultJson;
+}
+
+bool UUnrealMCPBridge::WriteStatsCsv(float DeltaTime)
+{
+    if (!ServerStats->AppendCsv(StatsCsvPath))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("UnrealMCPBridge: Failed to write stats to %s"), *StatsCsvPath);
+    }
+    return true;
+}
+
+// Run a command on the game thread and wrap its result in a response envelope
+TSharedPtr<FJsonObject> UUnrealMCPBridge::DispatchCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+{
+    check(IsInGameThread());
+    TRACE_CPUPROFILER_EVENT_SCOPE(UUnrealMCPBridge::DispatchCommand);
+
+    TSharedPtr<const FMCPRegisteredCommand> Command = CommandRegistry.FindCommand(CommandType);
+    if (!Command.IsValid())
+    {
+        TSharedPtr<FJsonObject> ResponseJson = MakeShareable(new FJsonObject);
+        ResponseJson->SetStringField(TEXT("status"), TEXT("error"));
+        ResponseJson->SetStringField(TEXT("error"), FString::Printf(TEXT("Unknown command: %s"), *CommandType));
+        return ResponseJson;
+    }
+
+    if (Command->DeferredHandler)
     {
+        // Answered before the handler returns, deferred commands refuse to wait on the game thread
+        TSharedRef<TSharedPtr<FJsonObject>> Answer = MakeShared<TSharedPtr<FJsonObject>>();
+        Command->DeferredHandler(Params, Context, [Answer](TSharedPtr<FJsonObject> Response)
+        {
+            *Answer = Response;
+        });
+        if (Answer->IsValid())
+        {
+            return *Answer;
+        }
+
         TSharedPtr<FJsonObject> ResponseJson = MakeShareable(new FJsonObject);
+        ResponseJson->SetStringField(TEXT("status"), TEXT("error"));
+        ResponseJson->SetStringField(TEXT("error"), FString::Printf(TEXT("%s can't wait on the game thread"), *CommandType));
+        return ResponseJson;
+    }
+
+    return RunHandler(*Command, CommandType, Params, Context);
+}
+
+TSharedPtr<FJsonObject> UUnrealMCPBridge::RunHandler(const FMCPRegisteredCommand& Command, const FString& CommandType, const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context)
+{
+    TSharedPtr<FJsonObject> ResponseJson = MakeShareable(new FJsonObject);
+    
+    try
+    {
+        // Named after the command, which is registered, so the number of distinct trace timers stays bounded
+        FMCPTraceCommandScope CommandScope(TEXT("MCP"), CommandType);
+        TSharedPtr<FJsonObject> ResultJson = Command.Handler(Params, Context);
+        
+        // Check if the result contains an error
+        bool bSuccess = true;
+        FString ErrorMessage;
         
-        try
+        if (ResultJson->HasField(TEXT("success")))
         {
-            TSharedPtr<FJsonObject> ResultJson;
-            
-            if (CommandType == TEXT("ping"))
+            bSuccess = ResultJson->GetBoolField(TEXT("success"));
+            if (!bSuccess && ResultJson->HasField(TEXT("error")))
             {
-                ResultJson = MakeShareable(new FJsonObject);
-                ResultJson->SetStringField(TEXT("message"), TEXT("pong"));
-            }
-            // Editor Commands (including actor manipulation)
-            else if (CommandType == TEXT("get_actors_in_level") ||
-                     CommandType == TEXT("find_actors_by_name") ||
-                     CommandType == TEXT("spawn_actor") ||
-                     CommandType == TEXT("create_actor") ||
-                     CommandType == TEXT("delete_actor") ||
-                     CommandType == TEXT("set_actor_transform") ||
-                     CommandType == TEXT("get_actor_properties") ||
-                     CommandType == TEXT("set_actor_property") ||
-                     CommandType == TEXT("spawn_blueprint_actor") ||
-                     CommandType == TEXT("focus_viewport") ||
-                     CommandType == TEXT("take_screenshot") ||
-                     CommandType == TEXT("save_all") ||
-                     CommandType == TEXT("save_current_level") ||
-                     CommandType == TEXT("get_actor_components") ||
-                     CommandType == TEXT("set_actor_component_property") ||
-                     CommandType == TEXT("set_actor_static_mesh"))
-            {
-                ResultJson = EditorCommands->HandleCommand(CommandType, Params);
-            }
-            // Blueprint Commands
-            else if (CommandType == TEXT("create_blueprint") ||
-                     CommandType == TEXT("add_component_to_blueprint") ||
-                     CommandType == TEXT("set_component_property") ||
-                     CommandType == TEXT("set_physics_properties") ||
-                     CommandType == TEXT("compile_blueprint") ||
-                     CommandType == TEXT("set_blueprint_property") ||
-                     CommandType == TEXT("set_static_mesh_properties") ||
-                     CommandType == TEXT("set_pawn_properties") ||
-                     CommandType == TEXT("reparent_blueprint") ||
-                     CommandType == TEXT("create_material"))
-            {
-                ResultJson = BlueprintCommands->HandleCommand(CommandType, Params);
-            }
-            // Blueprint Node Commands
-            else if (CommandType == TEXT("connect_blueprint_nodes") || 
-                     CommandType == TEXT("add_blueprint_get_self_component_reference") ||
-                     CommandType == TEXT("add_blueprint_self_reference") ||
-                     CommandType == TEXT("find_blueprint_nodes") ||
-                     CommandType == TEXT("add_blueprint_event_node") ||
-                     CommandType == TEXT("add_blueprint_input_action_node") ||
-                     CommandType == TEXT("add_blueprint_function_node") ||
-                     CommandType == TEXT("add_blueprint_get_component_node") ||
-                     CommandType == TEXT("add_blueprint_variable"))
-            {
-                ResultJson = BlueprintNodeCommands->HandleCommand(CommandType, Params);
-            }
-            // Project Commands (including Enhanced Input)
-            else if (CommandType == TEXT("create_input_mapping") ||
-                     CommandType == TEXT("create_input_action") ||
-                     CommandType == TEXT("create_input_mapping_context") ||
-                     CommandType == TEXT("add_mapping_to_context") ||
-                     CommandType == TEXT("remove_mapping_from_context") ||
-                     CommandType == TEXT("get_input_actions") ||
-                     CommandType == TEXT("get_input_mapping_contexts"))
-            {
-                ResultJson = ProjectCommands->HandleCommand(CommandType, Params);
-            }
-            // UMG Commands
-            else if (CommandType == TEXT("create_umg_widget_blueprint") ||
-                     CommandType == TEXT("add_text_block_to_widget") ||
-                     CommandType == TEXT("add_button_to_widget") ||
-                     CommandType == TEXT("bind_widget_event") ||
-                     CommandType == TEXT("set_text_block_binding") ||
-                     CommandType == TEXT("add_widget_to_viewport"))
-            {
-                ResultJson = UMGCommands->HandleCommand(CommandType, Params);
-            }
-            else
-            {
-                ResponseJson->SetStringField(TEXT("status"), TEXT("error"));
-                ResponseJson->SetStringField(TEXT("error"), FString::Printf(TEXT("Unknown command: %s"), *CommandType));
-                
-                FString ResultString;
-                TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
-                FJsonSerializer::Serialize(ResponseJson.ToSharedRef(), Writer);
-                Promise.SetValue(ResultString);
-                return;
-            }
-            
-            // Check if the result contains an error
-            bool bSuccess = true;
-            FString ErrorMessage;
-            
-            if (ResultJson->HasField(TEXT("success")))
-            {
-                bSuccess = ResultJson->GetBoolField(TEXT("success"));
-                if (!bSuccess && ResultJson->HasField(TEXT("error")))
-                {
-                    ErrorMessage = ResultJson->GetStringField(TEXT("error"));
-                }
-            }
-            
-            if (bSuccess)
-            {
-                // Set success status and include the result
-                ResponseJson->SetStringField(TEXT("status"), TEXT("success"));
-                ResponseJson->SetObjectField(TEXT("result"), ResultJson);
-            }
-            else
-            {
-                // Set error status and include the error message
-                ResponseJson->SetStringField(TEXT("status"), TEXT("error"));
-                ResponseJson->SetStringField(TEXT("error"), ErrorMessage);
+                ErrorMessage = ResultJson->GetStringField(TEXT("error"));
             }
         }
-        catch (const std::exception& e)
+        
+        if (bSuccess)
+        {
+            // Set success status and include the result
+            ResponseJson->SetStringField(TEXT("status"), TEXT("success"));
+            ResponseJson->SetObjectField(TEXT("result"), ResultJson);
+        }
+        else
         {
+            // Set error status and include the error message
             ResponseJson->SetStringField(TEXT("status"), TEXT("error"));
-            ResponseJson->SetStringField(TEXT("error"), UTF8_TO_TCHAR(e.what()));
+            ResponseJson->SetStringField(TEXT("error"), ErrorMessage);
         }
-        
-        FString ResultString;
-        TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
-        FJsonSerializer::Serialize(ResponseJson.ToSharedRef(), Writer);
-        Promise.SetValue(ResultString);
-    });
+    }
+    catch (const std::exception& e)
+    {
+        ResponseJson->SetStringField(TEXT("status"), TEXT("error"));
+        ResponseJson->SetStringField(TEXT("error"), UTF8_TO_TCHAR(e.what()));
+    }
     
-    return Future.Get();
-}
\ No newline at end of file
+    return ResponseJson;
+}
@@ -2,6 +2,8 @@
 
 #include "CoreMinimal.h"
 #include "Json.h"
+#include "MCPCommandContext.h"
+#include "MCPCommandRegistry.h"
 
 /**
  * Handler class for Blueprint-related MCP commands
@@ -11,8 +13,8 @@ class UNREALMCP_API FUnrealMCPBlueprintCommands
 public:
     FUnrealMCPBlueprintCommands();
 
-    // Handle blueprint commands
-    TSharedPtr<FJsonObject> HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params);
+    // Add the blueprint commands to the bridge's command table
+    void RegisterCommands(FMCPCommandRegistry& Registry);
 
 private:
     // Specific blueprint command handlers
@@ -20,7 +22,7 @@ private:
     TSharedPtr<FJsonObject> HandleAddComponentToBlueprint(const TSharedPtr<FJsonObject>& Params);
     TSharedPtr<FJsonObject> HandleSetComponentProperty(const TSharedPtr<FJsonObject>& Params);
     TSharedPtr<FJsonObject> HandleSetPhysicsProperties(const TSharedPtr<FJsonObject>& Params);
-    TSharedPtr<FJsonObject> HandleCompileBlueprint(const TSharedPtr<FJsonObject>& Params);
+    TSharedPtr<FJsonObject> HandleCompileBlueprint(const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context);
     TSharedPtr<FJsonObject> HandleSpawnBlueprintActor(const TSharedPtr<FJsonObject>& Params);
     TSharedPtr<FJsonObject> HandleSetBlueprintProperty(const TSharedPtr<FJsonObject>& Params);
     TSharedPtr<FJsonObject> HandleSetStaticMeshProperties(const TSharedPtr<FJsonObject>& Params);
@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 #include "Json.h"
+#include "MCPCommandRegistry.h"
 
 /**
  * Handler class for Blueprint Node-related MCP commands
@@ -11,8 +12,8 @@ class UNREALMCP_API FUnrealMCPBlueprintNodeCommands
 public:
     FUnrealMCPBlueprintNodeCommands();
 
-    // Handle blueprint node commands
-    TSharedPtr<FJsonObject> HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params);
+    // Add the blueprint node commands to the bridge's command table
+    void RegisterCommands(FMCPCommandRegistry& Registry);
 
 private:
     // Specific blueprint node command handlers
@@ -35,6 +35,10 @@ public:
     // Actor utilities
     static TSharedPtr<FJsonValue> ActorToJson(AActor* Actor);
     static TSharedPtr<FJsonObject> ActorToJsonObject(AActor* Actor, bool bDetailed = false);
+
+    // Only the given fields of the actor, each one of GetActorJsonFields()
+    static TSharedPtr<FJsonValue> ActorToJson(AActor* Actor, const TArray<FString>& Fields);
+    static const TArray<FString>& GetActorJsonFields();
     
     // Blueprint utilities
     static UBlueprint* FindBlueprint(const FString& BlueprintName);
@@ -2,6 +2,13 @@
 
 #include "CoreMinimal.h"
 #include "Json.h"
+#include "MCPCommandContext.h"
+#include "MCPCommandRegistry.h"
+
+class FMCPActorIndex;
+class AActor;
+class ULevel;
+class UWorld;
 
 /**
  * Handler class for Editor-related MCP commands
@@ -10,12 +17,44 @@
 class UNREALMCP_API FUnrealMCPEditorCommands
 {
 public:
-    FUnrealMCPEditorCommands();
+    // Actors returned per get_actors_in_level page when the client doesn't say, and at most
+    static constexpr int32 DefaultActorPageSize = 500;
+    static constexpr int32 MaxActorPageSize = 5000;
+
+    explicit FUnrealMCPEditorCommands(FMCPActorIndex& InActorIndex);
 
-    // Handle editor commands
-    TSharedPtr<FJsonObject> HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params);
+    // Add the editor commands to the bridge's command table
+    void RegisterCommands(FMCPCommandRegistry& Registry);
 
 private:
+    // Which actors a listing returns, parsed from the request's class, tag, folder, level and bounds
+    struct FActorFilter
+    {
+        /** Class names the actor's class or one of its parents must have, empty for any */
+        TArray<FName> ClassNames;
+        bool bClassFilter = false;
+        /** Tag the actor must have, None with bTagFilter set when the tag was never used by anything */
+        FName Tag;
+        bool bTagFilter = false;
+        /** Outliner folder, matching its subfolders too */
+        FString Folder;
+        /** Levels the actor must be in, empty for any of the world's levels */
+        TArray<ULevel*> Levels;
+        /** Box the actor's location must be in */
+        TOptional<FBox> Bounds;
+
+        bool Matches(AActor* Actor) const;
+    };
+
+    static bool ParseActorFilter(const TSharedPtr<FJsonObject>& Params, UWorld* World, FActorFilter& OutFilter, FString& OutError);
+
+    /**
+     * Result of a region query: the indexed actors overlapping SearchBox that pass the request's
+     * filters and for which Overlaps holds, nearest Origin first. Overlaps gets the actor's bounds,
+     * or a point at its location when the request asks for the location test.
+     */
+    TSharedPtr<FJsonObject> QueryActors(const TSharedPtr<FJsonObject>& Params, UWorld* World, const FBox& SearchBox, const FVector& Origin, TFunctionRef<bool(const FBox&)> Overlaps);
+
     // Actor manipulation commands
     TSharedPtr<FJsonObject> HandleGetActorsInLevel(const TSharedPtr<FJsonObject>& Params);
     TSharedPtr<FJsonObject> HandleFindActorsByName(const TSharedPtr<FJsonObject>& Params);
@@ -27,6 +66,11 @@ private:
     TSharedPtr<FJsonObject> HandleGetActorComponents(const TSharedPtr<FJsonObject>& Params);
     TSharedPtr<FJsonObject> HandleSetActorComponentProperty(const TSharedPtr<FJsonObject>& Params);
 
+    // Spatial queries
+    TSharedPtr<FJsonObject> HandleQueryActorsInSphere(const TSharedPtr<FJsonObject>& Params);
+    TSharedPtr<FJsonObject> HandleQueryActorsInBox(const TSharedPtr<FJsonObject>& Params);
+    TSharedPtr<FJsonObject> HandleQueryActorsInFrustum(const TSharedPtr<FJsonObject>& Params);
+
     // Blueprint actor spawning
     TSharedPtr<FJsonObject> HandleSpawnBlueprintActor(const TSharedPtr<FJsonObject>& Params);
 
@@ -35,5 +79,8 @@ private:
     TSharedPtr<FJsonObject> HandleTakeScreenshot(const TSharedPtr<FJsonObject>& Params);
 
     // Save commands
-    TSharedPtr<FJsonObject> HandleSaveAll(const TSharedPtr<FJsonObject>& Params);
+    TSharedPtr<FJsonObject> HandleSaveAll(const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context);
+
+    // Name lookups for the commands that address one actor
+    FMCPActorIndex& ActorIndex;
 }; 
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 #include "Json.h"
+#include "MCPCommandRegistry.h"
 
 /**
  * Handler class for Project-wide MCP commands
@@ -11,8 +12,8 @@ class UNREALMCP_API FUnrealMCPProjectCommands
 public:
     FUnrealMCPProjectCommands();
 
-    // Handle project commands
-    TSharedPtr<FJsonObject> HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params);
+    // Add the project commands to the bridge's command table
+    void RegisterCommands(FMCPCommandRegistry& Registry);
 
 private:
     // Legacy input mapping (deprecated)
@@ -25,4 +26,7 @@ private:
     TSharedPtr<FJsonObject> HandleRemoveMappingFromContext(const TSharedPtr<FJsonObject>& Params);
     TSharedPtr<FJsonObject> HandleGetInputActions(const TSharedPtr<FJsonObject>& Params);
     TSharedPtr<FJsonObject> HandleGetInputMappingContexts(const TSharedPtr<FJsonObject>& Params);
+
+    // Asset registry queries, safe to run off the game thread
+    TSharedPtr<FJsonObject> HandleAssetExists(const TSharedPtr<FJsonObject>& Params);
 }; 
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 #include "Json.h"
+#include "MCPCommandRegistry.h"
 
 /**
  * Handles UMG (Widget Blueprint) related MCP commands
@@ -14,12 +15,10 @@ public:
     FUnrealMCPUMGCommands();
 
     /**
-     * Handle UMG-related commands
-     * @param CommandType - The type of command to handle
-     * @param Params - JSON parameters for the command
-     * @return JSON response with results or error
+     * Add the UMG commands to the bridge's command table
+     * @param Registry - The bridge's command registry
      */
-    TSharedPtr<FJsonObject> HandleCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params);
+    void RegisterCommands(FMCPCommandRegistry& Registry);
 
 private:
     /**
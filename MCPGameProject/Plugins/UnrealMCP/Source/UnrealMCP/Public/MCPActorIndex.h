@@ -0,0 +1,141 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+#include "Math/GenericOctree.h"
+
+class AActor;
+class ULevel;
+class UWorld;
+struct FPropertyChangedEvent;
+
+/**
+ * Actors by name and by location, per world, so commands that address an
+ * actor by name, or ask what is in some region, don't walk every actor in the
+ * level.
+ *
+ * A world's index is built the first time it is searched and then kept up to
+ * date from the editor's actor added, deleted and renamed events. Levels
+ * streaming in or out, and the world being torn down, drop the world's index
+ * so it is rebuilt on the next lookup. Actors can still appear without an
+ * event (undoing a delete, for one), so a name the index doesn't know, or
+ * whose entry is stale, is looked up directly in each of the world's levels
+ * before giving up. That costs a hash lookup per level, never a full scan.
+ *
+ * The spatial index is an octree over the actors' component bounds, built on
+ * the first region query in a world. Actors are re-inserted when the editor
+ * reports them moved or edited, and when a command changes them through
+ * UpdateActor; an undo or redo drops the octrees, as it can move anything.
+ * Entries are only as fresh as those events, so callers test the actors they
+ * get back against their current bounds.
+ *
+ * Game thread only.
+ */
+class FMCPActorIndex
+{
+public:
+	FMCPActorIndex();
+	~FMCPActorIndex();
+
+	/** Start and stop following the editor's actor events */
+	void Start();
+	void Stop();
+
+	/** The actor named Name in World, or null */
+	AActor* FindActor(UWorld* World, const FString& Name);
+	AActor* FindActor(UWorld* World, FName Name);
+
+	/** Actors in World whose indexed bounds overlap Box */
+	void FindActorsInBox(UWorld* World, const FBox& Box, TArray<AActor*>& OutActors);
+
+	/** Re-read Actor's bounds after a command moved or reshaped it */
+	void UpdateActor(AActor* Actor);
+
+	/** Bounds of the actor's components, or its location for an actor without any */
+	static FBox GetActorBounds(AActor* Actor);
+
+	/** Number of actors indexed by name across all worlds */
+	int32 Num() const;
+
+private:
+	typedef TMap<FName, TWeakObjectPtr<AActor>> FActorMap;
+
+	struct FOctreeElement
+	{
+		TWeakObjectPtr<AActor> Actor;
+		FObjectKey ActorKey;
+		FBoxCenterAndExtent Bounds;
+		/** Owning world's element ids, kept current as the octree moves elements between nodes */
+		TMap<FObjectKey, FOctreeElementId2>* ElementIds;
+	};
+
+	struct FOctreeSemantics
+	{
+		enum { MaxElementsPerLeaf = 16 };
+		enum { MinInclusiveElementsPerNode = 7 };
+		enum { MaxNodeDepth = 12 };
+
+		typedef TInlineAllocator<MaxElementsPerLeaf> ElementAllocator;
+
+		FORCEINLINE static const FBoxCenterAndExtent& GetBoundingBox(const FOctreeElement& Element)
+		{
+			return Element.Bounds;
+		}
+
+		FORCEINLINE static bool AreElementsEqual(const FOctreeElement& A, const FOctreeElement& B)
+		{
+			return A.ActorKey == B.ActorKey;
+		}
+
+		FORCEINLINE static void SetElementId(const FOctreeElement& Element, FOctreeElementId2 Id)
+		{
+			Element.ElementIds->Add(Element.ActorKey, Id);
+		}
+	};
+
+	struct FWorldOctree
+	{
+		FWorldOctree();
+
+		TOctree2<FOctreeElement, FOctreeSemantics> Octree;
+		TMap<FObjectKey, FOctreeElementId2> ElementIds;
+	};
+
+	/** World's index, built if it doesn't exist yet */
+	FActorMap& GetWorldIndex(UWorld* World);
+
+	/** Index Actor under its name, if its world is indexed */
+	void AddActor(AActor* Actor);
+	void RemoveActor(AActor* Actor, FName Name);
+
+	/** World's octree, built if it doesn't exist yet */
+	FWorldOctree& GetWorldOctree(UWorld* World);
+
+	static void AddToOctree(FWorldOctree& WorldOctree, AActor* Actor);
+	static void RemoveFromOctree(FWorldOctree& WorldOctree, FObjectKey ActorKey);
+
+	void OnLevelActorAdded(AActor* Actor);
+	void OnLevelActorDeleted(AActor* Actor);
+	void OnObjectRenamed(UObject* Object, UObject* OldOuter, FName OldName);
+	void OnLevelChanged(ULevel* Level, UWorld* World);
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+	void OnActorMoved(AActor* Actor);
+	void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& Event);
+	void OnUndoRedo();
+
+	TMap<FObjectKey, FActorMap> Worlds;
+
+	/** Held by pointer, the octree elements point back into them */
+	TMap<FObjectKey, TUniquePtr<FWorldOctree>> Octrees;
+
+	FDelegateHandle ActorAddedHandle;
+	FDelegateHandle ActorDeletedHandle;
+	FDelegateHandle ObjectRenamedHandle;
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+	FDelegateHandle WorldCleanupHandle;
+	FDelegateHandle ActorMovedHandle;
+	FDelegateHandle PropertyChangedHandle;
+	FDelegateHandle UndoRedoHandle;
+};
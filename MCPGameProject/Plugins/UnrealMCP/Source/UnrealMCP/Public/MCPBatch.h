@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "MCPCommandContext.h"
+
+class UUnrealMCPBridge;
+
+/**
+ * The batch command: an ordered list of commands run one after another inside
+ * a single game thread task, so building something out of many small commands
+ * costs one round trip instead of one per command.
+ *
+ * Parameters of an entry can use the result of an earlier one. An object of
+ * the form {"$ref": "<entry>.<path>"} is replaced by the value found at path
+ * in that entry's result, where entry is the entry's index or the "id" it was
+ * given, and path is a dot separated list of field names and array indices.
+ *
+ * With "transaction": true the batch runs inside an FMCPTransaction: one undo
+ * entry, and each blueprint compiled and each package saved once at the end.
+ */
+class FMCPBatch
+{
+public:
+	static constexpr int32 MaxEntries = 1000;
+
+	/** Run the batch described by Params and build its result. Game thread only. */
+	static TSharedPtr<FJsonObject> Run(UUnrealMCPBridge& Bridge, const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context);
+
+private:
+	struct FEntryResults
+	{
+		/** Result object of each entry that has run and succeeded, null otherwise */
+		TArray<TSharedPtr<FJsonObject>> Results;
+		/** Index of each entry that was given an id */
+		TMap<FString, int32> Names;
+	};
+
+	/** Copy of Value with every {"$ref": ...} object replaced by the value it refers to */
+	static TSharedPtr<FJsonValue> ResolveReferences(const TSharedPtr<FJsonValue>& Value, const FEntryResults& Earlier, FString& OutError);
+
+	/** Value a "$ref" path points at, or null with OutError set */
+	static TSharedPtr<FJsonValue> FindReference(const FString& Path, const FEntryResults& Earlier, FString& OutError);
+};
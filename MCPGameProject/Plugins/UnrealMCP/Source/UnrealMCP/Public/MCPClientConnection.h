@@ -0,0 +1,246 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/CriticalSection.h"
+#include "Dom/JsonObject.h"
+#include "MCPProtocol.h"
+#include <atomic>
+
+class FSocket;
+class FRunnableThread;
+class UUnrealMCPBridge;
+
+/**
+ * A single client connected to the MCP server.
+ * Owns the client socket, the bytes received from it that have not formed a
+ * complete message yet, and the thread that services it. Commands are handed
+ * to UUnrealMCPBridge::ExecuteCommandAsync, which serializes all clients onto
+ * the game thread. The client thread goes straight back to reading, so a client
+ * can have many requests in flight; responses carry the request's "id" and are
+ * sent in completion order. A background task serializes them and writes what
+ * the socket takes without waiting; the rest is written by the client thread
+ * as the client reads, so a client that stops reading only ties up its own
+ * thread, and is disconnected once too much of its output piles up. The wire
+ * format is described in MCPProtocol.h. Transport level commands are answered here,
+ * without going through the bridge: hello negotiates the payload format and
+ * open_shared_memory starts a second connection over shared memory rings
+ * that lives as long as this one. ping and health are answered here too, so
+ * liveness checks never wait for the game thread.
+ */
+class FMCPClientConnection : public FRunnable, public TSharedFromThis<FMCPClientConnection>
+{
+public:
+	FMCPClientConnection(UUnrealMCPBridge* InBridge, FSocket* InSocket, int32 InConnectionId);
+	virtual ~FMCPClientConnection();
+
+	/** Spawn the thread servicing this connection */
+	bool Start();
+
+	/**
+	 * Stop servicing the connection and wait for its thread to finish. Owners call
+	 * this before releasing the connection, so the destructor never runs on that thread.
+	 */
+	void Shutdown();
+
+	/** True once the client has disconnected or the connection failed */
+	bool IsFinished() const { return bFinished; }
+
+	int32 GetConnectionId() const { return ConnectionId; }
+
+	/**
+	 * Queue a response for sending. Safe to call from any thread.
+	 * @param CommandType - Command the response answers, for the server stats. Empty for progress events.
+	 */
+	void QueueResponse(TSharedPtr<FJsonObject> Response, const FString& CommandType = FString());
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	enum class EWireMode : uint8
+	{
+		/** Nothing received yet, the first bytes decide the mode */
+		Detect,
+		/** Bare JSON objects back to back */
+		Json,
+		/** Length-prefixed frames, see FMCPProtocol */
+		Framed
+	};
+
+	/**
+	 * Locate the next complete message at the front of the receive buffer.
+	 * @param OutOffset - Where the message payload starts in the buffer
+	 * @param OutLength - Size of the payload in bytes
+	 * @param OutConsumed - Bytes to drop from the buffer once the message is handled
+	 * @return true if a whole message is available
+	 */
+	bool ExtractMessage(int32& OutOffset, int32& OutLength, int32& OutConsumed);
+	bool DetectWireMode();
+	bool ExtractJsonMessage(int32& OutOffset, int32& OutLength, int32& OutConsumed);
+	bool ExtractFrame(int32& OutOffset, int32& OutLength, int32& OutConsumed);
+
+	/** Number of bytes the next Recv should ask for */
+	int32 GetReceiveSize() const;
+
+	/** @param ReceiveSeconds - Time from the message's first byte arriving to its last */
+	void ProcessMessage(const uint8* Data, int32 Length, double ReceiveSeconds);
+
+	/** Decode a request in the connection's current encoding */
+	TSharedPtr<FJsonObject> DecodeMessage(const uint8* Data, int32 Length) const;
+
+	/** How responses are put on the wire, negotiated with hello */
+	struct FPayloadFormat
+	{
+		EMCPEncoding Encoding = EMCPEncoding::Json;
+
+		/** FCompression format for responses of at least CompressionThreshold bytes, NAME_None when off */
+		FName Compression;
+	};
+
+	/** Answer the hello command and switch to the encoding and compression the client asked for */
+	void HandleHello(const TSharedPtr<FJsonObject>& Params, const TSharedPtr<FJsonValue>& RequestId);
+
+	/** Create a shared memory transport for this client and serve it on a connection of its own */
+	void HandleOpenSharedMemory(const TSharedPtr<FJsonObject>& Params, const TSharedPtr<FJsonValue>& RequestId);
+
+	/** Queue a success envelope around Result */
+	void QueueResult(const TSharedPtr<FJsonObject>& Result, const TSharedPtr<FJsonValue>& RequestId, TOptional<FPayloadFormat> NewFormat = TOptional<FPayloadFormat>());
+
+	/** Queue an error envelope */
+	void QueueError(const FString& Message, const TSharedPtr<FJsonValue>& RequestId);
+
+	/** Note a progress frame for a request in ProgressRequests, or with bAnswered that it no longer needs heartbeats */
+	void UpdateProgressRequest(const FString& RequestKey, bool bAnswered);
+
+	/**
+	 * Send a heartbeat progress frame for every request in ProgressRequests that
+	 * had no progress frame for a while, on the client thread. Handlers report
+	 * progress only between steps, if at all, and nothing else would show the
+	 * client that a long compile is still going.
+	 */
+	void SendProgressHeartbeats();
+
+	/**
+	 * Add a response to the outbox, sent in the connection's current payload format.
+	 * @param NewFormat - If set, the format used for everything queued after this response
+	 */
+	void QueueResponseWithFormat(TSharedPtr<FJsonObject> Response, TOptional<FPayloadFormat> NewFormat, const FString& CommandType = FString(), bool bAnswersRequest = false);
+
+	/** Serialize everything in the outbox and send what the socket takes, runs on a background task */
+	void FlushOutbox();
+	bool SendResponse(const TSharedPtr<FJsonObject>& Response, const FPayloadFormat& ResponseFormat, const FString& CommandType);
+
+	/**
+	 * Write as much of the unsent output as the socket takes, on the client thread.
+	 * @param bOutHasUnsent - Set if output is still waiting for the client to read
+	 * @param bOutAwaitingResponses - Set if requests handed to the bridge have not been answered yet
+	 * @return false on a socket error
+	 */
+	bool FlushUnsent(bool& bOutHasUnsent, bool& bOutAwaitingResponses);
+
+	/**
+	 * Replace the payload in SendBuffer with its compressed form if that is smaller.
+	 * @return The frame flags to send the payload with
+	 */
+	uint32 CompressPayload(int32 HeaderSize, FName Compression);
+
+	/** Send as much of Data as the socket takes without waiting. Returns false on a socket error. */
+	bool SendWithoutWaiting(const uint8* Data, int32 Length, int32& OutBytesSent);
+
+	UUnrealMCPBridge* Bridge;
+	FSocket* Socket;
+	int32 ConnectionId;
+	FRunnableThread* Thread;
+
+	EWireMode WireMode;
+
+	/** Largest message the client may send, larger ones close the connection */
+	int32 MaxMessageSize;
+
+	/**
+	 * Bytes received from the client that have not been consumed yet.
+	 * In framed mode this is sized for the whole frame once its header arrives,
+	 * so a large frame lands in a single allocation.
+	 */
+	TArray<uint8> ReceiveBuffer;
+
+	/** Payload size of the frame being collected, INDEX_NONE while waiting for a header */
+	int32 PendingFrameSize;
+
+	/** When the first bytes of the message being collected arrived */
+	double MessageStartTime;
+
+	/** Responses at least this large are compressed once the client turns compression on */
+	int32 CompressionThreshold;
+
+	/**
+	 * Payload format of the connection. Only changed by HandleHello on the
+	 * connection thread, and only while holding OutboxLock.
+	 */
+	FPayloadFormat Format;
+
+	struct FOutgoingResponse
+	{
+		TSharedPtr<FJsonObject> Response;
+		FPayloadFormat Format;
+		/** Counted in the server stats under this command, unless empty */
+		FString CommandType;
+		/** The response to a request counted in AwaitingResponses */
+		bool bAnswersRequest;
+	};
+
+	/** Responses waiting to be sent, guarded by OutboxLock */
+	TArray<FOutgoingResponse> Outbox;
+	FCriticalSection OutboxLock;
+	bool bFlushScheduled;
+
+	/** Serializes writers to the socket; SendBuffer is only touched while holding it */
+	FCriticalSection SendLock;
+
+	/** Reused for outgoing messages */
+	TArray<uint8> SendBuffer;
+
+	/** Reused for compressing outgoing messages, only touched while holding SendLock */
+	TArray<uint8> CompressBuffer;
+
+	/** Serialized output the socket hasn't taken yet, from UnsentOffset on. Only touched while holding SendLock. */
+	TArray<uint8> Unsent;
+	int32 UnsentOffset;
+
+	/** Unsent output beyond this closes the connection */
+	int32 MaxUnsentBytes;
+
+	/**
+	 * Requests handed to the bridge whose response hasn't been serialized yet.
+	 * While there are any the client thread waits in short slices, so output the
+	 * background task couldn't send is picked up promptly. Decremented only while
+	 * holding SendLock, together with adding to Unsent.
+	 */
+	std::atomic<int32> AwaitingResponses;
+
+	struct FProgressRequest
+	{
+		TSharedPtr<FJsonValue> RequestId;
+		/** When the request last had a progress frame, or was received */
+		double LastProgressTime;
+	};
+
+	/** Requests that asked for progress and haven't been answered, by id. Guarded by ProgressLock. */
+	TMap<FString, FProgressRequest> ProgressRequests;
+	FCriticalSection ProgressLock;
+
+	/** Connections opened with open_shared_memory, stopped when this one closes. Only used on the client thread. */
+	TArray<TSharedPtr<FMCPClientConnection>> SharedMemoryConnections;
+
+	/** JSON mode scanner state so each received byte is inspected only once */
+	int32 ScanOffset;
+	int32 ScanDepth;
+	bool bScanInString;
+	bool bScanEscaped;
+
+	FThreadSafeBool bRunning;
+	FThreadSafeBool bFinished;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include <atomic>
+
+/**
+ * Receives the response envelope of a command. Called on the game thread, or
+ * on the calling thread for commands answered without it.
+ */
+typedef TFunction<void(TSharedPtr<FJsonObject>)> FMCPResponseCallback;
+
+/** Receives progress events of a running command, called on the game thread */
+typedef TFunction<void(TSharedPtr<FJsonObject>)> FMCPProgressCallback;
+
+/**
+ * Per-request state handed to command handlers.
+ *
+ * Handlers that run long enough for a client to give up on them, like saving
+ * every dirty package, report how far they got through it. The events go out
+ * as progress frames ahead of the final response, so the client knows the
+ * editor is still working on its request. The same handlers check IsCancelled
+ * between steps and stop early once the client has cancelled the request or
+ * its deadline has passed.
+ */
+class UNREALMCP_API FMCPCommandContext
+{
+public:
+	FMCPCommandContext() = default;
+	explicit FMCPCommandContext(FMCPProgressCallback InOnProgress, TSharedPtr<std::atomic<bool>> InCancelFlag = nullptr, double InDeadline = 0.0, int32 InClientId = 0);
+
+	/**
+	 * Report that Completed of Total steps of Stage are done, Item naming the one
+	 * being worked on. Events are throttled, except for the first and last step.
+	 */
+	void ReportProgress(const FString& Stage, int32 Completed, int32 Total, const FString& Item = FString()) const;
+
+	bool WantsProgress() const { return (bool)OnProgress; }
+
+	/** True once the request was cancelled or ran past its deadline. Checked by handlers between steps. */
+	bool IsCancelled() const;
+
+	/** Connection the request came from, 0 for commands issued inside the editor */
+	int32 GetClientId() const { return ClientId; }
+
+private:
+	FMCPProgressCallback OnProgress;
+	TSharedPtr<std::atomic<bool>> CancelFlag;
+	/** FPlatformTime::Seconds() value the request has to finish by, 0 for none */
+	double Deadline = 0.0;
+	int32 ClientId = 0;
+	mutable double LastProgressTime = 0.0;
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "HAL/CriticalSection.h"
+#include "Containers/Ticker.h"
+#include "MCPCommandContext.h"
+
+class UUnrealMCPBridge;
+
+/** A command on its way to the game thread */
+struct FMCPCommandRequest
+{
+	/** Connection the command came from, 0 for commands issued inside the editor */
+	int32 ClientId = 0;
+	FString CommandType;
+	TSharedPtr<FJsonObject> Params;
+	FMCPResponseCallback OnComplete;
+	FMCPProgressCallback OnProgress;
+
+	/** Called on the game thread just before the command runs. Returning false drops it without a response. */
+	TFunction<bool()> OnStart;
+
+	/** The request's id as sent by the client, for cancel. Empty if it had none. */
+	FString RequestKey;
+
+	/** FPlatformTime::Seconds() value after which the result is no longer wanted, 0 for none */
+	double Deadline = 0.0;
+
+	/** Set to ask the command to stop at its next checkpoint. Created by the queue if not set. */
+	TSharedPtr<std::atomic<bool>> CancelFlag;
+
+	/** Keep the command when its client disconnects. Jobs set this, their results are collected later. */
+	bool bDetached = false;
+};
+
+/**
+ * Bounded queue between the network threads and the game thread.
+ *
+ * Commands wait here for their turn instead of each being posted to the task
+ * graph, so a client flooding the editor can't pile up more work than the
+ * queue holds. Each client also has a quota of queued commands, so one busy
+ * client can't take all the room. A command that doesn't fit is refused with
+ * an estimate of when to retry.
+ *
+ * A core ticker drains the queue on the game thread, oldest first, running
+ * commands until the frame's time budget is spent and leaving the rest for the
+ * next frame. At least one command runs per frame, however long it takes. The
+ * budget is kept small in an interactive editor so automation doesn't make it
+ * stutter, and large when running headless (-nullrhi), where nobody is looking
+ * and throughput is all that matters. Commands whose deadline passed while
+ * they waited, or whose client has gone, are dropped without running.
+ *
+ * An editor in the background throttles itself to a few frames a second,
+ * which would make every queued command wait for one of those frames. While
+ * commands are queued, and for a short while after, the queue overrides the
+ * editor's "Use Less CPU when in Background" setting through the editor's
+ * throttle override delegate. The setting itself is only read.
+ */
+class FMCPCommandQueue
+{
+public:
+	static constexpr int32 DefaultMaxDepth = 256;
+	static constexpr int32 DefaultMaxDepthPerClient = 64;
+	static constexpr float DefaultFrameBudgetMs = 8.0f;
+	static constexpr float DefaultHeadlessFrameBudgetMs = 100.0f;
+
+	explicit FMCPCommandQueue(UUnrealMCPBridge* InBridge);
+	~FMCPCommandQueue();
+
+	/**
+	 * @param InFrameBudgetMs - Game thread time per frame spent on commands
+	 * @param bInLiftBackgroundThrottle - Keep the editor running at full rate in the background while there are commands
+	 */
+	void Configure(int32 InMaxDepth, int32 InMaxDepthPerClient, float InFrameBudgetMs, bool bInLiftBackgroundThrottle);
+
+	/** Start and stop draining the queue from the core ticker. Game thread only. */
+	void Start();
+	void Stop();
+
+	/**
+	 * Queue a command. Returns false if there is no room, with OutRetryAfterMs set
+	 * to a suggested wait; Request is then left untouched.
+	 */
+	bool Enqueue(FMCPCommandRequest&& Request, int32& OutRetryAfterMs);
+
+	/** Answer every queued command with an error and empty the queue */
+	void Reset(const FString& Reason);
+
+	/**
+	 * Cancel a client's request. A queued one is dropped and answered with an error;
+	 * a running one is asked to stop at its next checkpoint. Returns false if the
+	 * request is neither queued nor running.
+	 */
+	bool Cancel(int32 ClientId, const FString& RequestKey, bool& bOutWasRunning);
+
+	/** Drop the commands of a client that disconnected and ask its running one to stop */
+	void CancelClient(int32 ClientId);
+
+	/** Queue depth, wait times and rejection counts */
+	TSharedPtr<FJsonObject> GetStats() const;
+
+	int32 GetDepth() const;
+
+	/** The command running on the game thread, if any, and how long it has been running */
+	bool GetRunningCommand(FString& OutCommandType, int32& OutClientId, double& OutRunningSeconds) const;
+
+	/**
+	 * Time since the game thread last ticked the queue, negative before the first tick.
+	 * The ticker runs every frame, so this is how long the game thread has been stuck.
+	 */
+	double GetSecondsSinceTick() const;
+
+	/** Error envelope sent back for a refused command */
+	static TSharedPtr<FJsonObject> MakeBusyResponse(int32 RetryAfterMs);
+
+private:
+	struct FQueuedCommand
+	{
+		FMCPCommandRequest Request;
+		double EnqueueTime = 0.0;
+	};
+
+	/** Ticker callback, runs commands until the frame budget is spent */
+	bool Tick(float DeltaTime);
+
+	/** Lift the editor's background throttle while there is work, put it back once idle. Game thread only. */
+	void UpdateBackgroundThrottle(bool bHasWork);
+	void RestoreBackgroundThrottle();
+
+	/** The editor's throttle override, asked each frame it would throttle in the background */
+	bool ShouldDisableCPUThrottling() const;
+
+	/** Run the oldest command. Returns false if the queue was empty. */
+	bool RunNext();
+
+	/** Take the command at Index out of the queue. Called with Lock held. */
+	FQueuedCommand RemoveCommand(int32 Index);
+
+	/** Error envelope for a command that was dropped without running */
+	static TSharedPtr<FJsonObject> MakeDroppedResponse(const FString& Message, const TCHAR* Flag);
+
+	/** Suggested wait before retrying, for Depth commands ahead. Called with Lock held. */
+	int32 EstimateRetryAfterMs(int32 Depth) const;
+
+	UUnrealMCPBridge* Bridge;
+
+	mutable FCriticalSection Lock;
+	TArray<FQueuedCommand> Commands;
+	TMap<int32, int32> QueuedPerClient;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	/** Guards against a command that pumps the ticker running the queue again */
+	bool bTicking;
+
+	/** Command running on the game thread, for cancel and health checks */
+	int32 RunningClientId;
+	FString RunningRequestKey;
+	FString RunningCommandType;
+	double RunningStartTime;
+	TSharedPtr<std::atomic<bool>> RunningCancelFlag;
+
+	/** FPlatformTime::Seconds() of the last tick, read without the lock by health checks */
+	std::atomic<double> LastTickTime;
+
+	int32 MaxDepth;
+	int32 MaxDepthPerClient;
+	double FrameBudgetSeconds;
+
+	/** Background throttling, game thread only apart from the metrics */
+	bool bLiftBackgroundThrottle;
+	bool bThrottleLifted;
+	FDelegateHandle ThrottleOverrideHandle;
+	/** FPlatformTime::Seconds() of the last tick that found commands queued */
+	double LastWorkTime;
+
+	// Metrics
+	int32 PeakDepth;
+	int64 AcceptedCount;
+	int64 RejectedCount;
+	int64 RejectedByClientQuotaCount;
+	int64 CompletedCount;
+	int64 ExpiredCount;
+	int64 CancelledCount;
+	/** Commands taken off the queue by RunNext, whose waits make up TotalWaitSeconds */
+	int64 DequeuedCount;
+	double TotalWaitSeconds;
+	double MaxWaitSeconds;
+	/** Moving average of how long a command runs on the game thread */
+	double AverageRunSeconds;
+	/** Frames that ran commands, and those of them that used up the whole budget */
+	int64 BusyFrameCount;
+	int64 BudgetExhaustedFrameCount;
+	int32 MaxCommandsPerFrame;
+	int64 ThrottleLiftCount;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Misc/EnumClassFlags.h"
+#include "MCPCommandContext.h"
+
+/** Runs a command and returns its result object */
+typedef TFunction<TSharedPtr<FJsonObject>(const TSharedPtr<FJsonObject>&, const FMCPCommandContext&)> FMCPCommandHandler;
+
+/**
+ * Runs a command that may answer after it returns, like job_result waiting for
+ * its job, by calling the callback with the response envelope exactly once
+ */
+typedef TFunction<void(const TSharedPtr<FJsonObject>&, const FMCPCommandContext&, FMCPResponseCallback)> FMCPDeferredCommandHandler;
+
+enum class EMCPCommandFlags : uint8
+{
+	None = 0,
+
+	/**
+	 * The handler may run on any thread: it only reads state that is safe to
+	 * read concurrently, such as asset registry queries, and touches no
+	 * UObjects beyond that. Such commands skip the game thread queue.
+	 */
+	ThreadSafe = 1 << 0,
+};
+ENUM_CLASS_FLAGS(EMCPCommandFlags);
+
+struct FMCPRegisteredCommand
+{
+	FMCPCommandHandler Handler;
+	/** Set instead of Handler for commands that answer through a callback */
+	FMCPDeferredCommandHandler DeferredHandler;
+	FName Category;
+	EMCPCommandFlags Flags = EMCPCommandFlags::None;
+};
+
+/**
+ * Command name to handler table used by the bridge's dispatch.
+ *
+ * The built-in command classes fill it when the bridge is created, and other
+ * editor modules can add their own commands through
+ * UUnrealMCPBridge::RegisterCommand. Names are FNames, so lookups hash
+ * instead of comparing strings, and like all FNames they are case-insensitive.
+ *
+ * Commands are added and removed on the game thread only. Lookups may come
+ * from any thread; they hand out shared references, so a command removed
+ * while one of its calls is running stays alive until that call is done.
+ */
+class UNREALMCP_API FMCPCommandRegistry
+{
+public:
+	/** Add a command. Returns false if the name is already taken. */
+	bool RegisterCommand(FName CommandType, FMCPCommandHandler Handler, FName Category = NAME_None, EMCPCommandFlags Flags = EMCPCommandFlags::None);
+
+	/**
+	 * Add a command that answers through a callback. Its handler is called on the
+	 * thread the request arrives on, so it must be ThreadSafe and must not block.
+	 * Returns false if the name is already taken.
+	 */
+	bool RegisterDeferredCommand(FName CommandType, FMCPDeferredCommandHandler Handler, FName Category = NAME_None, EMCPCommandFlags Flags = EMCPCommandFlags::ThreadSafe);
+
+	/** Add a command served by a handler class method that only needs the parameters */
+	template <typename HandlerClass>
+	bool RegisterMethod(FName CommandType, HandlerClass* Handlers, TSharedPtr<FJsonObject> (HandlerClass::*Method)(const TSharedPtr<FJsonObject>&), FName Category, EMCPCommandFlags Flags = EMCPCommandFlags::None)
+	{
+		return RegisterCommand(CommandType, [Handlers, Method](const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext&)
+		{
+			return (Handlers->*Method)(Params);
+		}, Category, Flags);
+	}
+
+	/** Remove a command. Returns false if it wasn't registered. */
+	bool UnregisterCommand(FName CommandType);
+
+	/** A command's handler and metadata, or null if there is none. Safe to call from any thread. */
+	TSharedPtr<const FMCPRegisteredCommand> FindCommand(const FString& CommandType) const;
+
+	/** Registered commands and their categories, sorted by name. Safe to call from any thread. */
+	TSharedPtr<FJsonObject> Describe() const;
+
+private:
+	bool AddCommand(FName CommandType, TSharedRef<FMCPRegisteredCommand> Command);
+
+	mutable FRWLock Lock;
+	TMap<FName, TSharedRef<const FMCPRegisteredCommand>> Commands;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "HAL/CriticalSection.h"
+#include "Containers/Ticker.h"
+#include "MCPCommandContext.h"
+
+class UUnrealMCPBridge;
+
+enum class EMCPJobState : uint8
+{
+	Queued,
+	Running,
+	Succeeded,
+	Failed,
+	Cancelled
+};
+
+/**
+ * Table of commands submitted to run in the background.
+ *
+ * submit queues a command for the game thread and answers with a job id right
+ * away, or with the command queue's busy response if it is full. job_status,
+ * job_result and job_cancel look the job up, among those submitted by the
+ * same connection: other connections are told the job is unknown. None of
+ * these wait for the game thread, so they are answered even while it is busy
+ * with a long compile or save. Cancelling a running job asks its command to
+ * stop at its next checkpoint; jobs are not cancelled when the client that
+ * submitted them disconnects. job_result can also be asked to answer only
+ * once the job has finished, without holding any thread while it waits.
+ *
+ * Finished jobs stay in the table until their result is collected, or until
+ * they are older than the retention period; a core ticker drops those even
+ * when no new jobs come in.
+ */
+class FMCPJobManager
+{
+public:
+	explicit FMCPJobManager(UUnrealMCPBridge* InBridge);
+	~FMCPJobManager();
+
+	/** True for the commands answered by the job manager */
+	static bool IsJobCommand(const FString& CommandType);
+
+	/**
+	 * Answer a job command. Called on the network thread, or on the game thread
+	 * inside a batch or a job; OnComplete runs on the calling thread, or on the
+	 * game thread for a job_result that waits. job_result doesn't wait when
+	 * called on the game thread.
+	 */
+	void HandleCommand(int32 ClientId, const FString& CommandType, const TSharedPtr<FJsonObject>& Params, FMCPResponseCallback OnComplete);
+
+	/** Cancel everything still queued and forget all jobs */
+	void Reset();
+
+private:
+	struct FJob
+	{
+		int64 Id = 0;
+		/** Connection that submitted the job, the only one that may look it up */
+		int32 ClientId = 0;
+		FString CommandType;
+		TSharedPtr<FJsonObject> Params;
+		EMCPJobState State = EMCPJobState::Queued;
+		bool bCancelRequested = false;
+		double SubmitTime = 0.0;
+		double StartTime = 0.0;
+		double FinishTime = 0.0;
+
+		/** Asks the running command to stop at its next checkpoint */
+		TSharedPtr<std::atomic<bool>> CancelFlag;
+
+		/** Latest progress event reported by the command */
+		TSharedPtr<FJsonObject> Progress;
+
+		/** Response envelope of the command once the job has finished */
+		TSharedPtr<FJsonObject> Response;
+
+		/** job_result requests waiting for the job to finish */
+		TArray<FMCPResponseCallback> Waiters;
+	};
+
+	TSharedPtr<FJsonObject> Submit(int32 ClientId, const TSharedPtr<FJsonObject>& Params);
+	TSharedPtr<FJsonObject> GetStatus(int32 ClientId, const TSharedPtr<FJsonObject>& Params);
+	void GetResult(int32 ClientId, const TSharedPtr<FJsonObject>& Params, FMCPResponseCallback& OnComplete);
+	TSharedPtr<FJsonObject> Cancel(int32 ClientId, const TSharedPtr<FJsonObject>& Params);
+
+	/** Game thread side of a job. StartJob returns false for a job cancelled while queued. */
+	bool StartJob(const TSharedPtr<FJob>& Job);
+	void CompleteJob(const TSharedPtr<FJob>& Job, const TSharedPtr<FJsonObject>& Response);
+
+	/** Mark a job finished and hand its result to anyone waiting. Called with Lock held, returns the waiters to notify. */
+	TArray<FMCPResponseCallback> FinishJob(FJob& Job, EMCPJobState State, const TSharedPtr<FJsonObject>& Response);
+
+	/** Find ClientId's job named by the job_id parameter. Called with Lock held. */
+	TSharedPtr<FJob> FindJob(int32 ClientId, const TSharedPtr<FJsonObject>& Params) const;
+
+	/** Drop finished jobs nobody collected in time. Called with Lock held. */
+	void EvictExpiredJobs();
+
+	/** Status fields shared by all job command results. Called with Lock held. */
+	TSharedPtr<FJsonObject> DescribeJob(const FJob& Job) const;
+
+	UUnrealMCPBridge* Bridge;
+
+	FCriticalSection Lock;
+	TMap<int64, TSharedPtr<FJob>> Jobs;
+	int64 NextJobId;
+
+	FTSTicker::FDelegateHandle EvictionTickerHandle;
+};
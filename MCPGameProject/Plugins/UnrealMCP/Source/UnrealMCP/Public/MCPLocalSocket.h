@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Sockets.h"
+
+/**
+ * Base for the same-host transports that stand in for an FSocket.
+ * FMCPServerRunnable and FMCPClientConnection only use the stream calls of
+ * FSocket, so a local transport implements those and inherits no-ops for the
+ * IP specific ones (addresses, multicast, socket options) from here.
+ */
+class FMCPLocalSocket : public FSocket
+{
+public:
+	FMCPLocalSocket(const FString& InSocketDescription, const FName& InProtocol)
+		: FSocket(SOCKTYPE_Streaming, InSocketDescription, InProtocol)
+	{
+	}
+
+	// Accept(FInternetAddr&, ...) below forwards to the subclass's Accept(const FString&)
+	using FSocket::Accept;
+
+	// FSocket interface, IP specific parts
+	virtual bool Bind(const FInternetAddr& Addr) override { return false; }
+	virtual bool Connect(const FInternetAddr& Addr) override { return false; }
+	virtual FSocket* Accept(FInternetAddr& OutAddr, const FString& InSocketDescription) override { return Accept(InSocketDescription); }
+	virtual bool SendTo(const uint8* Data, int32 Count, int32& BytesSent, const FInternetAddr& Destination) override { return Send(Data, Count, BytesSent); }
+	virtual bool RecvFrom(uint8* Data, int32 BufferSize, int32& BytesRead, FInternetAddr& Source, ESocketReceiveFlags::Type Flags = ESocketReceiveFlags::None) override { return Recv(Data, BufferSize, BytesRead, Flags); }
+	virtual void GetAddress(FInternetAddr& OutAddr) override {}
+	virtual bool GetPeerAddress(FInternetAddr& OutAddr) override { return false; }
+	virtual bool SetBroadcast(bool bAllowBroadcast = true) override { return false; }
+	virtual bool JoinMulticastGroup(const FInternetAddr& GroupAddress) override { return false; }
+	virtual bool JoinMulticastGroup(const FInternetAddr& GroupAddress, const FInternetAddr& InterfaceAddress) override { return false; }
+	virtual bool LeaveMulticastGroup(const FInternetAddr& GroupAddress) override { return false; }
+	virtual bool LeaveMulticastGroup(const FInternetAddr& GroupAddress, const FInternetAddr& InterfaceAddress) override { return false; }
+	virtual bool SetMulticastLoopback(bool bLoopback) override { return false; }
+	virtual bool SetMulticastTtl(uint8 TimeToLive) override { return false; }
+	virtual bool SetMulticastInterface(const FInternetAddr& InterfaceAddress) override { return false; }
+	virtual bool SetReuseAddr(bool bAllowReuse = true) override { return true; }
+	virtual bool SetLinger(bool bShouldLinger = true, int32 Timeout = 0) override { return false; }
+	virtual bool SetRecvErr(bool bUseErrorQueue = true) override { return false; }
+	virtual int32 GetPortNo() override { return 0; }
+
+	// There is no Nagle buffering on a local transport, writes are delivered immediately
+	virtual bool SetNoDelay(bool bIsNoDelay = true) override { return true; }
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+/**
+ * MessagePack encoding of the JSON object model, used by connections that
+ * negotiated the "msgpack" encoding with the hello command.
+ *
+ * Requests and responses keep the same shape as their JSON counterparts, only
+ * the bytes differ. Numbers that hold whole values are written as MessagePack
+ * integers, everything else as float64. Arrays made only of numbers where at
+ * least one is fractional (vectors, rotators, float arrays) are written as an
+ * extension of type PackedFloat64ExtType whose data is the little-endian
+ * float64 values back to back, instead of one tagged number per element.
+ */
+struct UNREALMCP_API FMCPMessagePack
+{
+	/** MessagePack extension type for packed float64 arrays */
+	static constexpr int8 PackedFloat64ExtType = 1;
+
+	/** Append the encoding of Object to Out */
+	static void Write(const TSharedRef<FJsonObject>& Object, TArray<uint8>& Out);
+
+	/**
+	 * Decode a single MessagePack map.
+	 * @return The decoded object, or nullptr if Data is not a well formed map that fills exactly Length bytes
+	 */
+	static TSharedPtr<FJsonObject> Read(const uint8* Data, int32 Length);
+};
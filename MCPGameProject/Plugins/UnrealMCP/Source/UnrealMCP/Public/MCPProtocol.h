@@ -0,0 +1,121 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/Compression.h"
+
+/**
+ * Wire format shared by the MCP transports.
+ *
+ * A connection starts in one of two modes, picked from its first bytes:
+ *  - JSON mode: the client sends bare JSON objects back to back (optionally
+ *    separated by whitespace or newlines). Kept for existing clients.
+ *  - Framed mode: the client opens with the four byte Magic and then sends
+ *    frames. Each frame is a 4-byte big-endian header followed by the payload.
+ *    The low 30 bits of the header hold the payload length, the top two bits
+ *    are reserved for frame flags. A frame with an empty payload is a
+ *    keep-alive and is ignored. Replies use the same framing.
+ *
+ * Payloads are UTF-8 JSON until the client sends a "hello" command that picks
+ * another encoding (see EMCPEncoding). The hello response is still encoded the
+ * old way, everything after it in both directions uses the new encoding. Binary
+ * encodings are only offered in framed mode, since they can't be delimited
+ * without a length prefix.
+ *
+ * hello can also turn on response compression (framed mode only). Responses
+ * of at least the compression threshold are then compressed with the
+ * negotiated FCompression format and sent with FrameFlagCompressed set; their
+ * payload is the 4-byte big-endian uncompressed size followed by the
+ * compressed bytes.
+ */
+enum class EMCPEncoding : uint8
+{
+	Json,
+	/** See FMCPMessagePack */
+	MessagePack
+};
+
+struct FMCPProtocol
+{
+	/** Preamble that switches a connection to framed mode */
+	static constexpr uint8 Magic[4] = { 'U', 'M', 'C', 'P' };
+
+	static constexpr int32 FrameHeaderSize = 4;
+	static constexpr uint32 FrameLengthMask = 0x3FFFFFFF;
+	static constexpr uint32 FrameFlagsMask = ~FrameLengthMask;
+	static constexpr uint32 FrameFlagCompressed = 0x80000000;
+
+	/** Default upper bound for a single incoming message, see MaxMessageSize in [UnrealMCP] */
+	static constexpr int32 DefaultMaxMessageSize = 64 * 1024 * 1024;
+
+	/** Default size from which responses are compressed, see CompressionThreshold in [UnrealMCP] */
+	static constexpr int32 DefaultCompressionThreshold = 16 * 1024;
+
+	/** Default limit on response bytes a client has not read yet, see MaxUnsentResponseBytes in [UnrealMCP] */
+	static constexpr int32 DefaultMaxUnsentResponseBytes = 256 * 1024 * 1024;
+
+	/** Bumped when the wire format changes in a way clients need to know about, reported by hello */
+	static constexpr int32 Version = 1;
+
+	static const TCHAR* GetEncodingName(EMCPEncoding Encoding)
+	{
+		switch (Encoding)
+		{
+		case EMCPEncoding::MessagePack:
+			return TEXT("msgpack");
+		default:
+			return TEXT("json");
+		}
+	}
+
+	static bool ParseEncodingName(const FString& Name, EMCPEncoding& OutEncoding)
+	{
+		if (Name == TEXT("json"))
+		{
+			OutEncoding = EMCPEncoding::Json;
+			return true;
+		}
+		if (Name == TEXT("msgpack"))
+		{
+			OutEncoding = EMCPEncoding::MessagePack;
+			return true;
+		}
+		return false;
+	}
+
+	/** Wire name of a compression format, as used by hello */
+	static FString GetCompressionName(FName Format)
+	{
+		return Format.IsNone() ? FString(TEXT("none")) : Format.ToString().ToLower();
+	}
+
+	/** Compression formats offered to clients, in order of preference, that this build can produce */
+	static TArray<FName> GetSupportedCompressionFormats()
+	{
+		TArray<FName> Formats;
+		for (FName Format : { NAME_Oodle, NAME_Zlib })
+		{
+			if (FCompression::IsFormatValid(Format))
+			{
+				Formats.Add(Format);
+			}
+		}
+		return Formats;
+	}
+
+	static void WriteFrameHeader(uint8* Out, uint32 PayloadLength, uint32 Flags = 0)
+	{
+		const uint32 Header = (PayloadLength & FrameLengthMask) | (Flags & FrameFlagsMask);
+		Out[0] = (uint8)(Header >> 24);
+		Out[1] = (uint8)(Header >> 16);
+		Out[2] = (uint8)(Header >> 8);
+		Out[3] = (uint8)(Header);
+	}
+
+	/** Returns the payload length and stores the flag bits in OutFlags */
+	static uint32 ReadFrameHeader(const uint8* In, uint32& OutFlags)
+	{
+		const uint32 Header = ((uint32)In[0] << 24) | ((uint32)In[1] << 16) | ((uint32)In[2] << 8) | (uint32)In[3];
+		OutFlags = Header & FrameFlagsMask;
+		return Header & FrameLengthMask;
+	}
+};
@@ -3,12 +3,19 @@
 #include "CoreMinimal.h"
 #include "HAL/Runnable.h"
 #include "Sockets.h"
+#include "HAL/ThreadSafeBool.h"
 #include "Interfaces/IPv4/IPv4Address.h"
 
 class UUnrealMCPBridge;
+class FMCPClientConnection;
 
 /**
  * Runnable class for the MCP server thread
+ * Accepts client connections and keeps the set of connected clients.
+ * The thread sleeps in a socket wait until a client connects or Stop() is called.
+ * Each client is serviced by its own FMCPClientConnection, so several
+ * clients can keep their sockets open and submit work at the same time.
+ * The bridge runs one of these per listener (TCP and, if configured, AF_UNIX).
  */
 class FMCPServerRunnable : public FRunnable
 {
@@ -23,12 +30,14 @@ public:
 	virtual void Exit() override;
 
 protected:
-	void HandleClientConnection(TSharedPtr<FSocket> ClientSocket);
-	void ProcessMessage(TSharedPtr<FSocket> Client, const FString& Message);
+	void AcceptPendingConnections();
+	void WakeListener();
+	void ReapFinishedConnections();
+	void CloseAllConnections();
 
 private:
 	UUnrealMCPBridge* Bridge;
 	TSharedPtr<FSocket> ListenerSocket;
-	TSharedPtr<FSocket> ClientSocket;
-	bool bRunning;
-}; 
\ No newline at end of file
+	TArray<TSharedPtr<FMCPClientConnection>> Connections;
+	FThreadSafeBool bRunning;
+}; 
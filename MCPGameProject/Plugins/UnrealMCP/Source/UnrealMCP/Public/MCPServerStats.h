@@ -0,0 +1,104 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "HAL/CriticalSection.h"
+
+/** Steps a request goes through, each timed separately */
+enum class EMCPStatStage : uint8
+{
+	/** First byte of the message to the last one arriving */
+	Receive,
+	/** Decoding the message into JSON */
+	Parse,
+	/** Waiting in the command queue for the game thread */
+	QueueWait,
+	/** Running the command handler */
+	Handler,
+	/** Encoding and compressing the response */
+	Serialize,
+	/** Writing the response to the socket */
+	Send,
+
+	Count
+};
+
+/**
+ * Latency histogram with fixed log-scale buckets: four per power of two of
+ * microseconds, so percentiles are within about 12% of the true value and
+ * adding a sample is a few integer operations with no allocation.
+ */
+struct FMCPLatencyHistogram
+{
+	static constexpr int32 NumBuckets = 144;
+
+	void Add(double Seconds);
+
+	/** Approximate value below which Fraction of the samples fall, in milliseconds */
+	double GetPercentileMs(double Fraction) const;
+
+	/** count, average, p50, p95, p99 and max, in milliseconds */
+	TSharedPtr<FJsonObject> ToJson() const;
+
+	uint32 Buckets[NumBuckets] = {};
+	int64 Count = 0;
+	double TotalSeconds = 0.0;
+	double MaxSeconds = 0.0;
+};
+
+/**
+ * Per command type request counts, error counts, byte sizes and stage latencies.
+ *
+ * Each stage is recorded on the thread that measured it: receive and parse on
+ * the connection thread, queue wait and handler on the game thread, serialize
+ * and send on the connection's send task. Every record call takes one short
+ * lock and touches only fixed size counters, so the stats stay on all the time.
+ * The number of distinct command types is capped so clients sending made up
+ * names can't grow the table; the rest are counted under "(other)".
+ */
+class FMCPServerStats
+{
+public:
+	static constexpr int32 MaxCommandTypes = 128;
+
+	FMCPServerStats();
+
+	/** A request was read off the wire */
+	void RecordReceived(const FString& CommandType, int32 RequestBytes, double ReceiveSeconds, double ParseSeconds);
+
+	/** A command left the queue. HandlerSeconds is unset when it was dropped without running. */
+	void RecordRun(const FString& CommandType, double WaitSeconds, TOptional<double> HandlerSeconds);
+
+	/** A response was written to the wire */
+	void RecordSent(const FString& CommandType, int32 ResponseBytes, double SerializeSeconds, double SendSeconds, bool bError);
+
+	/** Everything recorded since the start or the last reset, by command type */
+	TSharedPtr<FJsonObject> ToJson() const;
+
+	/** Append one row per command type and stage to a CSV file, writing the header if the file is new */
+	bool AppendCsv(const FString& Path) const;
+
+	void Reset();
+
+	static const TCHAR* GetStageName(EMCPStatStage Stage);
+
+private:
+	struct FCommandStats
+	{
+		int64 Requests = 0;
+		int64 Errors = 0;
+		int64 RequestBytes = 0;
+		int64 MaxRequestBytes = 0;
+		int64 Responses = 0;
+		int64 ResponseBytes = 0;
+		int64 MaxResponseBytes = 0;
+		FMCPLatencyHistogram Stages[(int32)EMCPStatStage::Count];
+	};
+
+	/** Entry for CommandType, or the overflow entry once the table is full. Called with Lock held. */
+	FCommandStats& FindOrAdd(const FString& CommandType);
+
+	mutable FCriticalSection Lock;
+	TMap<FString, FCommandStats> Commands;
+	double StartTime;
+};
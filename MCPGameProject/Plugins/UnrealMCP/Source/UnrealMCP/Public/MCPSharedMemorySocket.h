@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MCPLocalSocket.h"
+
+/** Shared memory connections rely on POSIX shm and futexes */
+#define WITH_MCP_SHARED_MEMORY PLATFORM_LINUX
+
+#if WITH_MCP_SHARED_MEMORY
+
+struct FMCPSharedMemoryControl;
+struct FMCPSharedRing;
+
+/**
+ * Same-host transport over a POSIX shared memory object, for bulk transfers
+ * where copying through a socket would dominate.
+ *
+ * A client asks for one with the open_shared_memory command on an ordinary
+ * connection. The region holds two single-producer/single-consumer byte rings,
+ * client to editor and editor to client, and the client then speaks the
+ * normal protocol over them (magic, frames, hello) exactly as it would over a
+ * socket. Each ring has a futex doorbell the reader sleeps on when it is empty
+ * and another the writer sleeps on when it is full; wake-ups are only issued
+ * when the other side is actually asleep.
+ *
+ * Layout, all fields little-endian:
+ *  - Control block at 0: "UMSM", uint32 version, uint64 ring size, uint32 client closed, uint32 editor closed
+ *  - Request ring header at ControlSize, response ring header at ControlSize + RingHeaderSize.
+ *    Each header: uint64 head at 0 (bytes written), uint64 tail at 64 (bytes read),
+ *    uint32 data doorbell at 128, uint32 reader asleep at 132,
+ *    uint32 space doorbell at 192, uint32 writer asleep at 196
+ *  - Request ring data at DataOffset, response ring data at DataOffset + ring size
+ */
+class FMCPSharedMemorySocket : public FMCPLocalSocket
+{
+public:
+	static const FName ProtocolName;
+
+	static constexpr uint32 Version = 1;
+	static constexpr int32 ControlSize = 256;
+	static constexpr int32 RingHeaderSize = 256;
+	static constexpr int32 DataOffset = 4096;
+
+	/** Ring size used when the client doesn't ask for one, and the accepted range */
+	static constexpr uint64 DefaultRingSize = 16 * 1024 * 1024;
+	static constexpr uint64 MinRingSize = 64 * 1024;
+	static constexpr uint64 MaxRingSize = 1024 * 1024 * 1024;
+
+	/**
+	 * Create and map a new shared memory object, readable and writable by the editor's user only.
+	 * @param Name - POSIX shm name, starting with '/'
+	 * @param RequestedRingSize - Capacity of each ring, clamped and rounded up to a power of two
+	 * @return The editor's end of the transport, or nullptr on failure
+	 */
+	static FMCPSharedMemorySocket* Create(const FString& Name, uint64 RequestedRingSize);
+
+	virtual ~FMCPSharedMemorySocket();
+
+	const FString& GetName() const { return Name; }
+	uint64 GetRingSize() const { return RingSize; }
+
+	// FSocket interface
+	virtual bool Shutdown(ESocketShutdownMode Mode) override;
+	virtual bool Close() override;
+	virtual bool Listen(int32 MaxBacklog) override { return false; }
+	virtual bool WaitForPendingConnection(bool& bHasPendingConnection, const FTimespan& WaitTime) override { bHasPendingConnection = false; return false; }
+	virtual bool HasPendingData(uint32& PendingDataSize) override;
+	virtual FSocket* Accept(const FString& InSocketDescription) override { return nullptr; }
+	virtual bool Send(const uint8* Data, int32 Count, int32& BytesSent) override;
+	virtual bool Recv(uint8* Data, int32 BufferSize, int32& BytesRead, ESocketReceiveFlags::Type Flags = ESocketReceiveFlags::None) override;
+	virtual bool Wait(ESocketWaitConditions::Type Condition, FTimespan WaitTime) override;
+	virtual ESocketConnectionState GetConnectionState() override;
+	virtual bool SetNonBlocking(bool bIsNonBlocking = true) override { return bIsNonBlocking; }
+	virtual bool SetSendBufferSize(int32 Size, int32& NewSize) override { NewSize = (int32)FMath::Min<uint64>(RingSize, MAX_int32); return true; }
+	virtual bool SetReceiveBufferSize(int32 Size, int32& NewSize) override { NewSize = (int32)FMath::Min<uint64>(RingSize, MAX_int32); return true; }
+
+private:
+	FMCPSharedMemorySocket(const FString& InName, uint8* InRegion, uint64 InRegionSize, uint64 InRingSize);
+
+	bool IsClosed() const;
+
+	/** False, after closing the connection, if the client left a ring's head and tail further apart than the ring */
+	bool CheckRing(uint64 Head, uint64 Tail, const TCHAR* RingName);
+
+	/** Sleep until the ring has data (bForData) or free space, the peer closes, or WaitTime passes */
+	bool WaitOnRing(FMCPSharedRing& Ring, bool bForData, FTimespan WaitTime);
+
+	FString Name;
+	uint8* Region;
+	uint64 RegionSize;
+	uint64 RingSize;
+
+	FMCPSharedMemoryControl* Control;
+	/** Written by the client, read here */
+	FMCPSharedRing* RequestRing;
+	/** Written here, read by the client */
+	FMCPSharedRing* ResponseRing;
+	uint8* RequestData;
+	uint8* ResponseData;
+};
+
+#endif // WITH_MCP_SHARED_MEMORY
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/MiscTrace.h"
+
+/**
+ * Unreal Insights instrumentation of the request pipeline.
+ *
+ * Fixed stages use TRACE_CPUPROFILER_EVENT_SCOPE directly. Command handlers
+ * run inside an FMCPTraceCommandScope named after the command, and each
+ * command that reaches the game thread drops a bookmark with its request id
+ * and client, so a capture taken with the default channels
+ * (-trace=default) lines MCP work up against editor frames.
+ */
+
+/**
+ * CPU trace scope named "<Prefix> <CommandType>". The name is only built when
+ * the CPU channel is on, so outside a capture this is a flag check. Only use
+ * it with registered command names: each distinct name becomes its own timer.
+ */
+class FMCPTraceCommandScope
+{
+public:
+	FMCPTraceCommandScope(const TCHAR* Prefix, const FString& CommandType)
+	{
+#if CPUPROFILERTRACE_ENABLED
+		bActive = UE_TRACE_CHANNELEXPR_IS_ENABLED(CpuChannel);
+		if (bActive)
+		{
+			FCpuProfilerTrace::OutputBeginDynamicEvent(*FString::Printf(TEXT("%s %s"), Prefix, *CommandType));
+		}
+#endif
+	}
+
+	~FMCPTraceCommandScope()
+	{
+#if CPUPROFILERTRACE_ENABLED
+		if (bActive)
+		{
+			FCpuProfilerTrace::OutputEndEvent();
+		}
+#endif
+	}
+
+	FMCPTraceCommandScope(const FMCPTraceCommandScope&) = delete;
+	FMCPTraceCommandScope& operator=(const FMCPTraceCommandScope&) = delete;
+
+private:
+#if CPUPROFILERTRACE_ENABLED
+	bool bActive = false;
+#endif
+};
+
+/** Bookmark a request in the trace with its command, id and client */
+#define MCP_TRACE_REQUEST(CommandType, RequestKey, ClientId) \
+	TRACE_BOOKMARK(TEXT("MCP %s id=%s client=%d"), *(CommandType), *(RequestKey), (ClientId))
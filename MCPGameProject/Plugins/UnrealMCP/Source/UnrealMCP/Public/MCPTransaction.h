@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class FScopedTransaction;
+class UBlueprint;
+class UPackage;
+
+/**
+ * Groups the commands of a transactional batch into one editor transaction,
+ * so they are undone together, and holds back the compiles and saves the
+ * handlers would otherwise do after every small change.
+ *
+ * Handlers go through CompileBlueprint and SavePackage below. With no
+ * transaction open these act immediately; inside one they only note the
+ * blueprint or package, and Commit compiles each blueprint once and then
+ * saves each package once. Handlers that need an up to date generated class
+ * call EnsureCompiled first, and an explicit compile goes through
+ * CompileBlueprintNow so Commit doesn't compile the blueprint again.
+ *
+ * Game thread only. Transactions don't nest.
+ */
+class FMCPTransaction
+{
+public:
+	explicit FMCPTransaction(const FText& Description);
+	~FMCPTransaction();
+
+	/** Compile the blueprints and save the packages held back so far, and close the transaction */
+	TSharedPtr<FJsonObject> Commit();
+
+	static bool IsOpen() { return Current != nullptr; }
+
+	/** Compile Blueprint now, or at commit while a transaction is open */
+	static void CompileBlueprint(UBlueprint* Blueprint);
+
+	/** Compile Blueprint now if its compile is being held back */
+	static void EnsureCompiled(UBlueprint* Blueprint);
+
+	/** Compile Blueprint now, for an explicit compile, and drop any compile held back for it */
+	static void CompileBlueprintNow(UBlueprint* Blueprint);
+
+	/**
+	 * Save Package, with Asset as its main object, now, or at commit while a
+	 * transaction is open. A held back save reports success.
+	 */
+	static bool SavePackage(UPackage* Package, UObject* Asset);
+
+	/** Save Asset through the editor asset library now, or its package at commit */
+	static bool SaveAsset(UObject* Asset);
+
+private:
+	struct FPendingSave
+	{
+		TWeakObjectPtr<UPackage> Package;
+		TWeakObjectPtr<UObject> Asset;
+	};
+
+	static bool SavePackageNow(UPackage* Package, UObject* Asset);
+
+	static FMCPTransaction* Current;
+
+	TUniquePtr<FScopedTransaction> Transaction;
+	TArray<TWeakObjectPtr<UBlueprint>> PendingCompiles;
+	TArray<FPendingSave> PendingSaves;
+	int32 HeldBackCompileCount;
+	int32 HeldBackSaveCount;
+};
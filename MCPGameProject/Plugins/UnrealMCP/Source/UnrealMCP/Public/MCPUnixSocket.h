@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MCPLocalSocket.h"
+
+/** AF_UNIX listeners are only implemented where the engine runs on POSIX sockets we can reach directly */
+#define WITH_MCP_UNIX_SOCKET PLATFORM_LINUX
+
+#if WITH_MCP_UNIX_SOCKET
+
+/**
+ * FSocket over a native AF_UNIX stream socket.
+ * The engine's socket subsystem only knows IP addresses, so this wraps the
+ * file descriptor directly. It implements the calls the MCP server uses
+ * (listen, accept, wait, send, receive) so FMCPServerRunnable and
+ * FMCPClientConnection serve it exactly like a TCP socket. Errors are left in errno, where the platform socket
+ * subsystem's GetLastErrorCode() picks them up.
+ */
+class FMCPUnixSocket : public FMCPLocalSocket
+{
+public:
+	/** Protocol name reported by GetProtocol(), tells these apart from the engine's sockets */
+	static const FName ProtocolName;
+
+	/**
+	 * Create a listener bound to Path. A stale socket file left at Path by a
+	 * previous editor is removed first.
+	 * @return The listening socket, or nullptr if it could not be created
+	 */
+	static FMCPUnixSocket* CreateListener(const FString& Path, int32 MaxBacklog);
+
+	virtual ~FMCPUnixSocket();
+
+	/** Make a pending WaitForPendingConnection on this listener return right away */
+	void WakeListener();
+
+	// FSocket interface
+	virtual bool Shutdown(ESocketShutdownMode Mode) override;
+	virtual bool Close() override;
+	virtual bool Listen(int32 MaxBacklog) override;
+	virtual bool WaitForPendingConnection(bool& bHasPendingConnection, const FTimespan& WaitTime) override;
+	virtual bool HasPendingData(uint32& PendingDataSize) override;
+	virtual FSocket* Accept(const FString& InSocketDescription) override;
+	virtual bool Send(const uint8* Data, int32 Count, int32& BytesSent) override;
+	virtual bool Recv(uint8* Data, int32 BufferSize, int32& BytesRead, ESocketReceiveFlags::Type Flags = ESocketReceiveFlags::None) override;
+	virtual bool Wait(ESocketWaitConditions::Type Condition, FTimespan WaitTime) override;
+	virtual ESocketConnectionState GetConnectionState() override;
+	virtual bool SetNonBlocking(bool bIsNonBlocking = true) override;
+	virtual bool SetSendBufferSize(int32 Size, int32& NewSize) override;
+	virtual bool SetReceiveBufferSize(int32 Size, int32& NewSize) override;
+
+private:
+	FMCPUnixSocket(int InDescriptor, const FString& InPath, bool bInOwnsPath, const FString& InSocketDescription);
+
+	int Descriptor;
+
+	/** Filesystem path of the socket */
+	FString Path;
+
+	/** Listeners unlink their socket file when they close */
+	bool bOwnsPath;
+};
+
+#endif // WITH_MCP_UNIX_SOCKET
@@ -8,6 +8,14 @@
 #include "Json.h"
 #include "Interfaces/IPv4/IPv4Address.h"
 #include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "MCPCommandContext.h"
+#include "MCPCommandQueue.h"
+#include "MCPCommandRegistry.h"
+#include "MCPJobManager.h"
+#include "MCPServerStats.h"
+#include "MCPActorIndex.h"
+#include "Containers/Ticker.h"
 #include "Commands/UnrealMCPEditorCommands.h"
 #include "Commands/UnrealMCPBlueprintCommands.h"
 #include "Commands/UnrealMCPBlueprintNodeCommands.h"
@@ -20,8 +28,9 @@ class FMCPServerRunnable;
 /**
  * Editor subsystem for MCP Bridge
  * Handles communication between external tools and the Unreal Editor
- * through a TCP socket connection. Commands are received as JSON and
- * routed to appropriate command handlers.
+ * through a TCP socket connection, and on Linux optionally an AF_UNIX
+ * socket. Commands are received as JSON and routed to appropriate
+ * command handlers.
  */
 UCLASS()
 class UNREALMCP_API UUnrealMCPBridge : public UEditorSubsystem
@@ -40,20 +49,106 @@ public:
 	void StartServer();
 	void StopServer();
 	bool IsRunning() const { return bIsRunning; }
+	int32 GetMaxMessageSize() const { return MaxMessageSize; }
+	int32 GetCompressionThreshold() const { return CompressionThreshold; }
+	int32 GetMaxUnsentResponseBytes() const { return MaxUnsentResponseBytes; }
+
+	/** Unique id for a new client connection, across all listeners and transports */
+	int32 AllocateConnectionId() { return NextConnectionId.Increment(); }
 
 	// Command execution
-	FString ExecuteCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params);
+	void ExecuteCommandAsync(FMCPCommandRequest&& Request);
+
+	/**
+	 * Add a command for clients to call, e.g. from another editor module's
+	 * StartupModule. The handler runs on the game thread, or on a worker thread
+	 * if it is flagged ThreadSafe, and returns the result object, or
+	 * FUnrealMCPCommonUtils::CreateErrorResponse on failure.
+	 * Returns false if the name is taken. Game thread only.
+	 */
+	bool RegisterCommand(FName CommandType, FMCPCommandHandler Handler, FName Category = NAME_None, EMCPCommandFlags Flags = EMCPCommandFlags::None);
+	bool UnregisterCommand(FName CommandType);
+
+	/** Queue feeding commands to the game thread */
+	FMCPCommandQueue& GetCommandQueue() { return *CommandQueue; }
+
+	/** Request counts, sizes and latencies, recorded by the connections and the queue */
+	FMCPServerStats& GetServerStats() { return *ServerStats; }
+
+	/** Actors by name in each world, for commands that address an actor by name. Game thread only. */
+	FMCPActorIndex& GetActorIndex() { return *ActorIndex; }
+
+	/**
+	 * Result of the health command: uptime, queue depth, the command running on
+	 * the game thread and how long ago the game thread last ticked. Never waits
+	 * for the game thread. Safe to call from any thread.
+	 */
+	TSharedPtr<FJsonObject> GetHealth() const;
+
+	/** Run a command and build its response envelope. Game thread only. */
+	TSharedPtr<FJsonObject> DispatchCommand(const FString& CommandType, const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context = FMCPCommandContext());
 
 private:
+
+	void RegisterBuiltInCommands();
+
+	TSharedPtr<FJsonObject> HandleCancel(const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context);
+	TSharedPtr<FJsonObject> HandleGetServerStats(const TSharedPtr<FJsonObject>& Params);
+
+	/** Run a thread-safe command on a background worker instead of queueing it for the game thread */
+	void RunOnWorker(FMCPCommandRequest&& Request, TSharedPtr<const FMCPRegisteredCommand> Command);
+
+	/** Block until no command is left running on a worker, which would otherwise outlive the bridge */
+	void WaitForWorkers();
+
+	/** Call a command's handler and build its response envelope, on whatever thread the command may run on */
+	static TSharedPtr<FJsonObject> RunHandler(const FMCPRegisteredCommand& Command, const FString& CommandType, const TSharedPtr<FJsonObject>& Params, const FMCPCommandContext& Context);
+
+	/** Ticker callback appending the server stats to StatsCsvPath */
+	bool WriteStatsCsv(float DeltaTime);
+
+	TSharedPtr<FSocket> CreateTcpListener();
+	TSharedPtr<FSocket> CreateUnixListener();
+
+	/** Start a server thread accepting clients on Listener */
+	bool StartListener(const TSharedPtr<FSocket>& Listener, const TCHAR* ThreadName);
+
 	// Server state
 	bool bIsRunning;
-	TSharedPtr<FSocket> ListenerSocket;
-	TSharedPtr<FSocket> ConnectionSocket;
-	FRunnableThread* ServerThread;
+	double ServerStartTime;
+	TArray<TSharedPtr<FSocket>> ListenerSockets;
+	TArray<FRunnableThread*> ServerThreads;
 
 	// Server configuration
 	FIPv4Address ServerAddress;
 	uint16 Port;
+	bool bEnableTcp;
+	/** AF_UNIX socket path, empty when the unix listener is off. Relative paths are under the project's Saved directory. */
+	FString UnixSocketPath;
+	int32 MaxMessageSize;
+	int32 CompressionThreshold;
+	int32 MaxUnsentResponseBytes;
+
+	FThreadSafeCounter NextConnectionId;
+
+	/** Thread-safe commands running on workers */
+	FThreadSafeCounter WorkerCommandCount;
+
+	TSharedPtr<FMCPCommandQueue> CommandQueue;
+
+	TSharedPtr<FMCPServerStats> ServerStats;
+
+	TSharedPtr<FMCPActorIndex> ActorIndex;
+
+	/** CSV the stats are appended to every StatsCsvIntervalSeconds, empty when off. Relative paths are under the project's Saved directory. */
+	FString StatsCsvPath;
+	FTSTicker::FDelegateHandle StatsCsvTickerHandle;
+
+	/** Commands submitted to run in the background */
+	TSharedPtr<FMCPJobManager> JobManager;
+
+	/** Handlers of the commands run on the game thread */
+	FMCPCommandRegistry CommandRegistry;
 
 	// Command handler instances
 	TSharedPtr<FUnrealMCPEditorCommands> EditorCommands;
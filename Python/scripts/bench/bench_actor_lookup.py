@@ -0,0 +1,96 @@
+#!/usr/bin/env python
+"""
+Measure name-addressed actor commands on a large level.
+
+Spawns --actors empty StaticMeshActors into the open level (in batches, so
+50k actors take a few hundred requests), then times get_actor_properties and
+set_actor_transform on random actors by name. These go through the plugin's
+actor name index and should not slow down as the level grows.
+find_actors_by_name, which still walks every actor, is timed alongside as the
+cost of a full scan on the same level. The spawned actors are deleted again
+unless --keep is given.
+
+Round trips are reported in milliseconds. Run against a build without the
+index, or with a smaller --actors, to compare.
+
+Usage:
+    python bench_actor_lookup.py [--actors 50000] [--count 500] [--keep]
+"""
+
+import argparse
+import random
+
+from bench_common import DEFAULT_HOST, DEFAULT_PORT, connect, send, summarize, timed
+
+# Entries per spawn or delete batch, below the plugin's batch limit
+BATCH_SIZE = 500
+NAME_PREFIX = "MCPBench_"
+
+
+def actor_name(index: int) -> str:
+    return f"{NAME_PREFIX}{index:06d}"
+
+
+def run_batches(connection, entries: list, label: str):
+    for start in range(0, len(entries), BATCH_SIZE):
+        send(connection, "batch", {"commands": entries[start:start + BATCH_SIZE], "stop_on_error": False})
+        print(f"\r{label} {min(start + BATCH_SIZE, len(entries))}/{len(entries)}", end="", flush=True)
+    print()
+
+
+def spawn(connection, count: int):
+    # Spread over a grid so the level isn't one pile of actors
+    side = max(int(count ** 0.5), 1)
+    entries = [{"type": "spawn_actor", "params": {
+        "type": "StaticMeshActor",
+        "name": actor_name(index),
+        "location": [(index % side) * 200.0, (index // side) * 200.0, 0.0],
+    }} for index in range(count)]
+    run_batches(connection, entries, "Spawned")
+
+
+def delete(connection, count: int):
+    entries = [{"type": "delete_actor", "params": {"name": actor_name(index)}} for index in range(count)]
+    run_batches(connection, entries, "Deleted")
+
+
+def report(name: str, timings: list):
+    p50, p99, mean, _ = summarize(timings)
+    print(f"{name:<24}{len(timings):>8}{p50:>10.3f}{p99:>10.3f}{mean:>10.3f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default=DEFAULT_HOST)
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--actors", type=int, default=50000, help="Actors to spawn")
+    parser.add_argument("--count", type=int, default=500, help="Timed requests per command")
+    parser.add_argument("--keep", action="store_true", help="Leave the spawned actors in the level")
+    args = parser.parse_args()
+
+    connection = connect(args.host, args.port)
+    try:
+        spawn(connection, args.actors)
+        names = [actor_name(random.randrange(args.actors)) for _ in range(args.count)]
+
+        results = [
+            ("get_actor_properties", [timed(connection, "get_actor_properties", {"name": name}) for name in names]),
+            ("set_actor_transform", [timed(connection, "set_actor_transform", {"name": name, "location": [0.0, 0.0, 100.0]})
+                                     for name in names]),
+            # A full scan per request, so fewer of them
+            ("find_actors_by_name", [timed(connection, "find_actors_by_name", {"pattern": name})
+                                     for name in names[:max(args.count // 10, 1)]]),
+        ]
+
+        print(f"Round trips on a level with {args.actors} extra actors, milliseconds")
+        print(f"{'':<24}{'count':>8}{'p50':>10}{'p99':>10}{'mean':>10}")
+        for name, timings in results:
+            report(name, timings)
+    finally:
+        if not args.keep:
+            delete(connection, args.actors)
+        connection.disconnect()
+
+
+if __name__ == "__main__":
+    main()
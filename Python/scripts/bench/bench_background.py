@@ -0,0 +1,85 @@
+#!/usr/bin/env python
+"""
+Measure command latency with the editor focused and in the background.
+
+An editor that isn't the foreground window throttles itself to a few frames a
+second, and every command that needs the game thread waits for one of those
+frames. The plugin lifts the throttle while commands are queued
+(LiftBackgroundThrottle in [UnrealMCP]); this shows what that buys.
+
+Each phase sends bursts of small game thread commands (a batch holding one
+ping) with an idle gap between bursts longer than the plugin's restore delay,
+so the first command of every burst meets the throttle as it would after a
+pause. The first command and the rest of each burst are reported separately,
+in milliseconds. The script prompts before each phase so the editor window
+can be focused, or another window brought in front of it. Run once with the
+setting on and once with LiftBackgroundThrottle=False to compare.
+
+Usage:
+    python bench_background.py [--bursts 10] [--burst-size 50] [--idle 3]
+    python bench_background.py --phase background
+"""
+
+import argparse
+import time
+
+from bench_common import DEFAULT_HOST, DEFAULT_PORT, connect, send, summarize, timed
+
+# Runs on the game thread through the queue, but does no editor work itself
+GAME_THREAD_COMMAND = ("batch", {"commands": [{"type": "ping"}]})
+
+
+def run_phase(connection, bursts: int, burst_size: int, idle: float):
+    """Return the first-of-burst and the rest-of-burst timings, in milliseconds."""
+    first, rest = [], []
+    for _ in range(bursts):
+        time.sleep(idle)
+        for index in range(burst_size):
+            (first if index == 0 else rest).append(timed(connection, *GAME_THREAD_COMMAND))
+    return first, rest
+
+
+def report(name: str, timings: list):
+    p50, p99, _, worst = summarize(timings)
+    print(f"{name:<20}{len(timings):>8}{p50:>10.2f}{p99:>10.2f}{worst:>10.2f}")
+
+
+def queue_throttle_stats(connection) -> str:
+    stats = send(connection, "get_queue_stats")
+    return f"throttle lifted {stats.get('background_throttle_lifts', 0)} time(s)"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default=DEFAULT_HOST)
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--bursts", type=int, default=10)
+    parser.add_argument("--burst-size", type=int, default=50, help="Commands sent back to back per burst")
+    parser.add_argument("--idle", type=float, default=3.0, help="Seconds of silence before each burst")
+    parser.add_argument("--phase", choices=["focused", "background"], action="append",
+                        help="Run only the given phase(s), without prompting")
+    args = parser.parse_args()
+
+    phases = args.phase or ["focused", "background"]
+    results = []
+    connection = connect(args.host, args.port)
+    try:
+        for phase in phases:
+            if not args.phase:
+                prompt = "Focus the editor window" if phase == "focused" else "Bring another window in front of the editor"
+                input(f"{prompt}, then press Enter ")
+            first, rest = run_phase(connection, args.bursts, args.burst_size, args.idle)
+            results.append((phase, first, rest))
+        throttle = queue_throttle_stats(connection)
+    finally:
+        connection.disconnect()
+
+    print(f"Game thread command round trips, milliseconds ({throttle})")
+    print(f"{'':<20}{'count':>8}{'p50':>10}{'p99':>10}{'max':>10}")
+    for phase, first, rest in results:
+        report(f"{phase} first", first)
+        report(f"{phase} rest", rest)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,61 @@
+"""
+Connection helpers shared by the benchmarks.
+
+Every bench talks to the editor through the MCP server's own UnrealConnection,
+so it uses exactly the framing, hello negotiation and shared memory handshake
+the real client does. Only the settings the server module reads from its
+globals are set here, one connection at a time.
+"""
+
+import logging
+import os
+import sys
+import time
+
+# The server module lives two directories up
+sys.path.append(os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+import unreal_mcp_server
+from unreal_mcp_server import UnrealConnection
+
+# The server logs every request and response to unreal_mcp.log, which would be part of every timing
+unreal_mcp_server.logger.setLevel(logging.WARNING)
+
+DEFAULT_HOST = "127.0.0.1"
+DEFAULT_PORT = unreal_mcp_server.UNREAL_PORT
+
+
+def connect(host: str = DEFAULT_HOST, port: int = DEFAULT_PORT, socket_path: str = "",
+            shared_memory: bool = False, encoding: str = "json") -> UnrealConnection:
+    """Open a connection over TCP, or the unix socket at socket_path, optionally moved onto shared memory."""
+    unreal_mcp_server.UNREAL_HOST = host
+    unreal_mcp_server.UNREAL_PORT = port
+    unreal_mcp_server.UNREAL_SOCKET_PATH = socket_path
+    unreal_mcp_server.UNREAL_SHARED_MEMORY = shared_memory
+    unreal_mcp_server.UNREAL_ENCODING = encoding
+    unreal_mcp_server.UNREAL_COMPRESSION = "none"
+    connection = UnrealConnection()
+    if not connection.connect():
+        raise ConnectionError(f"Could not connect to Unreal at {socket_path or f'{host}:{port}'}")
+    return connection
+
+
+def send(connection: UnrealConnection, command: str, params: dict = None) -> dict:
+    """Send a command and return its result, raising if it failed."""
+    response = connection.send_command(command, params)
+    if response.get("status") != "success":
+        raise RuntimeError(f"{command} failed: {response.get('error')}")
+    return response.get("result", {})
+
+
+def timed(connection: UnrealConnection, command: str, params: dict = None, scale: float = 1e3) -> float:
+    """Round trip of one command, in milliseconds unless scale says otherwise."""
+    start = time.perf_counter()
+    send(connection, command, params)
+    return (time.perf_counter() - start) * scale
+
+
+def summarize(timings: list) -> tuple:
+    """p50, p99, mean and max of the timings."""
+    timings = sorted(timings)
+    return timings[len(timings) // 2], timings[int(len(timings) * 0.99)], sum(timings) / len(timings), timings[-1]
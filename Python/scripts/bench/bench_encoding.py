@@ -0,0 +1,61 @@
+#!/usr/bin/env python
+"""
+Compare the JSON and MessagePack payload encodings on an actor listing.
+
+Times get_actors_in_level against a running editor once per encoding and
+reports the response size and round trip, so the numbers include the plugin's
+own serialization as well as the client's decoding. Spawn actors first (for
+example with bench_actor_lookup.py --keep) to get a listing worth measuring.
+
+Usage:
+    python bench_encoding.py [--repeat 5]
+"""
+
+import argparse
+import time
+
+from bench_common import DEFAULT_HOST, DEFAULT_PORT, connect, send
+
+
+def best_of(repeat: int, func):
+    """Run func repeat times, return the fastest time in ms and the last result."""
+    best = float("inf")
+    result = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        result = func()
+        best = min(best, time.perf_counter() - start)
+    return best * 1000.0, result
+
+
+def run(host: str, port: int, repeat: int):
+    for encoding in ("json", "msgpack"):
+        connection = connect(host, port, encoding=encoding)
+
+        received = []
+        original_receive = connection.receive_full_response
+
+        def counting_receive(sock):
+            data = original_receive(sock)
+            received.append(len(data))
+            return data
+
+        connection.receive_full_response = counting_receive
+        round_trip_ms, result = best_of(repeat, lambda: send(connection, "get_actors_in_level", {"page_size": 5000}))
+        actors = len(result.get("actors", []))
+        print(f"{connection.encoding:<10}{actors:>8} actors{received[-1]:>12} bytes{round_trip_ms:>12.2f} ms round trip")
+        connection.disconnect()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default=DEFAULT_HOST)
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--repeat", type=int, default=5, help="Runs per measurement, the best is reported")
+    args = parser.parse_args()
+
+    run(args.host, args.port, args.repeat)
+
+
+if __name__ == "__main__":
+    main()
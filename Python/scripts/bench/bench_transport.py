@@ -0,0 +1,123 @@
+#!/usr/bin/env python
+"""
+Compare request latency over TCP loopback, the unix domain socket and the
+shared memory rings.
+
+With --socket pointing at the editor's UnixSocketPath, this sends small ping
+requests one at a time over both transports and reports round trip
+percentiles. The editor needs both listeners on (EnableTcp=True and
+UnixSocketPath set in [UnrealMCP]). --shm adds a row for a shared memory
+connection opened through TCP.
+
+With --echo it instead measures the transports alone against a local echo
+server speaking the same framing, which shows what the OS saves before any
+editor work is added.
+
+Round trips go through the MCP server's UnrealConnection, so they include the
+client's own request handling, as a tool call would.
+
+Usage:
+    python bench_transport.py [--socket /path/to/Saved/UnrealMCP.sock] [--shm] [--count 2000]
+    python bench_transport.py --echo [--count 20000]
+"""
+
+import argparse
+import json
+import os
+import socket
+import tempfile
+import threading
+
+from bench_common import DEFAULT_HOST, DEFAULT_PORT, connect, summarize, timed
+from unreal_mcp_server import FRAME_HEADER, FRAME_LENGTH_MASK, FRAME_MAGIC
+
+
+def recv_exact(sock: socket.socket, size: int) -> bytes:
+    data = bytearray()
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError("Connection closed")
+        data += chunk
+    return bytes(data)
+
+
+def round_trips(connection, count: int) -> list:
+    """Send count pings one after another, return each round trip in microseconds."""
+    try:
+        return [timed(connection, "ping", scale=1e6) for _ in range(count)]
+    finally:
+        connection.disconnect()
+
+
+def report(name: str, timings: list):
+    p50, p99, mean, _ = summarize(timings)
+    print(f"{name:<8}{p50:>10.1f}{p99:>10.1f}{mean:>10.1f}")
+
+
+def echo_server(listener: socket.socket):
+    """Answer every frame with a tiny response carrying the request's id, like ping in the plugin."""
+    client, _ = listener.accept()
+    if isinstance(client.getsockname(), tuple):
+        client.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    try:
+        recv_exact(client, len(FRAME_MAGIC))
+        while True:
+            (header,) = FRAME_HEADER.unpack(recv_exact(client, FRAME_HEADER.size))
+            request = json.loads(recv_exact(client, header & FRAME_LENGTH_MASK))
+            response = json.dumps({"id": request.get("id"), "status": "success", "result": {"message": "pong"}}).encode("utf-8")
+            client.sendall(FRAME_HEADER.pack(len(response)) + response)
+    except ConnectionError:
+        pass
+    finally:
+        client.close()
+
+
+def run_echo(count: int):
+    tcp_listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    tcp_listener.bind(("127.0.0.1", 0))
+    tcp_listener.listen(1)
+
+    path = os.path.join(tempfile.mkdtemp(), "bench.sock")
+    unix_listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    unix_listener.bind(path)
+    unix_listener.listen(1)
+
+    for listener in (tcp_listener, unix_listener):
+        threading.Thread(target=echo_server, args=(listener,), daemon=True).start()
+
+    print(f"{count} round trips to a local echo server, microseconds")
+    print(f"{'':<8}{'p50':>10}{'p99':>10}{'mean':>10}")
+    report("tcp", round_trips(connect(*tcp_listener.getsockname()), count))
+    report("unix", round_trips(connect(socket_path=path), count))
+    os.unlink(path)
+
+
+def run_live(host: str, port: int, path: str, count: int, shared_memory: bool):
+    print(f"{count} ping round trips to the editor, microseconds")
+    print(f"{'':<8}{'p50':>10}{'p99':>10}{'mean':>10}")
+    report("tcp", round_trips(connect(host, port), count))
+    if path:
+        report("unix", round_trips(connect(socket_path=path), count))
+    if shared_memory:
+        report("shm", round_trips(connect(host, port, shared_memory=True), count))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default=DEFAULT_HOST)
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--socket", default=os.environ.get("MCP_UE_SOCKET", ""), help="Editor unix socket path")
+    parser.add_argument("--count", type=int, default=2000, help="Round trips per transport")
+    parser.add_argument("--shm", action="store_true", help="Also measure a shared memory connection")
+    parser.add_argument("--echo", action="store_true", help="Measure the transports against a local echo server")
+    args = parser.parse_args()
+
+    if args.echo:
+        run_echo(args.count)
+    else:
+        run_live(args.host, args.port, args.socket, args.count, args.shm)
+
+
+if __name__ == "__main__":
+    main()
@@ -5,51 +5,116 @@ This module provides tools for controlling the Unreal Editor viewport and other
 """
 
 import logging
-from typing import Dict, List, Any, Optional
+from typing import Dict, List, Any, Optional, Union
 from mcp.server.fastmcp import FastMCP, Context
 
 # Get logger
 logger = logging.getLogger("UnrealMCP")
 
+# Largest page the plugin sends, used when collecting every actor
+MAX_ACTOR_PAGE_SIZE = 5000
+
+def _get_all_actors(unreal) -> List[Dict[str, Any]]:
+    """Every actor in the level as one list, the shape get_actors_in_level had before it was paged."""
+    actors = []
+    params = {"page_size": MAX_ACTOR_PAGE_SIZE}
+    while True:
+        response = unreal.send_command("get_actors_in_level", params)
+        result = (response or {}).get("result", response or {})
+        if "actors" not in result:
+            logger.warning(f"Unexpected response format: {response}")
+            return actors
+        actors.extend(result["actors"])
+        if "next_cursor" not in result:
+            logger.info(f"Found {len(actors)} actors in level")
+            return actors
+        params["cursor"] = result["next_cursor"]
+
 def register_editor_tools(mcp: FastMCP):
     """Register editor tools with the MCP server."""
     
     @mcp.tool()
-    def get_actors_in_level(ctx: Context) -> List[Dict[str, Any]]:
-        """Get a list of all actors in the current level."""
+    def get_actors_in_level(
+        ctx: Context,
+        class_name: Optional[str] = None,
+        tag: Optional[str] = None,
+        folder: Optional[str] = None,
+        level: Optional[str] = None,
+        bounds_min: Optional[List[float]] = None,
+        bounds_max: Optional[List[float]] = None,
+        fields: Optional[List[str]] = None,
+        page_size: Optional[int] = None,
+        cursor: Optional[str] = None
+    ) -> Union[List[Dict[str, Any]], Dict[str, Any]]:
+        """
+        List the actors in the current level, one page at a time.
+
+        Called without any arguments it returns a plain list of every actor, as
+        it did before filters and pages existed, reading all the pages itself.
+
+        Args:
+            class_name: Only actors of this class or a subclass of it
+            tag: Only actors with this tag
+            folder: Only actors in this outliner folder or its subfolders
+            level: Only actors in this level, by package path or map name
+            bounds_min: With bounds_max, only actors located inside this box
+            bounds_max: Other corner of the box
+            fields: Only these fields of each actor, from name, class, location,
+                    rotation, scale, label, folder, level and tags
+            page_size: Actors per page, up to 5000 (default 500)
+            cursor: next_cursor of the previous page, to get the page after it
+
+        Returns:
+            Dict with "actors", "count", "total" (matching actors on all pages)
+            and "next_cursor" when there are more pages; without arguments, the
+            list of all actors
+        """
         from unreal_mcp_server import get_unreal_connection
-        
+
         try:
             unreal = get_unreal_connection()
             if not unreal:
                 logger.warning("Failed to connect to Unreal Engine")
-                return []
-                
-            response = unreal.send_command("get_actors_in_level", {})
-            
+                return {"success": False, "message": "Failed to connect to Unreal Engine"}
+
+            params = {}
+            if class_name:
+                params["class"] = class_name
+            if tag:
+                params["tag"] = tag
+            if folder:
+                params["folder"] = folder
+            if level:
+                params["level"] = level
+            if bounds_min is not None and bounds_max is not None:
+                params["bounds"] = {"min": bounds_min, "max": bounds_max}
+            if fields:
+                params["fields"] = fields
+            if page_size:
+                params["page_size"] = page_size
+            if cursor:
+                params["cursor"] = cursor
+
+            if not params:
+                return _get_all_actors(unreal)
+
+            response = unreal.send_command("get_actors_in_level", params)
+
             if not response:
                 logger.warning("No response from Unreal Engine")
-                return []
-                
-            # Log the complete response for debugging
-            logger.info(f"Complete response from Unreal: {response}")
-            
-            # Check response format
-            if "result" in response and "actors" in response["result"]:
-                actors = response["result"]["actors"]
-                logger.info(f"Found {len(actors)} actors in level")
-                return actors
-            elif "actors" in response:
-                actors = response["actors"]
-                logger.info(f"Found {len(actors)} actors in level")
-                return actors
-                
-            logger.warning(f"Unexpected response format: {response}")
-            return []
-            
+                return {"success": False, "message": "No response from Unreal Engine"}
+
+            result = response.get("result", response)
+            if "actors" not in result:
+                logger.warning(f"Unexpected response format: {response}")
+                return {"success": False, "message": response.get("error", "Unexpected response format")}
+
+            logger.info(f"Got {len(result['actors'])} of {result.get('total', len(result['actors']))} actors in level")
+            return result
+
         except Exception as e:
             logger.error(f"Error getting actors: {e}")
-            return []
+            return {"success": False, "message": str(e)}
 
     @mcp.tool()
     def find_actors_by_name(ctx: Context, pattern: str) -> List[str]:
@@ -75,6 +140,124 @@ def register_editor_tools(mcp: FastMCP):
             logger.error(f"Error finding actors: {e}")
             return []
     
+    def query_actors(command: str, params: Dict[str, Any], class_name: Optional[str], test: str,
+                     limit: Optional[int]) -> Dict[str, Any]:
+        """Send a region query with the filters shared by the query_actors_in_* tools."""
+        from unreal_mcp_server import get_unreal_connection
+
+        try:
+            unreal = get_unreal_connection()
+            if not unreal:
+                logger.error("Failed to connect to Unreal Engine")
+                return {"success": False, "message": "Failed to connect to Unreal Engine"}
+
+            params["test"] = test
+            if class_name:
+                params["class"] = class_name
+            if limit:
+                params["limit"] = limit
+
+            response = unreal.send_command(command, params)
+            if not response:
+                logger.error("No response from Unreal Engine")
+                return {"success": False, "message": "No response from Unreal Engine"}
+
+            return response.get("result", response)
+
+        except Exception as e:
+            logger.error(f"Error in {command}: {e}")
+            return {"success": False, "message": str(e)}
+
+    @mcp.tool()
+    def query_actors_in_sphere(
+        ctx: Context,
+        center: List[float],
+        radius: float,
+        class_name: Optional[str] = None,
+        test: str = "bounds",
+        limit: Optional[int] = None
+    ) -> Dict[str, Any]:
+        """
+        Find the actors within a distance of a point, nearest first.
+
+        Args:
+            center: [x, y, z] of the sphere's center
+            radius: Sphere radius in centimeters (1000 for 10 m)
+            class_name: Only actors of this class or a subclass of it
+            test: "bounds" for actors any part of which is in the sphere,
+                  "location" for actors whose location is
+            limit: Most actors to return (default 500, at most 5000)
+
+        Returns:
+            Dict with "actors", "count", "total" and "truncated"
+        """
+        return query_actors("query_actors_in_sphere", {"center": center, "radius": radius}, class_name, test, limit)
+
+    @mcp.tool()
+    def query_actors_in_box(
+        ctx: Context,
+        min: List[float],
+        max: List[float],
+        class_name: Optional[str] = None,
+        test: str = "bounds",
+        limit: Optional[int] = None
+    ) -> Dict[str, Any]:
+        """
+        Find the actors inside an axis-aligned box, nearest its center first.
+
+        Args:
+            min: [x, y, z] of one corner
+            max: [x, y, z] of the opposite corner
+            class_name: Only actors of this class or a subclass of it
+            test: "bounds" for actors any part of which is in the box,
+                  "location" for actors whose location is
+            limit: Most actors to return (default 500, at most 5000)
+
+        Returns:
+            Dict with "actors", "count", "total" and "truncated"
+        """
+        return query_actors("query_actors_in_box", {"min": min, "max": max}, class_name, test, limit)
+
+    @mcp.tool()
+    def query_actors_in_frustum(
+        ctx: Context,
+        origin: Optional[List[float]] = None,
+        rotation: Optional[List[float]] = None,
+        fov: Optional[float] = None,
+        aspect_ratio: Optional[float] = None,
+        near: Optional[float] = None,
+        far: Optional[float] = None,
+        class_name: Optional[str] = None,
+        test: str = "bounds",
+        limit: Optional[int] = None
+    ) -> Dict[str, Any]:
+        """
+        Find the actors a camera can see, nearest the camera first.
+
+        Without origin the active level viewport's camera is used.
+
+        Args:
+            origin: [x, y, z] of the camera
+            rotation: [pitch, yaw, roll] of the camera
+            fov: Horizontal field of view in degrees (default 90, or the viewport's)
+            aspect_ratio: Width over height (default 16:9, or the viewport's)
+            near: Near clip distance in centimeters (default 0)
+            far: Far clip distance in centimeters (default 100000)
+            class_name: Only actors of this class or a subclass of it
+            test: "bounds" for actors any part of which is in view,
+                  "location" for actors whose location is
+            limit: Most actors to return (default 500, at most 5000)
+
+        Returns:
+            Dict with "actors", "count", "total" and "truncated"
+        """
+        params = {}
+        for key, value in (("origin", origin), ("rotation", rotation), ("fov", fov),
+                           ("aspect_ratio", aspect_ratio), ("near", near), ("far", far)):
+            if value is not None:
+                params[key] = value
+        return query_actors("query_actors_in_frustum", params, class_name, test, limit)
+
     @mcp.tool()
     def spawn_actor(
         ctx: Context,
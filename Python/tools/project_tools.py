@@ -261,4 +261,31 @@ def register_project_tools(mcp: FastMCP):
         except Exception as e:
             return {"success": False, "message": str(e)}
 
+    @mcp.tool()
+    def asset_exists(
+        ctx: Context,
+        path: str
+    ) -> Dict[str, Any]:
+        """
+        Check whether an asset exists, without waiting for the editor to be idle.
+
+        Args:
+            path: Package path (/Game/Input/IA_Jump) or object path (/Game/Input/IA_Jump.IA_Jump)
+
+        Returns:
+            Dict with "exists", and the asset's "name" and "class" when it does
+        """
+        from unreal_mcp_server import get_unreal_connection
+
+        try:
+            unreal = get_unreal_connection()
+            if not unreal:
+                return {"success": False, "message": "Failed to connect to Unreal Engine"}
+
+            response = unreal.send_command("asset_exists", {"path": path})
+            return response if response else {"success": False, "message": "No response"}
+
+        except Exception as e:
+            return {"success": False, "message": str(e)}
+
     logger.info("Project tools registered successfully") 
\ No newline at end of file
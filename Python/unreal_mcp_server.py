@@ -4,15 +4,25 @@ Unreal Engine MCP Server
 A simple MCP server for interacting with Unreal Engine.
 """
 
+import itertools
 import logging
 import socket
+import struct
 import sys
 import json
 import os
+import threading
+import time
+import zlib
 from contextlib import asynccontextmanager
-from typing import AsyncIterator, Dict, Any, Optional
+from typing import AsyncIterator, Dict, Any, List, Optional, Tuple
 from mcp.server.fastmcp import FastMCP
 
+try:
+    import msgpack
+except ImportError:  # Optional, JSON is used when it isn't installed
+    msgpack = None
+
 # Configure logging with more detailed format
 logging.basicConfig(
     level=logging.DEBUG,  # Change to DEBUG level for more details
@@ -28,40 +38,103 @@ logger = logging.getLogger("UnrealMCP")
 UNREAL_HOST = "127.0.0.1"
 UNREAL_PORT = int(os.environ.get('MCP_UE_PORT', '55557'))
 
+# Path of the editor's unix socket (UnixSocketPath in [UnrealMCP]). When set,
+# the connection goes through it instead of TCP.
+UNREAL_SOCKET_PATH = os.environ.get('MCP_UE_SOCKET', '')
+
+# Set to 1 to move requests and responses onto shared memory rings after
+# connecting (Linux only, see unreal_mcp_shm.py). The socket stays open to keep
+# the shared memory connection alive.
+UNREAL_SHARED_MEMORY = os.environ.get('MCP_UE_SHARED_MEMORY', '0') == '1'
+
+# Framed wire protocol (see MCPProtocol.h in the plugin): the client opens the
+# connection with FRAME_MAGIC, then every message is a 4-byte big-endian length
+# followed by the UTF-8 JSON payload.
+FRAME_MAGIC = b'UMCP'
+FRAME_HEADER = struct.Struct('>I')
+FRAME_LENGTH_MASK = 0x3FFFFFFF
+
+# Preferred payload encoding, negotiated with the hello command after connecting.
+# "msgpack" needs the msgpack package and falls back to "json" when it's missing
+# or Unreal doesn't offer it.
+UNREAL_ENCODING = os.environ.get('MCP_UE_ENCODING', 'msgpack')
+
+# Set to "zlib" to have Unreal compress large responses, useful over slow or
+# forwarded links. Compressed frames carry FRAME_FLAG_COMPRESSED and start
+# with the 4-byte big-endian uncompressed size.
+UNREAL_COMPRESSION = os.environ.get('MCP_UE_COMPRESSION', 'none')
+FRAME_FLAG_COMPRESSED = 0x80000000
+
+# Optional deadline sent with every request, in milliseconds. Requests still
+# waiting for the game thread after it are dropped by Unreal. 0 sends none.
+UNREAL_DEADLINE_MS = int(os.environ.get('MCP_UE_DEADLINE_MS', '0'))
+
+# How many times a command refused with a busy response is sent again, waiting
+# the retry_after_ms Unreal suggests in between
+UNREAL_BUSY_RETRIES = 5
+
+# MessagePack extension used by Unreal for arrays of float64 (vectors, rotators...)
+MSGPACK_PACKED_FLOAT64 = 1
+
+def _msgpack_ext_hook(code: int, data: bytes):
+    """Unpack the extension types Unreal sends."""
+    if code == MSGPACK_PACKED_FLOAT64:
+        return list(struct.unpack(f'<{len(data) // 8}d', data))
+    return msgpack.ExtType(code, data)
+
 class UnrealConnection:
-    """Connection to an Unreal Engine instance."""
+    """Persistent connection to an Unreal Engine instance.
+
+    The socket stays open across commands. Every request carries an "id" that
+    Unreal echoes in its response, so several requests can be in flight at once
+    and their responses matched up in whatever order they complete.
+    """
     
     def __init__(self):
         """Initialize the connection."""
         self.socket = None
         self.connected = False
+        self.encoding = "json"
+        # Socket that opened the shared memory connection, None when not using one
+        self._control_socket = None
+        self._lock = threading.Lock()
+        self._request_ids = itertools.count(1)
+        # Responses that arrived while waiting for a different request id
+        self._unclaimed_responses: Dict[Any, Dict[str, Any]] = {}
     
     def connect(self) -> bool:
         """Connect to the Unreal Engine instance."""
         try:
             # Close any existing socket
-            if self.socket:
-                try:
-                    self.socket.close()
-                except:
-                    pass
-                self.socket = None
+            self.disconnect()
+            self._unclaimed_responses.clear()
             
-            logger.info(f"Connecting to Unreal at {UNREAL_HOST}:{UNREAL_PORT}...")
-            self.socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-            self.socket.settimeout(5)  # 5 second timeout
-            
-            # Set socket options for better stability
-            self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
-            self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
-            
-            # Set larger buffer sizes
-            self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 65536)
-            self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, 65536)
-            
-            self.socket.connect((UNREAL_HOST, UNREAL_PORT))
+            if UNREAL_SOCKET_PATH:
+                logger.info(f"Connecting to Unreal at {UNREAL_SOCKET_PATH}...")
+                self.socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+                self.socket.settimeout(5)  # 5 second timeout
+                self.socket.connect(UNREAL_SOCKET_PATH)
+            else:
+                logger.info(f"Connecting to Unreal at {UNREAL_HOST}:{UNREAL_PORT}...")
+                self.socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                self.socket.settimeout(5)  # 5 second timeout
+                
+                # Set socket options for better stability
+                self.socket.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
+                
+                # Set larger buffer sizes
+                self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 65536)
+                self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, 65536)
+                
+                self.socket.connect((UNREAL_HOST, UNREAL_PORT))
+            self.socket.sendall(FRAME_MAGIC)
+            self.encoding = "json"
+            if UNREAL_SHARED_MEMORY:
+                self._open_shared_memory()
+            self._negotiate_encoding()
             self.connected = True
-            logger.info("Connected to Unreal Engine")
+            logger.info(f"Connected to Unreal Engine ({self.encoding} encoding)")
             return True
             
         except Exception as e:
@@ -71,135 +144,228 @@ class UnrealConnection:
     
     def disconnect(self):
         """Disconnect from the Unreal Engine instance."""
-        if self.socket:
-            try:
-                self.socket.close()
-            except:
-                pass
+        for sock in (self.socket, self._control_socket):
+            if sock:
+                try:
+                    sock.close()
+                except:
+                    pass
         self.socket = None
+        self._control_socket = None
         self.connected = False
 
-    def receive_full_response(self, sock, buffer_size=4096) -> bytes:
-        """Receive a complete response from Unreal, handling chunked data."""
-        chunks = []
+    def _open_shared_memory(self):
+        """Switch requests and responses over to a shared memory connection."""
+        from unreal_mcp_shm import SharedMemoryStream
+
+        request_id = next(self._request_ids)
+        self.send_frame(self._encode({"id": request_id, "type": "open_shared_memory", "params": {}}))
+        response = self._wait_for_response(request_id)
+        if response.get("status") != "success":
+            logger.warning(f"Shared memory unavailable, staying on the socket: {response.get('error')}")
+            return
+
+        name = response["result"]["name"]
+        self._control_socket = self.socket
+        self.socket = SharedMemoryStream(name)
+        self.socket.sendall(FRAME_MAGIC)
+        logger.info(f"Using shared memory connection {name}")
+
+    def _negotiate_encoding(self):
+        """Ask Unreal to switch to the preferred payload encoding and compression."""
+        params = {}
+        if UNREAL_ENCODING == "msgpack" and msgpack is not None:
+            params["encodings"] = ["msgpack", "json"]
+        if UNREAL_COMPRESSION == "zlib":
+            params["compression"] = ["zlib"]
+        if not params:
+            return
+        request_id = next(self._request_ids)
+        self.send_frame(self._encode({
+            "id": request_id,
+            "type": "hello",
+            "params": params
+        }))
+        response = self._wait_for_response(request_id)
+        # Older plugins answer with an unknown command error and stay on JSON
+        if response.get("status") == "success":
+            result = response.get("result", {})
+            self.encoding = result.get("encoding", "json")
+            logger.info(f"Unreal response compression: {result.get('compression', 'none')}")
+
+    def _encode(self, message: Dict[str, Any]) -> bytes:
+        """Encode a request in the connection's payload encoding."""
+        if self.encoding == "msgpack":
+            return msgpack.packb(message, use_bin_type=True)
+        return json.dumps(message).encode('utf-8')
+
+    def _decode(self, payload: bytes) -> Dict[str, Any]:
+        """Decode a response in the connection's payload encoding."""
+        if self.encoding == "msgpack":
+            return msgpack.unpackb(payload, raw=False, ext_hook=_msgpack_ext_hook, strict_map_key=False)
+        return json.loads(payload.decode('utf-8'))
+
+    def _recv_exact(self, sock, size: int) -> bytes:
+        """Read exactly size bytes from the socket."""
+        buffer = bytearray(size)
+        view = memoryview(buffer)
+        received = 0
+        while received < size:
+            count = sock.recv_into(view[received:], size - received)
+            if count == 0:
+                raise Exception("Connection closed before receiving data")
+            received += count
+        return bytes(buffer)
+
+    def receive_full_response(self, sock) -> bytes:
+        """Receive one length-prefixed response frame from Unreal."""
         sock.settimeout(5)  # 5 second timeout
         try:
-            while True:
-                chunk = sock.recv(buffer_size)
-                if not chunk:
-                    if not chunks:
-                        raise Exception("Connection closed before receiving data")
-                    break
-                chunks.append(chunk)
-                
-                # Process the data received so far
-                data = b''.join(chunks)
-                decoded_data = data.decode('utf-8')
-                
-                # Try to parse as JSON to check if complete
-                try:
-                    json.loads(decoded_data)
-                    logger.info(f"Received complete response ({len(data)} bytes)")
-                    return data
-                except json.JSONDecodeError:
-                    # Not complete JSON yet, continue reading
-                    logger.debug(f"Received partial response, waiting for more data...")
-                    continue
-                except Exception as e:
-                    logger.warning(f"Error processing response chunk: {str(e)}")
-                    continue
+            (header,) = FRAME_HEADER.unpack(self._recv_exact(sock, FRAME_HEADER.size))
+            data = self._recv_exact(sock, header & FRAME_LENGTH_MASK)
+            if header & FRAME_FLAG_COMPRESSED:
+                (size,) = FRAME_HEADER.unpack_from(data)
+                data = zlib.decompress(data[FRAME_HEADER.size:], bufsize=size)
+            logger.info(f"Received complete response ({len(data)} bytes)")
+            return data
         except socket.timeout:
             logger.warning("Socket timeout during receive")
-            if chunks:
-                # If we have some data already, try to use it
-                data = b''.join(chunks)
-                try:
-                    json.loads(data.decode('utf-8'))
-                    logger.info(f"Using partial response after timeout ({len(data)} bytes)")
-                    return data
-                except:
-                    pass
             raise Exception("Timeout receiving Unreal response")
         except Exception as e:
             logger.error(f"Error during receive: {str(e)}")
             raise
-    
-    def send_command(self, command: str, params: Dict[str, Any] = None) -> Optional[Dict[str, Any]]:
-        """Send a command to Unreal Engine and get the response."""
-        # Always reconnect for each command, since Unreal closes the connection after each command
-        # This is different from Unity which keeps connections alive
-        if self.socket:
-            try:
-                self.socket.close()
-            except:
-                pass
-            self.socket = None
-            self.connected = False
-        
-        if not self.connect():
-            logger.error("Failed to connect to Unreal Engine for command")
-            return None
+
+    def send_frame(self, payload: bytes):
+        """Send one length-prefixed frame to Unreal."""
+        self.socket.sendall(FRAME_HEADER.pack(len(payload)) + payload)
+
+    def _wait_for_response(self, request_id: int) -> Dict[str, Any]:
+        """Read responses until the one for request_id shows up, keeping the others.
+
+        Progress frames only show that Unreal is still working on a request. Each
+        one restarts the receive timeout, so a long save or compile isn't given up on.
+        """
+        while request_id not in self._unclaimed_responses:
+            response = self._decode(self.receive_full_response(self.socket))
+            if response.get("status") == "progress":
+                logger.info(f"Progress for request {response.get('id')}: {response.get('progress')}")
+                continue
+            self._unclaimed_responses[response.get("id")] = response
+        return self._unclaimed_responses.pop(request_id)
+
+    def _normalize_response(self, response: Dict[str, Any]) -> Dict[str, Any]:
+        """Bring both error formats into the shape expected by the tools."""
+        # Log complete response for debugging
+        logger.info(f"Complete response from Unreal: {response}")
         
-        try:
-            # Match Unity's command format exactly
-            command_obj = {
-                "type": command,  # Use "type" instead of "command"
-                "params": params or {}  # Use Unity's params or {} pattern
+        # Check for both error formats: {"status": "error", ...} and {"success": false, ...}
+        if response.get("status") == "error":
+            error_message = response.get("error") or response.get("message", "Unknown Unreal error")
+            logger.error(f"Unreal error (status=error): {error_message}")
+            # We want to preserve the original error structure but ensure error is accessible
+            if "error" not in response:
+                response["error"] = error_message
+        elif response.get("success") is False:
+            # This format uses {"success": false, "error": "message"} or {"success": false, "message": "message"}
+            error_message = response.get("error") or response.get("message", "Unknown Unreal error")
+            logger.error(f"Unreal error (success=false): {error_message}")
+            # Convert to the standard format expected by higher layers
+            response = {
+                "status": "error",
+                "error": error_message
             }
+        return response
+
+    def send_commands(self, commands: List[Tuple[str, Optional[Dict[str, Any]]]]) -> List[Dict[str, Any]]:
+        """Send several commands back to back and collect their responses.
+
+        All requests are written before any response is read, so the batch costs
+        one round trip instead of one per command. Responses are returned in the
+        same order as the commands. Commands Unreal refuses because its queue is
+        full are sent again after the wait it suggests.
+        """
+        with self._lock:
+            if not self.connected and not self.connect():
+                logger.error("Failed to connect to Unreal Engine for command")
+                return [{"status": "error", "error": "Failed to connect to Unreal Engine"} for _ in commands]
             
-            # Send without newline, exactly like Unity
-            command_json = json.dumps(command_obj)
-            logger.info(f"Sending command: {command_json}")
-            self.socket.sendall(command_json.encode('utf-8'))
-            
-            # Read response using improved handler
-            response_data = self.receive_full_response(self.socket)
-            response = json.loads(response_data.decode('utf-8'))
-            
-            # Log complete response for debugging
-            logger.info(f"Complete response from Unreal: {response}")
-            
-            # Check for both error formats: {"status": "error", ...} and {"success": false, ...}
-            if response.get("status") == "error":
-                error_message = response.get("error") or response.get("message", "Unknown Unreal error")
-                logger.error(f"Unreal error (status=error): {error_message}")
-                # We want to preserve the original error structure but ensure error is accessible
-                if "error" not in response:
-                    response["error"] = error_message
-            elif response.get("success") is False:
-                # This format uses {"success": false, "error": "message"} or {"success": false, "message": "message"}
-                error_message = response.get("error") or response.get("message", "Unknown Unreal error")
-                logger.error(f"Unreal error (success=false): {error_message}")
-                # Convert to the standard format expected by higher layers
-                response = {
-                    "status": "error",
-                    "error": error_message
-                }
-            
-            # Always close the connection after command is complete
-            # since Unreal will close it on its side anyway
-            try:
-                self.socket.close()
-            except:
-                pass
-            self.socket = None
-            self.connected = False
-            
-            return response
-            
-        except Exception as e:
-            logger.error(f"Error sending command: {e}")
-            # Always reset connection state on any error
-            self.connected = False
             try:
-                self.socket.close()
-            except:
-                pass
-            self.socket = None
-            return {
-                "status": "error",
-                "error": str(e)
-            }
+                responses: List[Optional[Dict[str, Any]]] = [None] * len(commands)
+                pending = list(range(len(commands)))
+                for attempt in range(UNREAL_BUSY_RETRIES + 1):
+                    request_ids = []
+                    for index in pending:
+                        command, params = commands[index]
+                        request_id = next(self._request_ids)
+                        request = {
+                            "id": request_id,
+                            "type": command,
+                            "params": params or {},
+                            "progress": True
+                        }
+                        if UNREAL_DEADLINE_MS > 0:
+                            request["deadline_ms"] = UNREAL_DEADLINE_MS
+                        logger.info(f"Sending command: {request}")
+                        self.send_frame(self._encode(request))
+                        request_ids.append(request_id)
+
+                    busy = []
+                    retry_after_ms = 0
+                    for index, request_id in zip(pending, request_ids):
+                        response = self._wait_for_response(request_id)
+                        responses[index] = response
+                        if response.get("busy"):
+                            busy.append(index)
+                            retry_after_ms = max(retry_after_ms, response.get("retry_after_ms", 0))
+
+                    if not busy or attempt == UNREAL_BUSY_RETRIES:
+                        break
+                    logger.warning(f"Unreal is busy, retrying {len(busy)} command(s) in {retry_after_ms} ms")
+                    time.sleep(retry_after_ms / 1000.0)
+                    pending = busy
+
+                return [self._normalize_response(response) for response in responses]
+                
+            except Exception as e:
+                logger.error(f"Error sending command: {e}")
+                # The stream may be out of sync now, start over on the next command
+                self.disconnect()
+                return [{"status": "error", "error": str(e)} for _ in commands]
+    
+    def send_command(self, command: str, params: Dict[str, Any] = None) -> Optional[Dict[str, Any]]:
+        """Send a command to Unreal Engine and get the response."""
+        return self.send_commands([(command, params)])[0]
+
+    def run_batch(self, commands: List[Dict[str, Any]], stop_on_error: bool = True, transaction: bool = False) -> Dict[str, Any]:
+        """Run several commands in one game thread task on the Unreal side.
+
+        Each entry is {"type", "params"} with an optional "id". Parameters can use
+        an earlier entry's result with {"$ref": "<id or index>.<field>"}. With
+        transaction set the batch is one undo step, and each blueprint it touches
+        is compiled and saved once at the end instead of after every command.
+        """
+        return self.send_command("batch", {"commands": commands, "stop_on_error": stop_on_error, "transaction": transaction})
+
+    def submit_job(self, command: str, params: Dict[str, Any] = None) -> Optional[int]:
+        """Run a command as a job on the Unreal side and return its job id."""
+        response = self.send_command("submit", {"type": command, "params": params or {}})
+        if response.get("status") == "error":
+            logger.error(f"Failed to submit {command}: {response.get('error')}")
+            return None
+        return response.get("result", {}).get("job_id")
+
+    def get_job_result(self, job_id: int, wait: bool = False) -> Dict[str, Any]:
+        """Fetch a job's state, and its command's response once it has finished."""
+        return self.send_command("job_result", {"job_id": job_id, "wait": wait})
+
+    def health(self) -> Dict[str, Any]:
+        """Uptime, queue depth, the running command and the game thread heartbeat age.
+
+        Answered by the plugin's network thread, so it responds even while the
+        game thread is stuck in a long compile. A growing game_thread_heartbeat_ms
+        means the editor is busy or hung, not that the connection is dead.
+        """
+        return self.send_command("health")
 
 # Global connection state
 _unreal_connection: UnrealConnection = None
@@ -216,8 +382,11 @@ def get_unreal_connection() -> Optional[UnrealConnection]:
         else:
             # Verify connection is still valid with a ping-like test
             try:
-                # Simple test by sending an empty buffer to check if socket is still connected
-                _unreal_connection.socket.sendall(b'\x00')
+                if not _unreal_connection.connected:
+                    raise Exception("not connected")
+                # An empty frame is ignored by Unreal, so it's a cheap way to check the socket
+                with _unreal_connection._lock:
+                    _unreal_connection.send_frame(b'')
                 logger.debug("Connection verified with ping test")
             except Exception as e:
                 logger.warning(f"Existing connection failed: {e}")
@@ -306,8 +475,9 @@ def info():
     - `take_screenshot(filename, show_ui, resolution)` - Capture screenshots
 
     ### Actor Management
-    - `get_actors_in_level()` - List all actors in current level
+    - `get_actors_in_level()` - List actors in current level, filtered and paged
     - `find_actors_by_name(pattern)` - Find actors by name pattern
+    - `query_actors_in_sphere(center, radius)`, `query_actors_in_box(min, max)`, `query_actors_in_frustum(origin, rotation)` - Find actors in a region
     - `spawn_actor(name, type, location=[0,0,0], rotation=[0,0,0], scale=[1,1,1])` - Create actors
     - `delete_actor(name)` - Remove actors
     - `set_actor_transform(name, location, rotation, scale)` - Modify actor transform
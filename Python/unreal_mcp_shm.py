@@ -0,0 +1,179 @@
+"""
+Client end of the plugin's shared memory transport (Linux only).
+
+After the open_shared_memory command returns a shm name, SharedMemoryStream
+maps it and offers the small part of the socket API UnrealConnection uses
+(sendall, recv_into, settimeout, close). The layout is documented in
+MCPSharedMemorySocket.h in the plugin; this side writes the request ring and
+reads the response ring.
+"""
+
+import ctypes
+import mmap
+import os
+import platform
+import time
+from typing import Optional
+
+CONTROL_SIZE = 256
+RING_HEADER_SIZE = 256
+DATA_OFFSET = 4096
+MAGIC = b'UMSM'
+VERSION = 1
+
+# Offsets inside a ring header
+HEAD, TAIL, DATA_DOORBELL, READER_ASLEEP, SPACE_DOORBELL, WRITER_ASLEEP = 0, 64, 128, 132, 192, 196
+
+# Offsets inside the control block
+RING_SIZE_FIELD, CLIENT_CLOSED, EDITOR_CLOSED = 8, 16, 20
+
+_SYS_FUTEX = {"x86_64": 202, "aarch64": 98}.get(platform.machine())
+_FUTEX_WAIT, _FUTEX_WAKE = 0, 1
+
+_libc = ctypes.CDLL(None, use_errno=True)
+_libc.syscall.restype = ctypes.c_long
+
+
+class _Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+def _futex_wait(word: ctypes.c_uint32, expected: int, timeout: float):
+    if _SYS_FUTEX is None:
+        time.sleep(min(timeout, 0.0005))
+        return
+    spec = _Timespec(int(timeout), int((timeout % 1) * 1e9))
+    _libc.syscall(_SYS_FUTEX, ctypes.byref(word), _FUTEX_WAIT, ctypes.c_uint32(expected), ctypes.byref(spec), None, 0)
+
+
+def _futex_wake(word: ctypes.c_uint32):
+    if _SYS_FUTEX is not None:
+        _libc.syscall(_SYS_FUTEX, ctypes.byref(word), _FUTEX_WAKE, 0x7FFFFFFF, None, None, 0)
+
+
+class _Ring:
+    """View of one ring header plus its data area."""
+
+    def __init__(self, region: mmap.mmap, header_offset: int, data_offset: int, size: int):
+        self.head = ctypes.c_uint64.from_buffer(region, header_offset + HEAD)
+        self.tail = ctypes.c_uint64.from_buffer(region, header_offset + TAIL)
+        self.data_doorbell = ctypes.c_uint32.from_buffer(region, header_offset + DATA_DOORBELL)
+        self.reader_asleep = ctypes.c_uint32.from_buffer(region, header_offset + READER_ASLEEP)
+        self.space_doorbell = ctypes.c_uint32.from_buffer(region, header_offset + SPACE_DOORBELL)
+        self.writer_asleep = ctypes.c_uint32.from_buffer(region, header_offset + WRITER_ASLEEP)
+        self.data = memoryview(region)[data_offset:data_offset + size]
+        self.size = size
+
+    def release(self):
+        self.data.release()
+
+    @staticmethod
+    def ring_doorbell(doorbell: ctypes.c_uint32, asleep: ctypes.c_uint32):
+        doorbell.value = (doorbell.value + 1) & 0xFFFFFFFF
+        if asleep.value:
+            _futex_wake(doorbell)
+
+
+class SharedMemoryStream:
+    """Socket-like byte stream over the editor's shared memory rings."""
+
+    def __init__(self, name: str):
+        path = "/dev/shm/" + name.lstrip("/")
+        fd = os.open(path, os.O_RDWR)
+        try:
+            size = os.fstat(fd).st_size
+            self._region = mmap.mmap(fd, size)
+        finally:
+            os.close(fd)
+        # Nobody else needs the name, the mapping keeps the memory alive
+        try:
+            os.unlink(path)
+        except OSError:
+            pass
+
+        if self._region[0:4] != MAGIC or int.from_bytes(self._region[4:8], "little") != VERSION:
+            self._region.close()
+            raise ConnectionError("Not an UnrealMCP shared memory region")
+
+        ring_size = int.from_bytes(self._region[RING_SIZE_FIELD:RING_SIZE_FIELD + 8], "little")
+        self._client_closed = ctypes.c_uint32.from_buffer(self._region, CLIENT_CLOSED)
+        self._editor_closed = ctypes.c_uint32.from_buffer(self._region, EDITOR_CLOSED)
+        self._requests = _Ring(self._region, CONTROL_SIZE, DATA_OFFSET, ring_size)
+        self._responses = _Ring(self._region, CONTROL_SIZE + RING_HEADER_SIZE, DATA_OFFSET + ring_size, ring_size)
+        self._timeout: Optional[float] = None
+
+    def settimeout(self, timeout: Optional[float]):
+        self._timeout = timeout
+
+    def _closed(self) -> bool:
+        return bool(self._client_closed.value or self._editor_closed.value)
+
+    def _wait(self, ready, doorbell: ctypes.c_uint32, asleep: ctypes.c_uint32):
+        deadline = None if self._timeout is None else time.monotonic() + self._timeout
+        while not ready():
+            if self._closed():
+                raise ConnectionError("Shared memory connection closed")
+            seen = doorbell.value
+            asleep.value = 1
+            if ready() or self._closed():
+                asleep.value = 0
+                continue
+            remaining = 1.0 if deadline is None else deadline - time.monotonic()
+            if remaining <= 0:
+                asleep.value = 0
+                raise TimeoutError("Timed out waiting for Unreal")
+            _futex_wait(doorbell, seen, min(remaining, 1.0))
+            asleep.value = 0
+
+    def sendall(self, data: bytes):
+        ring = self._requests
+        view = memoryview(data)
+        while view:
+            self._wait(lambda: ring.head.value - ring.tail.value < ring.size, ring.space_doorbell, ring.writer_asleep)
+            head = ring.head.value
+            count = min(len(view), ring.size - (head - ring.tail.value))
+            start = head & (ring.size - 1)
+            first = min(count, ring.size - start)
+            ring.data[start:start + first] = view[:first]
+            ring.data[0:count - first] = view[first:count]
+            ring.head.value = head + count
+            _Ring.ring_doorbell(ring.data_doorbell, ring.reader_asleep)
+            view = view[count:]
+
+    def recv_into(self, buffer, nbytes: int = 0) -> int:
+        ring = self._responses
+        target = memoryview(buffer).cast("B")
+        nbytes = nbytes or len(target)
+        try:
+            self._wait(lambda: ring.head.value != ring.tail.value, ring.data_doorbell, ring.reader_asleep)
+        except ConnectionError:
+            if ring.head.value == ring.tail.value:
+                return 0
+        tail = ring.tail.value
+        count = min(nbytes, ring.head.value - tail)
+        start = tail & (ring.size - 1)
+        first = min(count, ring.size - start)
+        target[:first] = ring.data[start:start + first]
+        target[first:count] = ring.data[0:count - first]
+        ring.tail.value = tail + count
+        _Ring.ring_doorbell(ring.space_doorbell, ring.writer_asleep)
+        return count
+
+    def recv(self, nbytes: int) -> bytes:
+        buffer = bytearray(nbytes)
+        return bytes(buffer[:self.recv_into(buffer, nbytes)])
+
+    def close(self):
+        if self._region is None:
+            return
+        self._client_closed.value = 1
+        for ring in (self._requests, self._responses):
+            for doorbell in (ring.data_doorbell, ring.space_doorbell):
+                doorbell.value = (doorbell.value + 1) & 0xFFFFFFFF
+                _futex_wake(doorbell)
+            ring.release()
+        # Every ctypes view has to go before the mapping can be closed
+        del ring, doorbell
+        del self._client_closed, self._editor_closed, self._requests, self._responses
+        self._region.close()
+        self._region = None